@@ -22,6 +22,8 @@
 
 #include "gui/EventRecorder.h"
 
+#include "common/atomic.h"
+#include "common/config-manager.h"
 #include "common/util.h"
 #include "common/system.h"
 #include "common/textconsole.h"
@@ -80,8 +82,9 @@ public:
 	 *
 	 * @param paused true, when the channel should be paused.
 	 *               false when it should be unpaused.
+	 * @param time   the time (in ms) the request was made at
 	 */
-	void pause(bool paused);
+	void pause(bool paused, uint32 time);
 
 	/**
 	 * Queries whether the channel is currently paused.
@@ -123,9 +126,10 @@ public:
 	void notifyGlobalVolChange() { updateChannelVolumes(); }
 
 	/**
-	 * Queries how long the channel has been playing.
+	 * Queries the data needed to work out how long the channel has been
+	 * playing, see MixerImpl::getElapsedTime.
 	 */
-	Timestamp getElapsedTime();
+	void getTiming(uint32 &samplesConsumed, uint32 &mixerTimeStamp, uint32 &pauseStartTime, uint32 &pauseTime) const;
 
 	/**
 	 * Queries the channel's sound type.
@@ -175,15 +179,22 @@ private:
 
 // TODO: parameter "system" is unused
 MixerImpl::MixerImpl(OSystem *system, uint sampleRate)
-	: _mutex(), _sampleRate(sampleRate), _mixerReady(false), _handleSeed(0), _soundTypeSettings() {
+	: _mutex(), _sampleRate(sampleRate), _mixerReady(false), _handleSeed(0), _mixPass(0), _soundTypeSettings() {
 
 	assert(sampleRate > 0);
 
-	for (int i = 0; i != NUM_CHANNELS; i++)
+	for (int i = 0; i != NUM_CHANNELS; i++) {
 		_channels[i] = 0;
+		_finishedHandles[i] = 0xFFFFFFFF;
+	}
 }
 
 MixerImpl::~MixerImpl() {
+	// Channels which never made it to the audio thread are still queued
+	Command cmd;
+	while (_commands.pop(cmd))
+		delete cmd.channel;
+
 	for (int i = 0; i != NUM_CHANNELS; i++)
 		delete _channels[i];
 }
@@ -196,10 +207,120 @@ uint MixerImpl::getOutputRate() const {
 	return _sampleRate;
 }
 
+bool MixerImpl::isChannelActive(int index) const {
+	const ChannelState &state = _channelStates[index];
+	return state.inUse && _finishedHandles[index] != state.handle;
+}
+
+int MixerImpl::findChannel(SoundHandle handle) const {
+	const int index = handle._val % NUM_CHANNELS;
+	if (!isChannelActive(index) || _channelStates[index].handle != handle._val)
+		return -1;
+	return index;
+}
+
+void MixerImpl::postCommand(Command::Type type, uint32 handle, int value, Channel *channel) {
+	Command cmd;
+	cmd.type = type;
+	cmd.handle = handle;
+	cmd.value = value;
+	cmd.time = g_system->getMillis(true);
+	cmd.channel = channel;
+
+	// The queue only fills up when the backend stops calling mixCallback
+	// for a while. Wait for the audio thread to make room, without holding
+	// _mutex, as streams being mixed may call into the mixer as well.
+	while (!_commands.push(cmd)) {
+		_mutex.unlock();
+		g_system->delayMillis(1);
+		_mutex.lock();
+	}
+}
+
+void MixerImpl::waitForMixPass() {
+	// The stop commands are queued by now. A pass which starts later
+	// executes them before mixing anything, so only a pass which is in
+	// progress right now may still be using the streams.
+	Common::memoryBarrier();
+	const uint32 pass = _mixPass;
+	if (!(pass & 1))
+		return;
+
+	while (_mixPass == pass)
+		g_system->delayMillis(1);
+	Common::memoryBarrier();
+}
+
+void MixerImpl::executeCommand(const Command &cmd) {
+	const int index = cmd.handle % NUM_CHANNELS;
+	Channel *chan = _channels[index];
+	const bool matches = chan && chan->getHandle()._val == cmd.handle;
+
+	switch (cmd.type) {
+	case Command::kPlay:
+		// The engine side only reuses a slot once its previous channel was
+		// stopped or has finished, so whatever is left here is dead.
+		delete chan;
+		_channels[index] = cmd.channel;
+		break;
+
+	case Command::kStop:
+		if (matches) {
+			delete chan;
+			_channels[index] = 0;
+		}
+		break;
+
+	case Command::kStopAll:
+		for (int i = 0; i != NUM_CHANNELS; i++) {
+			if (_channels[i] != 0 && !_channels[i]->isPermanent()) {
+				delete _channels[i];
+				_channels[i] = 0;
+			}
+		}
+		break;
+
+	case Command::kPause:
+		if (matches)
+			chan->pause(cmd.value != 0, cmd.time);
+		break;
+
+	case Command::kSetVolume:
+		if (matches)
+			chan->setVolume(cmd.value);
+		break;
+
+	case Command::kSetBalance:
+		if (matches)
+			chan->setBalance(cmd.value);
+		break;
+
+	case Command::kUpdateVolumes:
+		for (int i = 0; i != NUM_CHANNELS; ++i) {
+			if (_channels[i] && _channels[i]->getType() == cmd.value)
+				_channels[i]->notifyGlobalVolChange();
+		}
+		break;
+	}
+}
+
+void MixerImpl::publishTiming(int index) {
+	const Channel *chan = _channels[index];
+	ChannelTiming &timing = _channelTimings[index];
+
+	timing.sequence++;
+	Common::memoryBarrier();
+	timing.handle = chan->getHandle()._val;
+	chan->getTiming(timing.samplesConsumed, timing.mixerTimeStamp, timing.pauseStartTime, timing.pauseTime);
+	timing.paused = chan->isPaused();
+	Common::memoryBarrier();
+	timing.sequence++;
+}
+
 void MixerImpl::insertChannel(SoundHandle *handle, Channel *chan) {
 	int index = -1;
 	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] == 0) {
+		if (!isChannelActive(i)) {
 			index = i;
 			break;
 		}
@@ -210,8 +331,6 @@ void MixerImpl::insertChannel(SoundHandle *handle, Channel *chan) {
 		return;
 	}
 
-	_channels[index] = chan;
-
 	SoundHandle chanHandle;
 	chanHandle._val = index + (_handleSeed * NUM_CHANNELS);
 
@@ -219,6 +338,17 @@ void MixerImpl::insertChannel(SoundHandle *handle, Channel *chan) {
 	_handleSeed++;
 	if (handle)
 		*handle = chanHandle;
+
+	ChannelState &state = _channelStates[index];
+	state.inUse = true;
+	state.permanent = chan->isPermanent();
+	state.handle = chanHandle._val;
+	state.id = chan->getId();
+	state.type = chan->getType();
+	state.volume = chan->getVolume();
+	state.balance = chan->getBalance();
+
+	postCommand(Command::kPlay, chanHandle._val, 0, chan);
 }
 
 void MixerImpl::playStream(
@@ -242,7 +372,7 @@ void MixerImpl::playStream(
 	// Prevent duplicate sounds
 	if (id != -1) {
 		for (int i = 0; i != NUM_CHANNELS; i++)
-			if (_channels[i] != 0 && _channels[i]->getId() == id) {
+			if (isChannelActive(i) && _channelStates[i].id == id) {
 				// Delete the stream if were asked to auto-dispose it.
 				// Note: This could cause trouble if the client code does not
 				// yet expect the stream to be gone. The primary example to
@@ -269,8 +399,6 @@ void MixerImpl::playStream(
 int MixerImpl::mixCallback(byte *samples, uint len) {
 	assert(samples);
 
-	Common::StackLock lock(_mutex);
-
 	int16 *buf = (int16 *)samples;
 	// we store stereo, 16-bit samples
 	assert(len % 4 == 0);
@@ -279,6 +407,14 @@ int MixerImpl::mixCallback(byte *samples, uint len) {
 	// Since the mixer callback has been called, the mixer must be ready...
 	_mixerReady = true;
 
+	_mixPass++;
+	Common::memoryBarrier();
+
+	// Apply everything the engine requested since the last call
+	Command cmd;
+	while (_commands.pop(cmd))
+		executeCommand(cmd);
+
 	//  zero the buf
 	memset(buf, 0, 2 * len * sizeof(int16));
 
@@ -287,59 +423,77 @@ int MixerImpl::mixCallback(byte *samples, uint len) {
 	for (int i = 0; i != NUM_CHANNELS; i++)
 		if (_channels[i]) {
 			if (_channels[i]->isFinished()) {
+				_finishedHandles[i] = _channels[i]->getHandle()._val;
 				delete _channels[i];
 				_channels[i] = 0;
-			} else if (!_channels[i]->isPaused()) {
-				tmp = _channels[i]->mix(buf, len);
-
-				if (tmp > res)
-					res = tmp;
+			} else {
+				if (!_channels[i]->isPaused()) {
+					tmp = _channels[i]->mix(buf, len);
+
+					if (tmp > res)
+						res = tmp;
+				}
+				publishTiming(i);
 			}
 		}
 
+	Common::memoryBarrier();
+	_mixPass++;
+
 	return res;
 }
 
 void MixerImpl::stopAll() {
-	Common::StackLock lock(_mutex);
-	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] != 0 && !_channels[i]->isPermanent()) {
-			delete _channels[i];
-			_channels[i] = 0;
+	{
+		Common::StackLock lock(_mutex);
+		for (int i = 0; i != NUM_CHANNELS; i++) {
+			if (_channelStates[i].inUse && !_channelStates[i].permanent)
+				_channelStates[i].inUse = false;
 		}
+		postCommand(Command::kStopAll, 0);
 	}
+
+	// Make sure that none of the streams is used anymore
+	waitForMixPass();
 }
 
 void MixerImpl::stopID(int id) {
-	Common::StackLock lock(_mutex);
-	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] != 0 && _channels[i]->getId() == id) {
-			delete _channels[i];
-			_channels[i] = 0;
+	{
+		Common::StackLock lock(_mutex);
+		for (int i = 0; i != NUM_CHANNELS; i++) {
+			if (isChannelActive(i) && _channelStates[i].id == id) {
+				_channelStates[i].inUse = false;
+				postCommand(Command::kStop, _channelStates[i].handle);
+			}
 		}
 	}
+
+	waitForMixPass();
 }
 
 void MixerImpl::stopHandle(SoundHandle handle) {
-	Common::StackLock lock(_mutex);
+	{
+		Common::StackLock lock(_mutex);
 
-	// Simply ignore stop requests for handles of sounds that already terminated
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
-		return;
+		// Simply ignore stop requests for handles of sounds that already terminated
+		const int index = findChannel(handle);
+		if (index == -1)
+			return;
 
-	delete _channels[index];
-	_channels[index] = 0;
+		_channelStates[index].inUse = false;
+		postCommand(Command::kStop, handle._val);
+	}
+
+	// The caller may free the stream as soon as this returns
+	waitForMixPass();
 }
 
 void MixerImpl::muteSoundType(SoundType type, bool mute) {
 	assert(0 <= (int)type && (int)type < ARRAYSIZE(_soundTypeSettings));
-	_soundTypeSettings[type].mute = mute;
 
-	for (int i = 0; i != NUM_CHANNELS; ++i) {
-		if (_channels[i] && _channels[i]->getType() == type)
-			_channels[i]->notifyGlobalVolChange();
-	}
+	Common::StackLock lock(_mutex);
+	_soundTypeSettings[type].mute = mute;
+	postCommand(Command::kUpdateVolumes, 0, type);
 }
 
 bool MixerImpl::isSoundTypeMuted(SoundType type) const {
@@ -350,37 +504,43 @@ bool MixerImpl::isSoundTypeMuted(SoundType type) const {
 void MixerImpl::setChannelVolume(SoundHandle handle, byte volume) {
 	Common::StackLock lock(_mutex);
 
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	const int index = findChannel(handle);
+	if (index == -1)
 		return;
 
-	_channels[index]->setVolume(volume);
+	_channelStates[index].volume = volume;
+	postCommand(Command::kSetVolume, handle._val, volume);
 }
 
 byte MixerImpl::getChannelVolume(SoundHandle handle) {
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	Common::StackLock lock(_mutex);
+
+	const int index = findChannel(handle);
+	if (index == -1)
 		return 0;
 
-	return _channels[index]->getVolume();
+	return _channelStates[index].volume;
 }
 
 void MixerImpl::setChannelBalance(SoundHandle handle, int8 balance) {
 	Common::StackLock lock(_mutex);
 
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	const int index = findChannel(handle);
+	if (index == -1)
 		return;
 
-	_channels[index]->setBalance(balance);
+	_channelStates[index].balance = balance;
+	postCommand(Command::kSetBalance, handle._val, balance);
 }
 
 int8 MixerImpl::getChannelBalance(SoundHandle handle) {
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	Common::StackLock lock(_mutex);
+
+	const int index = findChannel(handle);
+	if (index == -1)
 		return 0;
 
-	return _channels[index]->getBalance();
+	return _channelStates[index].balance;
 }
 
 uint32 MixerImpl::getSoundElapsedTime(SoundHandle handle) {
@@ -388,29 +548,69 @@ uint32 MixerImpl::getSoundElapsedTime(SoundHandle handle) {
 }
 
 Timestamp MixerImpl::getElapsedTime(SoundHandle handle) {
-	Common::StackLock lock(_mutex);
+	Timestamp ts(0, _sampleRate);
 
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
-		return Timestamp(0, _sampleRate);
+	{
+		Common::StackLock lock(_mutex);
+		if (findChannel(handle) == -1)
+			return ts;
+	}
 
-	return _channels[index]->getElapsedTime();
+	// Take a consistent snapshot of what the audio thread last published
+	const ChannelTiming &timing = _channelTimings[handle._val % NUM_CHANNELS];
+	uint32 sequence, samplesConsumed, mixerTimeStamp, pauseStartTime, pauseTime;
+	bool paused;
+	do {
+		sequence = timing.sequence;
+		Common::memoryBarrier();
+		if (timing.handle != handle._val) {
+			// The audio thread did not get to mix this sound yet
+			return ts;
+		}
+		samplesConsumed = timing.samplesConsumed;
+		mixerTimeStamp = timing.mixerTimeStamp;
+		pauseStartTime = timing.pauseStartTime;
+		pauseTime = timing.pauseTime;
+		paused = timing.paused;
+		Common::memoryBarrier();
+	} while ((sequence & 1) || sequence != timing.sequence);
+
+	if (mixerTimeStamp == 0)
+		return ts;
+
+	uint32 delta;
+	if (paused)
+		delta = pauseStartTime - mixerTimeStamp;
+	else
+		delta = g_system->getMillis(true) - mixerTimeStamp - pauseTime;
+
+	// Convert the number of samples into a time duration.
+
+	ts = ts.addFrames(samplesConsumed);
+	ts = ts.addMsecs(delta);
+
+	// In theory it would seem like a good idea to limit the approximation
+	// so that it never exceeds the theoretical upper bound set by
+	// _samplesDecoded. Meanwhile, back in the real world, doing so makes
+	// the Broken Sword cutscenes noticeably jerkier. I guess the mixer
+	// isn't invoked at the regular intervals that I first imagined.
+
+	return ts;
 }
 
 void MixerImpl::pauseAll(bool paused) {
 	Common::StackLock lock(_mutex);
 	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] != 0) {
-			_channels[i]->pause(paused);
-		}
+		if (isChannelActive(i))
+			postCommand(Command::kPause, _channelStates[i].handle, paused);
 	}
 }
 
 void MixerImpl::pauseID(int id, bool paused) {
 	Common::StackLock lock(_mutex);
 	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] != 0 && _channels[i]->getId() == id) {
-			_channels[i]->pause(paused);
+		if (isChannelActive(i) && _channelStates[i].id == id) {
+			postCommand(Command::kPause, _channelStates[i].handle, paused);
 			return;
 		}
 	}
@@ -420,11 +620,10 @@ void MixerImpl::pauseHandle(SoundHandle handle, bool paused) {
 	Common::StackLock lock(_mutex);
 
 	// Simply ignore (un)pause requests for sounds that already terminated
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	if (findChannel(handle) == -1)
 		return;
 
-	_channels[index]->pause(paused);
+	postCommand(Command::kPause, handle._val, paused);
 }
 
 bool MixerImpl::isSoundIDActive(int id) {
@@ -435,16 +634,16 @@ bool MixerImpl::isSoundIDActive(int id) {
 #endif
 
 	for (int i = 0; i != NUM_CHANNELS; i++)
-		if (_channels[i] && _channels[i]->getId() == id)
+		if (isChannelActive(i) && _channelStates[i].id == id)
 			return true;
 	return false;
 }
 
 int MixerImpl::getSoundID(SoundHandle handle) {
 	Common::StackLock lock(_mutex);
-	const int index = handle._val % NUM_CHANNELS;
-	if (_channels[index] && _channels[index]->getHandle()._val == handle._val)
-		return _channels[index]->getId();
+	const int index = findChannel(handle);
+	if (index != -1)
+		return _channelStates[index].id;
 	return 0;
 }
 
@@ -455,14 +654,13 @@ bool MixerImpl::isSoundHandleActive(SoundHandle handle) {
 	g_eventRec.updateSubsystems();
 #endif
 
-	const int index = handle._val % NUM_CHANNELS;
-	return _channels[index] && _channels[index]->getHandle()._val == handle._val;
+	return findChannel(handle) != -1;
 }
 
 bool MixerImpl::hasActiveChannelOfType(SoundType type) {
 	Common::StackLock lock(_mutex);
 	for (int i = 0; i != NUM_CHANNELS; i++)
-		if (_channels[i] && _channels[i]->getType() == type)
+		if (isChannelActive(i) && _channelStates[i].type == type)
 			return true;
 	return false;
 }
@@ -481,11 +679,7 @@ void MixerImpl::setVolumeForSoundType(SoundType type, int volume) {
 
 	Common::StackLock lock(_mutex);
 	_soundTypeSettings[type].volume = volume;
-
-	for (int i = 0; i != NUM_CHANNELS; ++i) {
-		if (_channels[i] && _channels[i]->getType() == type)
-			_channels[i]->notifyGlobalVolChange();
-	}
+	postCommand(Command::kUpdateVolumes, 0, type);
 }
 
 int MixerImpl::getVolumeForSoundType(SoundType type) const {
@@ -509,7 +703,10 @@ Channel::Channel(Mixer *mixer, Mixer::SoundType type, AudioStream *stream,
 	assert(stream);
 
 	// Get a rate converter instance
-	_converter = makeRateConverter(_stream->getRate(), mixer->getOutputRate(), _stream->isStereo(), reverseStereo);
+	RateConverterQuality quality = kRateConverterLinear;
+	if (ConfMan.hasKey("audio_resampler") && ConfMan.get("audio_resampler") == "sinc")
+		quality = kRateConverterSinc;
+	_converter = makeRateConverter(_stream->getRate(), mixer->getOutputRate(), _stream->isStereo(), reverseStereo, quality);
 }
 
 Channel::~Channel() {
@@ -561,50 +758,29 @@ void Channel::updateChannelVolumes() {
 	}
 }
 
-void Channel::pause(bool paused) {
+void Channel::pause(bool paused, uint32 time) {
 	//assert((paused && _pauseLevel >= 0) || (!paused && _pauseLevel));
 
 	if (paused) {
 		_pauseLevel++;
 
 		if (_pauseLevel == 1)
-			_pauseStartTime = g_system->getMillis(true);
+			_pauseStartTime = time;
 	} else if (_pauseLevel > 0) {
 		_pauseLevel--;
 
 		if (!_pauseLevel) {
-			_pauseTime = (g_system->getMillis(true) - _pauseStartTime);
+			_pauseTime = (time - _pauseStartTime);
 			_pauseStartTime = 0;
 		}
 	}
 }
 
-Timestamp Channel::getElapsedTime() {
-	const uint32 rate = _mixer->getOutputRate();
-	uint32 delta = 0;
-
-	Audio::Timestamp ts(0, rate);
-
-	if (_mixerTimeStamp == 0)
-		return ts;
-
-	if (isPaused())
-		delta = _pauseStartTime - _mixerTimeStamp;
-	else
-		delta = g_system->getMillis(true) - _mixerTimeStamp - _pauseTime;
-
-	// Convert the number of samples into a time duration.
-
-	ts = ts.addFrames(_samplesConsumed);
-	ts = ts.addMsecs(delta);
-
-	// In theory it would seem like a good idea to limit the approximation
-	// so that it never exceeds the theoretical upper bound set by
-	// _samplesDecoded. Meanwhile, back in the real world, doing so makes
-	// the Broken Sword cutscenes noticeably jerkier. I guess the mixer
-	// isn't invoked at the regular intervals that I first imagined.
-
-	return ts;
+void Channel::getTiming(uint32 &samplesConsumed, uint32 &mixerTimeStamp, uint32 &pauseStartTime, uint32 &pauseTime) const {
+	samplesConsumed = _samplesConsumed;
+	mixerTimeStamp = _mixerTimeStamp;
+	pauseStartTime = _pauseStartTime;
+	pauseTime = _pauseTime;
 }
 
 int Channel::mix(int16 *data, uint len) {
@@ -25,6 +25,7 @@
 
 #include "common/scummsys.h"
 #include "common/mutex.h"
+#include "common/lockfree-queue.h"
 #include "audio/mixer.h"
 
 namespace Audio {
@@ -42,6 +43,21 @@ namespace Audio {
  * 4) Change the mixer into ready mode via setReady(true).
  * 5) Start audio processing (e.g. by resuming the audio thread, if applicable).
  *
+ * The mixer callback never blocks on engine threads: the channel objects are
+ * owned by the audio thread alone. All control calls update a shadow copy of
+ * the channel state (guarded by _mutex, which is only ever taken by engine
+ * threads) and post a command into a lock-free queue, which mixCallback()
+ * drains before mixing. Playback position is published back by the audio
+ * thread through a per-channel sequence counter.
+ *
+ * mixCallback() bumps _mixPass when it starts and when it finishes a pass,
+ * so the counter is odd while a pass is in progress. Once a stop command is
+ * queued, only a pass which was already in progress can still use the
+ * stream. Stop calls thus wait for that pass to finish, after releasing
+ * _mutex, and callers may free streams they still own once they return.
+ * Stop calls must not be made from within mixCallback(), e.g. from the
+ * readBuffer() of a stream, as the pass they wait for would never finish.
+ *
  * In the future, we might make it possible for backends to provide
  * (partial) alternative implementations of the mixer, e.g. to make
  * better use of native sound mixing support on low-end devices.
@@ -51,15 +67,79 @@ namespace Audio {
 class MixerImpl : public Mixer {
 private:
 	enum {
-		NUM_CHANNELS = 16
+		NUM_CHANNELS = 16,
+		COMMAND_QUEUE_SIZE = 256
 	};
 
+	/**
+	 * A control request posted by an engine thread, to be executed by the
+	 * audio thread at the start of the next mixCallback().
+	 */
+	struct Command {
+		enum Type {
+			kPlay,			///< start playing 'channel' in slot handle % NUM_CHANNELS
+			kStop,			///< stop the channel with the given handle
+			kStopAll,		///< stop all non permanent channels
+			kPause,			///< (un)pause the given handle, 'value' is the pause flag
+			kSetVolume,		///< set the volume of the given handle to 'value'
+			kSetBalance,	///< set the balance of the given handle to 'value'
+			kUpdateVolumes	///< global settings for sound type 'value' changed
+		};
+
+		Type type;
+		uint32 handle;
+		int value;
+		uint32 time;
+		Channel *channel;
+	};
+
+	/**
+	 * Engine side view of a channel slot. Only accessed with _mutex held.
+	 */
+	struct ChannelState {
+		ChannelState() : inUse(false), permanent(false), handle(0xFFFFFFFF), id(-1), type(kPlainSoundType), volume(0), balance(0) {}
+
+		bool inUse;
+		bool permanent;
+		uint32 handle;
+		int id;
+		SoundType type;
+		byte volume;
+		int8 balance;
+	};
+
+	/**
+	 * Playback position of a channel slot, written by the audio thread.
+	 * 'sequence' is odd while an update is in progress; readers retry
+	 * until they see the same even value before and after copying.
+	 */
+	struct ChannelTiming {
+		ChannelTiming() : sequence(0), handle(0xFFFFFFFF), samplesConsumed(0), mixerTimeStamp(0), pauseStartTime(0), pauseTime(0), paused(false) {}
+
+		volatile uint32 sequence;
+		uint32 handle;
+		uint32 samplesConsumed;
+		uint32 mixerTimeStamp;
+		uint32 pauseStartTime;
+		uint32 pauseTime;
+		bool paused;
+	};
+
+	/** Serializes engine threads among themselves; never taken by mixCallback(). */
 	Common::Mutex _mutex;
 
 	const uint _sampleRate;
 	bool _mixerReady;
 	uint32 _handleSeed;
 
+	Common::LockFreeQueue<Command, COMMAND_QUEUE_SIZE> _commands;
+	ChannelState _channelStates[NUM_CHANNELS];
+	ChannelTiming _channelTimings[NUM_CHANNELS];
+	/** Handle of the last channel which finished on its own, per slot. */
+	volatile uint32 _finishedHandles[NUM_CHANNELS];
+	/** Number of mix pass starts and ends; odd while a pass is in progress. */
+	volatile uint32 _mixPass;
+
 	struct SoundTypeSettings {
 		SoundTypeSettings() : mute(false), volume(kMaxMixerVolume) {}
 
@@ -68,6 +148,7 @@ private:
 	};
 
 	SoundTypeSettings _soundTypeSettings[4];
+	/** The actual channels, only ever touched by the audio thread. */
 	Channel *_channels[NUM_CHANNELS];
 
 
@@ -121,6 +202,14 @@ public:
 protected:
 	void insertChannel(SoundHandle *handle, Channel *chan);
 
+private:
+	bool isChannelActive(int index) const;
+	int findChannel(SoundHandle handle) const;
+	void postCommand(Command::Type type, uint32 handle, int value = 0, Channel *channel = 0);
+	void executeCommand(const Command &cmd);
+	void waitForMixPass();
+	void publishTiming(int index);
+
 public:
 	/**
 	 * The mixer callback function, to be called at regular intervals by
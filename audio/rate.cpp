@@ -32,9 +32,20 @@
 #include "audio/rate.h"
 #include "audio/mixer.h"
 #include "common/frac.h"
+#include "common/math.h"
 #include "common/textconsole.h"
 #include "common/util.h"
 
+#if !defined(OUTPUT_UNSIGNED_AUDIO)
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RATE_MIX_SSE2
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RATE_MIX_NEON
+#endif
+#endif
+
 namespace Audio {
 
 
@@ -46,6 +57,108 @@ namespace Audio {
  */
 #define INTERMEDIATE_BUFFER_SIZE 512
 
+/**
+ * The number of sample pairs the converters generate in one go, before
+ * they are scaled and mixed into the output buffer.
+ */
+#define OUTPUT_CHUNK_SIZE 256
+
+
+/**
+ * Scale the sample pairs in ibuf by the given volumes and add them with
+ * saturation to obuf. This is equivalent to calling clampedAdd() with
+ * (sample * vol) / Mixer::kMaxMixerVolume for every sample, including the
+ * rounding towards zero of the division.
+ *
+ * @param obuf      output buffer, interleaved stereo
+ * @param ibuf      input buffer, interleaved stereo in output channel order
+ * @param numPairs  number of sample pairs to mix
+ * @param vol0      volume of the first channel of each pair
+ * @param vol1      volume of the second channel of each pair
+ */
+static void mixBuffer(st_sample_t *obuf, const st_sample_t *ibuf, st_size_t numPairs, st_volume_t vol0, st_volume_t vol1) {
+	st_size_t i = 0;
+
+#if defined(RATE_MIX_SSE2) || defined(RATE_MIX_NEON)
+	// The vector code divides by shifting
+	assert(Audio::Mixer::kMaxMixerVolume == 256);
+#endif
+
+#if defined(RATE_MIX_SSE2)
+	const __m128i vol = _mm_set_epi16(vol1, vol0, vol1, vol0, vol1, vol0, vol1, vol0);
+	const __m128i bias = _mm_set1_epi32(255);
+
+	for (; i + 4 <= numPairs; i += 4) {
+		const __m128i in = _mm_loadu_si128((const __m128i *)(ibuf + i * 2));
+
+		// Widen the products to 32 bits
+		const __m128i lo = _mm_mullo_epi16(in, vol);
+		const __m128i hi = _mm_mulhi_epi16(in, vol);
+		__m128i p0 = _mm_unpacklo_epi16(lo, hi);
+		__m128i p1 = _mm_unpackhi_epi16(lo, hi);
+
+		// Round negative products towards zero, like the C division does
+		p0 = _mm_srai_epi32(_mm_add_epi32(p0, _mm_and_si128(_mm_srai_epi32(p0, 31), bias)), 8);
+		p1 = _mm_srai_epi32(_mm_add_epi32(p1, _mm_and_si128(_mm_srai_epi32(p1, 31), bias)), 8);
+
+		const __m128i scaled = _mm_packs_epi32(p0, p1);
+		const __m128i out = _mm_loadu_si128((const __m128i *)(obuf + i * 2));
+		_mm_storeu_si128((__m128i *)(obuf + i * 2), _mm_adds_epi16(out, scaled));
+	}
+#elif defined(RATE_MIX_NEON)
+	const int16 volArray[8] = { (int16)vol0, (int16)vol1, (int16)vol0, (int16)vol1, (int16)vol0, (int16)vol1, (int16)vol0, (int16)vol1 };
+	const int16x8_t vol = vld1q_s16(volArray);
+	const int32x4_t bias = vdupq_n_s32(255);
+
+	for (; i + 4 <= numPairs; i += 4) {
+		const int16x8_t in = vld1q_s16(ibuf + i * 2);
+
+		int32x4_t p0 = vmull_s16(vget_low_s16(in), vget_low_s16(vol));
+		int32x4_t p1 = vmull_s16(vget_high_s16(in), vget_high_s16(vol));
+
+		// Round negative products towards zero, like the C division does
+		p0 = vshrq_n_s32(vaddq_s32(p0, vandq_s32(vshrq_n_s32(p0, 31), bias)), 8);
+		p1 = vshrq_n_s32(vaddq_s32(p1, vandq_s32(vshrq_n_s32(p1, 31), bias)), 8);
+
+		const int16x8_t scaled = vcombine_s16(vqmovn_s32(p0), vqmovn_s32(p1));
+		vst1q_s16(obuf + i * 2, vqaddq_s16(vld1q_s16(obuf + i * 2), scaled));
+	}
+#endif
+
+	for (; i < numPairs; ++i) {
+		clampedAdd(obuf[i * 2    ], (ibuf[i * 2    ] * (int)vol0) / Audio::Mixer::kMaxMixerVolume);
+		clampedAdd(obuf[i * 2 + 1], (ibuf[i * 2 + 1] * (int)vol1) / Audio::Mixer::kMaxMixerVolume);
+	}
+}
+
+/**
+ * Drive the generate() method of a rate converter in chunks of
+ * OUTPUT_CHUNK_SIZE sample pairs and mix its output into obuf.
+ *
+ * generate() stores the samples in output channel order (i.e. with
+ * reverseStereo already applied), so the volumes are swapped here, too.
+ *
+ * @return number of sample pairs processed
+ */
+template<bool reverseStereo, class Converter>
+static int flowChunked(Converter &converter, AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+	st_sample_t tmp[OUTPUT_CHUNK_SIZE * 2];
+	st_size_t done = 0;
+
+	while (done < osamp) {
+		const st_size_t wanted = MIN<st_size_t>(osamp - done, OUTPUT_CHUNK_SIZE);
+		const st_size_t generated = converter.generate(input, tmp, wanted);
+
+		mixBuffer(obuf + done * 2, tmp, generated, reverseStereo ? vol_r : vol_l, reverseStereo ? vol_l : vol_r);
+		done += generated;
+
+		if (generated < wanted)
+			break;
+	}
+
+	return done;
+}
+
 
 /**
  * Audio rate converter based on simple resampling. Used when no
@@ -69,7 +182,10 @@ protected:
 
 public:
 	SimpleRateConverter(st_rate_t inrate, st_rate_t outrate);
-	int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r);
+	int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+		return flowChunked<reverseStereo>(*this, input, obuf, osamp, vol_l, vol_r);
+	}
+	st_size_t generate(AudioStream &input, st_sample_t *obuf, st_size_t osamp);
 	int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) {
 		return ST_SUCCESS;
 	}
@@ -98,11 +214,11 @@ SimpleRateConverter<stereo, reverseStereo>::SimpleRateConverter(st_rate_t inrate
 }
 
 /*
- * Processed signed long samples from ibuf to obuf.
- * Return number of sample pairs processed.
+ * Resample signed long samples from input to obuf, without mixing.
+ * Return number of sample pairs generated.
  */
 template<bool stereo, bool reverseStereo>
-int SimpleRateConverter<stereo, reverseStereo>::flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+st_size_t SimpleRateConverter<stereo, reverseStereo>::generate(AudioStream &input, st_sample_t *obuf, st_size_t osamp) {
 	st_sample_t *ostart, *oend;
 
 	ostart = obuf;
@@ -133,11 +249,9 @@ int SimpleRateConverter<stereo, reverseStereo>::flow(AudioStream &input, st_samp
 		// Increment output position
 		opos += opos_inc;
 
-		// output left channel
-		clampedAdd(obuf[reverseStereo    ], (out0 * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
-
-		// output right channel
-		clampedAdd(obuf[reverseStereo ^ 1], (out1 * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
+		// output left and right channel
+		obuf[reverseStereo    ] = out0;
+		obuf[reverseStereo ^ 1] = out1;
 
 		obuf += 2;
 	}
@@ -175,7 +289,10 @@ protected:
 
 public:
 	LinearRateConverter(st_rate_t inrate, st_rate_t outrate);
-	int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r);
+	int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+		return flowChunked<reverseStereo>(*this, input, obuf, osamp, vol_l, vol_r);
+	}
+	st_size_t generate(AudioStream &input, st_sample_t *obuf, st_size_t osamp);
 	int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) {
 		return ST_SUCCESS;
 	}
@@ -207,11 +324,11 @@ LinearRateConverter<stereo, reverseStereo>::LinearRateConverter(st_rate_t inrate
 }
 
 /*
- * Processed signed long samples from ibuf to obuf.
- * Return number of sample pairs processed.
+ * Interpolate signed long samples from input to obuf, without mixing.
+ * Return number of sample pairs generated.
  */
 template<bool stereo, bool reverseStereo>
-int LinearRateConverter<stereo, reverseStereo>::flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+st_size_t LinearRateConverter<stereo, reverseStereo>::generate(AudioStream &input, st_sample_t *obuf, st_size_t osamp) {
 	st_sample_t *ostart, *oend;
 
 	ostart = obuf;
@@ -248,11 +365,238 @@ int LinearRateConverter<stereo, reverseStereo>::flow(AudioStream &input, st_samp
 						  (st_sample_t)(ilast1 + (((icur1 - ilast1) * opos + FRAC_HALF) >> FRAC_BITS)) :
 						  out0);
 
-			// output left channel
-			clampedAdd(obuf[reverseStereo    ], (out0 * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
+			// output left and right channel
+			obuf[reverseStereo    ] = out0;
+			obuf[reverseStereo ^ 1] = out1;
+
+			obuf += 2;
+
+			// Increment output position
+			opos += opos_inc;
+		}
+	}
+	return (obuf - ostart) / 2;
+}
+
+
+#pragma mark -
+
+
+/**
+ * Number of filter phases between two input samples. The fractional output
+ * position is rounded to the nearest phase.
+ */
+#define SINC_PHASE_BITS 8
+#define SINC_PHASES (1 << SINC_PHASE_BITS)
+
+/** Number of taps used when upsampling; downsampling widens the filter. */
+#define SINC_MIN_TAPS 16
+#define SINC_MAX_TAPS 64
+
+/** Fixed point precision of the filter coefficients. */
+#define SINC_COEF_BITS 14
+
+/**
+ * Multiply and add 'taps' 16 bit values, taps being a multiple of 8.
+ */
+static int sincDotProduct(const int16 *samples, const int16 *coefs, int taps) {
+#if defined(RATE_MIX_SSE2)
+	__m128i acc = _mm_setzero_si128();
+	for (int i = 0; i < taps; i += 8) {
+		const __m128i a = _mm_loadu_si128((const __m128i *)(samples + i));
+		const __m128i b = _mm_load_si128((const __m128i *)(coefs + i));
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(a, b));
+	}
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(acc);
+#elif defined(RATE_MIX_NEON)
+	int32x4_t acc = vdupq_n_s32(0);
+	for (int i = 0; i < taps; i += 8) {
+		const int16x8_t a = vld1q_s16(samples + i);
+		const int16x8_t b = vld1q_s16(coefs + i);
+		acc = vmlal_s16(acc, vget_low_s16(a), vget_low_s16(b));
+		acc = vmlal_s16(acc, vget_high_s16(a), vget_high_s16(b));
+	}
+	const int32x2_t sum = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+	return vget_lane_s32(vpadd_s32(sum, sum), 0);
+#else
+	int acc = 0;
+	for (int i = 0; i < taps; ++i)
+		acc += samples[i] * coefs[i];
+	return acc;
+#endif
+}
 
-			// output right channel
-			clampedAdd(obuf[reverseStereo ^ 1], (out1 * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
+/**
+ * Audio rate converter based on a windowed sinc filter bank.
+ *
+ * For every one of the SINC_PHASES fractional positions between two input
+ * samples a set of Blackman windowed sinc coefficients is precomputed, with
+ * the cutoff at the lower of the two Nyquist frequencies. Each output sample
+ * is then the dot product of the most recent input samples with the
+ * coefficient set of its phase. This removes most of the aliasing the
+ * linear interpolation produces, at a higher CPU cost.
+ *
+ * Limited to sampling frequency <= 65535 Hz.
+ */
+template<bool stereo, bool reverseStereo>
+class SincRateConverter : public RateConverter {
+protected:
+	st_sample_t inBuf[INTERMEDIATE_BUFFER_SIZE];
+	const st_sample_t *inPtr;
+	int inLen;
+
+	/** fractional position of the output stream in input stream unit */
+	frac_t opos;
+
+	/** fractional position increment in the output stream */
+	frac_t opos_inc;
+
+	/** number of filter taps, a multiple of 8 */
+	int _taps;
+
+	/**
+	 * SINC_PHASES + 1 sets of _taps coefficients, the last one being for
+	 * positions which round up to the next input sample.
+	 */
+	int16 *_coefs;
+
+	/**
+	 * The last _taps input samples per channel. Every sample is stored
+	 * twice, _taps entries apart, so the window starting at _historyPos
+	 * is always contiguous.
+	 */
+	int16 _history[2][SINC_MAX_TAPS * 2];
+	int _historyPos;
+
+	void pushSample(int channel, st_sample_t sample) {
+		_history[channel][_historyPos] = _history[channel][_historyPos + _taps] = sample;
+	}
+
+	static st_sample_t filter(const int16 *samples, const int16 *coefs, int taps) {
+		const int val = (sincDotProduct(samples, coefs, taps) + (1 << (SINC_COEF_BITS - 1))) >> SINC_COEF_BITS;
+		return (st_sample_t)CLIP<int>(val, ST_SAMPLE_MIN, ST_SAMPLE_MAX);
+	}
+
+public:
+	SincRateConverter(st_rate_t inrate, st_rate_t outrate);
+	~SincRateConverter() {
+		free(_coefs);
+	}
+
+	int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+		return flowChunked<reverseStereo>(*this, input, obuf, osamp, vol_l, vol_r);
+	}
+	st_size_t generate(AudioStream &input, st_sample_t *obuf, st_size_t osamp);
+	int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) {
+		return ST_SUCCESS;
+	}
+};
+
+
+/*
+ * Prepare processing.
+ */
+template<bool stereo, bool reverseStereo>
+SincRateConverter<stereo, reverseStereo>::SincRateConverter(st_rate_t inrate, st_rate_t outrate) {
+	if (inrate >= 65536 || outrate >= 65536) {
+		error("rate effect can only handle rates < 65536");
+	}
+
+	opos = FRAC_ONE;
+	opos_inc = (inrate << FRAC_BITS) / outrate;
+
+	// Cutoff frequency relative to the input Nyquist frequency. When
+	// downsampling, the filter gets proportionally longer to keep the same
+	// number of zero crossings.
+	const double cutoff = (outrate < inrate) ? (double)outrate / inrate : 1.0;
+	_taps = (int)(SINC_MIN_TAPS / cutoff);
+	_taps = CLIP((_taps + 7) & ~7, SINC_MIN_TAPS, SINC_MAX_TAPS);
+
+	// Room for the SSE2 code to use aligned loads
+	_coefs = (int16 *)malloc((SINC_PHASES + 1) * _taps * sizeof(int16) + 16);
+	if (!_coefs)
+		error("[SincRateConverter] Cannot allocate memory for filter bank");
+	int16 *coefs = (int16 *)(((size_t)_coefs + 15) & ~(size_t)15);
+
+	// The output lies between window entries center and center + 1
+	const int center = _taps / 2 - 1;
+	const double halfWidth = _taps / 2;
+
+	for (int phase = 0; phase <= SINC_PHASES; ++phase) {
+		const double frac = (double)phase / SINC_PHASES;
+		double taps[SINC_MAX_TAPS];
+		double sum = 0.0;
+
+		for (int i = 0; i < _taps; ++i) {
+			const double x = i - center - frac;
+			double value = cutoff;
+			if (x != 0.0)
+				value = sin(M_PI * cutoff * x) / (M_PI * x);
+
+			// Blackman window
+			const double w = 0.42 + 0.5 * cos(M_PI * x / halfWidth) + 0.08 * cos(2.0 * M_PI * x / halfWidth);
+			taps[i] = value * w;
+			sum += taps[i];
+		}
+
+		// Normalize to unity gain, so constant input stays constant
+		for (int i = 0; i < _taps; ++i)
+			coefs[phase * _taps + i] = (int16)floor(taps[i] / sum * (1 << SINC_COEF_BITS) + 0.5);
+	}
+
+	memset(_history, 0, sizeof(_history));
+	_historyPos = 0;
+
+	inLen = 0;
+}
+
+/*
+ * Filter signed long samples from input to obuf, without mixing.
+ * Return number of sample pairs generated.
+ */
+template<bool stereo, bool reverseStereo>
+st_size_t SincRateConverter<stereo, reverseStereo>::generate(AudioStream &input, st_sample_t *obuf, st_size_t osamp) {
+	st_sample_t *ostart, *oend;
+	const int16 *coefs = (const int16 *)(((size_t)_coefs + 15) & ~(size_t)15);
+
+	ostart = obuf;
+	oend = obuf + osamp * 2;
+
+	while (obuf < oend) {
+
+		// read enough input samples so that opos < FRAC_ONE
+		while ((frac_t)FRAC_ONE <= opos) {
+			// Check if we have to refill the buffer
+			if (inLen == 0) {
+				inPtr = inBuf;
+				inLen = input.readBuffer(inBuf, ARRAYSIZE(inBuf));
+				if (inLen <= 0)
+					return (obuf - ostart) / 2;
+			}
+			inLen -= (stereo ? 2 : 1);
+			pushSample(0, *inPtr++);
+			if (stereo)
+				pushSample(1, *inPtr++);
+			if (++_historyPos == _taps)
+				_historyPos = 0;
+			opos -= FRAC_ONE;
+		}
+
+		// Loop as long as the outpos trails behind, and as long as there is
+		// still space in the output buffer.
+		while (opos < (frac_t)FRAC_ONE && obuf < oend) {
+			const int phase = (opos + (1 << (FRAC_BITS - SINC_PHASE_BITS - 1))) >> (FRAC_BITS - SINC_PHASE_BITS);
+			const int16 *phaseCoefs = coefs + phase * _taps;
+
+			st_sample_t out0, out1;
+			out0 = filter(_history[0] + _historyPos, phaseCoefs, _taps);
+			out1 = (stereo ? filter(_history[1] + _historyPos, phaseCoefs, _taps) : out0);
+
+			// output left and right channel
+			obuf[reverseStereo    ] = out0;
+			obuf[reverseStereo ^ 1] = out1;
 
 			obuf += 2;
 
@@ -283,43 +627,37 @@ public:
 	virtual int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
 		assert(input.isStereo() == stereo);
 
-		st_sample_t *ptr;
-		st_size_t len;
-
-		st_sample_t *ostart = obuf;
-
-		if (stereo)
-			osamp *= 2;
-
-		// Reallocate temp buffer, if necessary
+		// Reallocate temp buffer, if necessary. Mono input gets expanded to
+		// stereo in place, so we always need room for 'osamp' pairs.
 		if (osamp > _bufferSize) {
 			free(_buffer);
-			_buffer = (st_sample_t *)malloc(osamp * 2);
+			_buffer = (st_sample_t *)malloc(osamp * 2 * sizeof(st_sample_t));
 			_bufferSize = osamp;
 		}
 
 		if (!_buffer)
 			error("[CopyRateConverter::flow] Cannot allocate memory for temp buffer");
 
-		// Read up to 'osamp' samples into our temporary buffer
-		len = input.readBuffer(_buffer, osamp);
-
-		// Mix the data into the output buffer
-		ptr = _buffer;
-		for (; len > 0; len -= (stereo ? 2 : 1)) {
-			st_sample_t out0, out1;
-			out0 = *ptr++;
-			out1 = (stereo ? *ptr++ : out0);
-
-			// output left channel
-			clampedAdd(obuf[reverseStereo    ], (out0 * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
+		// Read up to 'osamp' sample pairs into our temporary buffer
+		st_size_t len = input.readBuffer(_buffer, stereo ? osamp * 2 : osamp);
+		if ((int)len <= 0)
+			return 0;
 
-			// output right channel
-			clampedAdd(obuf[reverseStereo ^ 1], (out1 * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
-
-			obuf += 2;
+		if (stereo) {
+			len /= 2;
+			if (reverseStereo) {
+				for (st_size_t i = 0; i < len; ++i)
+					SWAP(_buffer[i * 2], _buffer[i * 2 + 1]);
+			}
+		} else {
+			// Expand back to front, so nothing is overwritten before it is read
+			for (st_size_t i = len; i-- > 0; )
+				_buffer[i * 2] = _buffer[i * 2 + 1] = _buffer[i];
 		}
-		return (obuf - ostart) / 2;
+
+		// Mix the data into the output buffer
+		mixBuffer(obuf, _buffer, len, reverseStereo ? vol_r : vol_l, reverseStereo ? vol_l : vol_r);
+		return len;
 	}
 
 	virtual int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) {
@@ -331,9 +669,11 @@ public:
 #pragma mark -
 
 template<bool stereo, bool reverseStereo>
-RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate) {
+RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate, RateConverterQuality quality) {
 	if (inrate != outrate) {
-		if ((inrate % outrate) == 0) {
+		if (quality == kRateConverterSinc) {
+			return new SincRateConverter<stereo, reverseStereo>(inrate, outrate);
+		} else if ((inrate % outrate) == 0) {
 			return new SimpleRateConverter<stereo, reverseStereo>(inrate, outrate);
 		} else {
 			return new LinearRateConverter<stereo, reverseStereo>(inrate, outrate);
@@ -346,14 +686,14 @@ RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate) {
 /**
  * Create and return a RateConverter object for the specified input and output rates.
  */
-RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo) {
+RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo, RateConverterQuality quality) {
 	if (stereo) {
 		if (reverseStereo)
-			return makeRateConverter<true, true>(inrate, outrate);
+			return makeRateConverter<true, true>(inrate, outrate, quality);
 		else
-			return makeRateConverter<true, false>(inrate, outrate);
+			return makeRateConverter<true, false>(inrate, outrate, quality);
 	} else
-		return makeRateConverter<false, false>(inrate, outrate);
+		return makeRateConverter<false, false>(inrate, outrate, quality);
 }
 
 } // End of namespace Audio
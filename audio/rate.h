@@ -78,7 +78,15 @@ public:
 	virtual int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) = 0;
 };
 
-RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo = false);
+/**
+ * The interpolation used when the input and output rates differ.
+ */
+enum RateConverterQuality {
+	kRateConverterLinear,	///< nearest sample or linear interpolation, cheap
+	kRateConverterSinc		///< windowed sinc filter bank, far less aliasing
+};
+
+RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo = false, RateConverterQuality quality = kRateConverterLinear);
 
 } // End of namespace Audio
 
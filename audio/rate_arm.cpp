@@ -435,8 +435,9 @@ public:
 
 /**
  * Create and return a RateConverter object for the specified input and output rates.
+ * The requested quality is ignored, only the assembler converters are available here.
  */
-RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo) {
+RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo, RateConverterQuality quality) {
 	if (inrate != outrate) {
 		if ((inrate % outrate) == 0) {
 			if (stereo) {
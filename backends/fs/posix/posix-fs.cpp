@@ -31,8 +31,10 @@
 #define FORBIDDEN_SYMBOL_EXCEPTION_exit		//Needed for IRIX's unistd.h
 
 #include "backends/fs/posix/posix-fs.h"
+#include "backends/fs/posix/posix-mappedstream.h"
 #include "backends/fs/stdiostream.h"
 #include "common/algorithm.h"
+#include "common/config-manager.h"
 
 #include <sys/param.h>
 #include <sys/stat.h>
@@ -244,6 +246,18 @@ AbstractFSNode *POSIXFilesystemNode::getParent() const {
 }
 
 Common::SeekableReadStream *POSIXFilesystemNode::createReadStream() {
+#ifdef POSIX
+	// Mapping files into memory has to be enabled with the "map_files"
+	// option. A read error on a mapped file, e.g. on a damaged CD or a lost
+	// network share, or the file being truncated, raises SIGBUS instead of
+	// setting the stream error flag.
+	if (ConfMan.hasKey("map_files") && ConfMan.getBool("map_files")) {
+		Common::SeekableReadStream *stream = POSIXMappedStream::makeFromPath(getPath());
+		if (stream)
+			return stream;
+	}
+#endif
+
 	return StdioStream::makeFromPath(getPath(), false);
 }
 
@@ -0,0 +1,103 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#if defined(POSIX)
+
+// Disable symbol overrides so that we can use open, mmap etc.
+#define FORBIDDEN_SYMBOL_ALLOW_ALL
+
+#include "backends/fs/posix/posix-mappedstream.h"
+#include "common/util.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// The residency vector of mincore() is unsigned char on Linux, but plain
+// char on macOS and the BSDs
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+typedef char MincoreVec;
+#else
+typedef unsigned char MincoreVec;
+#endif
+
+POSIXMappedStream::POSIXMappedStream(void *mapping, uint32 size)
+	: Common::MemoryReadStream((const byte *)mapping, size), _mapping(mapping), _mappingSize(size) {
+	assert(mapping);
+}
+
+POSIXMappedStream::~POSIXMappedStream() {
+	munmap(_mapping, _mappingSize);
+}
+
+bool POSIXMappedStream::prefetch(uint32 offset, uint32 len) {
+	if (offset >= _mappingSize || len == 0)
+		return true;
+	len = MIN<size_t>(len, _mappingSize - offset);
+
+	// Both calls below need a page aligned start address
+	const size_t pageSize = sysconf(_SC_PAGESIZE);
+	const size_t start = offset - offset % pageSize;
+	const size_t end = offset + len;
+	const size_t pages = (end - start + pageSize - 1) / pageSize;
+	byte *address = (byte *)_mapping + start;
+
+	// Check whether the range is in the page cache already, in which case
+	// there is nothing to do
+	MincoreVec *residency = (MincoreVec *)malloc(pages);
+	bool resident = residency && mincore(address, end - start, residency) == 0;
+	for (size_t i = 0; resident && i < pages; ++i)
+		resident = (residency[i] & 1) != 0;
+	free(residency);
+
+	if (!resident)
+		madvise(address, end - start, MADV_WILLNEED);
+
+	return resident;
+}
+
+POSIXMappedStream *POSIXMappedStream::makeFromPath(const Common::String &path) {
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	// Setting up a mapping costs more than opening a stdio stream, which
+	// only pays off for big files. Streams can not be bigger than 2 GB.
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size < kMinMappedFileSize || st.st_size > 0x7FFFFFFF) {
+		close(fd);
+		return 0;
+	}
+
+	// The mapping stays valid after the file descriptor is closed, so
+	// mapped streams do not hold on to a descriptor
+	void *mapping = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (mapping == MAP_FAILED)
+		return 0;
+
+	return new POSIXMappedStream(mapping, st.st_size);
+}
+
+#endif
@@ -0,0 +1,65 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef BACKENDS_FS_POSIX_MAPPEDSTREAM_H
+#define BACKENDS_FS_POSIX_MAPPEDSTREAM_H
+
+#include "common/scummsys.h"
+#include "common/memstream.h"
+#include "common/str.h"
+
+/**
+ * A read stream on a file which has been mapped into memory with mmap().
+ * Reads are plain memory copies, and getDirectPointer() gives access to
+ * the file data without copying it at all. prefetch() asks the kernel to
+ * read the given range into the page cache in the background.
+ */
+class POSIXMappedStream : public Common::MemoryReadStream {
+public:
+	enum {
+		/** Smaller files are not worth mapping. */
+		kMinMappedFileSize = 1024 * 1024
+	};
+
+protected:
+	/** Start and length of the mapping. */
+	void *_mapping;
+	size_t _mappingSize;
+
+	POSIXMappedStream(void *mapping, uint32 size);
+
+public:
+	/**
+	 * Given a path, maps the file at that path into memory and wraps the
+	 * mapping in a POSIXMappedStream instance. Returns 0 if the file can
+	 * not be mapped or is not worth mapping, i.e. if it is not a regular
+	 * file, smaller than kMinMappedFileSize or too big, in which case the
+	 * caller should fall back to a StdioStream.
+	 */
+	static POSIXMappedStream *makeFromPath(const Common::String &path);
+
+	virtual ~POSIXMappedStream();
+
+	virtual bool prefetch(uint32 offset, uint32 len);
+};
+
+#endif
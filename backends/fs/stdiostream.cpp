@@ -27,6 +27,10 @@
 
 #include "backends/fs/stdiostream.h"
 
+#if defined(POSIX)
+#include <fcntl.h>
+#endif
+
 StdioStream::StdioStream(void *handle) : _handle(handle) {
 	assert(handle);
 }
@@ -68,6 +72,14 @@ uint32 StdioStream::read(void *ptr, uint32 len) {
 	return fread((byte *)ptr, 1, len, (FILE *)_handle);
 }
 
+bool StdioStream::prefetch(uint32 offset, uint32 len) {
+#if defined(POSIX) && defined(POSIX_FADV_WILLNEED)
+	if (len > 0)
+		posix_fadvise(fileno((FILE *)_handle), offset, len, POSIX_FADV_WILLNEED);
+#endif
+	return false;
+}
+
 uint32 StdioStream::write(const void *ptr, uint32 len) {
 	return fwrite(ptr, 1, len, (FILE *)_handle);
 }
@@ -54,6 +54,13 @@ public:
 	virtual int32 size() const;
 	virtual bool seek(int32 offs, int whence = SEEK_SET);
 	virtual uint32 read(void *dataPtr, uint32 dataSize);
+
+	/**
+	 * Asks the kernel to read the range into the page cache in the
+	 * background, where posix_fadvise() is available. Always returns false,
+	 * as there is no telling whether the data is in memory already.
+	 */
+	virtual bool prefetch(uint32 offset, uint32 len);
 };
 
 #endif
@@ -290,6 +290,8 @@ void DINGUXSdlGraphicsManager::internUpdateScreen() {
 	if (_mouseNeedsRedraw)
 		undrawMouse();
 
+	flushDirtyRects(width, height);
+
 	// Force a full redraw if requested
 	if (_forceFull) {
 		_numDirtyRects = 1;
@@ -406,6 +408,7 @@ void DINGUXSdlGraphicsManager::internUpdateScreen() {
 	}
 
 	_numDirtyRects = 0;
+	_dirtyRectsFlushed = false;
 	_forceFull = false;
 	_mouseNeedsRedraw = false;
 }
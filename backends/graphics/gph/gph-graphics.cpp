@@ -319,6 +319,8 @@ void GPHGraphicsManager::internUpdateScreen() {
 	if (_mouseNeedsRedraw)
 		undrawMouse();
 
+	flushDirtyRects(width, height);
+
 	// Force a full redraw if requested
 	if (_forceFull) {
 		_numDirtyRects = 1;
@@ -437,6 +439,7 @@ void GPHGraphicsManager::internUpdateScreen() {
 	}
 
 	_numDirtyRects = 0;
+	_dirtyRectsFlushed = false;
 	_forceFull = false;
 	_mouseNeedsRedraw = false;
 }
@@ -331,6 +331,8 @@ void LinuxmotoSdlGraphicsManager::internUpdateScreen() {
 	if (_mouseNeedsRedraw)
 		undrawMouse();
 
+	flushDirtyRects(width, height);
+
 	// Force a full redraw if requested
 	if (_forceFull) {
 		_numDirtyRects = 1;
@@ -448,6 +450,7 @@ void LinuxmotoSdlGraphicsManager::internUpdateScreen() {
 	}
 
 	_numDirtyRects = 0;
+	_dirtyRectsFlushed = false;
 	_forceFull = false;
 	_mouseNeedsRedraw = false;
 }
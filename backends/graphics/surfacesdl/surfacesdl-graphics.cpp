@@ -129,7 +129,8 @@ SurfaceSdlGraphicsManager::SurfaceSdlGraphicsManager(SdlEventSource *sdlEventSou
 #endif
 	_overlayVisible(false),
 	_overlayscreen(0), _tmpscreen2(0),
-	_scalerProc(0), _screenChangeCount(0),
+	_scalerProc(0), _scalerPool(0), _scalerStatsFrames(0), _scalerStatsMicros(0),
+	_screenChangeCount(0), _numDirtyRects(0), _dirtyTiles(8), _dirtyRectsFlushed(false),
 	_mouseVisible(false), _mouseNeedsRedraw(false), _mouseData(0), _mouseSurface(0),
 	_mouseOrigSurface(0), _cursorDontScale(false), _cursorPaletteDisabled(true),
 	_currentShakePos(0), _newShakePos(0),
@@ -148,6 +149,8 @@ SurfaceSdlGraphicsManager::SurfaceSdlGraphicsManager(SdlEventSource *sdlEventSou
 
 	_mouseBackup.x = _mouseBackup.y = _mouseBackup.w = _mouseBackup.h = 0;
 
+	resetDirtyRectStats();
+
 	memset(&_mouseCurState, 0, sizeof(_mouseCurState));
 
 	_graphicsMutex = g_system->createMutex();
@@ -157,6 +160,20 @@ SurfaceSdlGraphicsManager::SurfaceSdlGraphicsManager(SdlEventSource *sdlEventSou
 		_enableFocusRectDebugCode = ConfMan.getBool("use_sdl_debug_focusrect");
 #endif
 
+#ifdef USE_SCALERS
+	// By default use one scaler thread per additional CPU core
+	int scalerThreads = 0;
+	if (ConfMan.hasKey("scaler_threads")) {
+		scalerThreads = ConfMan.getInt("scaler_threads");
+	} else {
+#if SDL_VERSION_ATLEAST(1, 3, 0)
+		scalerThreads = MIN(SDL_GetCPUCount() - 1, 7);
+#endif
+	}
+	if (scalerThreads > 0)
+		_scalerPool = new ScalerThreadPool(scalerThreads);
+#endif
+
 	memset(&_oldVideoMode, 0, sizeof(_oldVideoMode));
 	memset(&_videoMode, 0, sizeof(_videoMode));
 	memset(&_transactionDetails, 0, sizeof(_transactionDetails));
@@ -191,6 +208,7 @@ SurfaceSdlGraphicsManager::~SurfaceSdlGraphicsManager() {
 		SDL_FreeSurface(_mouseOrigSurface);
 	_mouseOrigSurface = 0;
 	g_system->deleteMutex(_graphicsMutex);
+	delete _scalerPool;
 
 	free(_currentPalette);
 	free(_cursorPalette);
@@ -965,6 +983,29 @@ void SurfaceSdlGraphicsManager::updateScreen() {
 	internUpdateScreen();
 }
 
+/**
+ * Return a monotonic time stamp in microseconds, for profiling.
+ */
+static uint32 getMicroseconds() {
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+	return (uint32)(SDL_GetPerformanceCounter() * 1000000.0 / SDL_GetPerformanceFrequency());
+#else
+	return SDL_GetTicks() * 1000;
+#endif
+}
+
+/**
+ * Whether a scaler may run on several threads at the same time.
+ */
+static bool isScalerReentrant(ScalerProc *scalerProc) {
+#if defined(USE_HQ_SCALERS) && defined(USE_NASM)
+	// The assembler HQ scalers keep their state in static variables
+	if (scalerProc == HQ2x || scalerProc == HQ3x)
+		return false;
+#endif
+	return true;
+}
+
 void SurfaceSdlGraphicsManager::internUpdateScreen() {
 	SDL_Surface *srcSurf, *origSurf;
 	int height, width;
@@ -1046,6 +1087,8 @@ void SurfaceSdlGraphicsManager::internUpdateScreen() {
 	if (_mouseNeedsRedraw)
 		undrawMouse();
 
+	flushDirtyRects(width, height);
+
 	// Force a full redraw if requested
 	if (_forceFull) {
 		_numDirtyRects = 1;
@@ -1077,6 +1120,9 @@ void SurfaceSdlGraphicsManager::internUpdateScreen() {
 		srcPitch = srcSurf->pitch;
 		dstPitch = _hwscreen->pitch;
 
+		const bool useScalerPool = _scalerPool && scale1 > 1 && isScalerReentrant(scalerProc);
+		const uint32 scaleStartTime = getMicroseconds();
+
 		for (r = _dirtyRectList; r != lastRect; ++r) {
 			register int dst_y = r->y + _currentShakePos;
 			register int dst_h = 0;
@@ -1099,8 +1145,13 @@ void SurfaceSdlGraphicsManager::internUpdateScreen() {
 					dst_y = real2Aspect(dst_y);
 
 				assert(scalerProc != NULL);
-				scalerProc((byte *)srcSurf->pixels + (r->x * 2 + 2) + (r->y + 1) * srcPitch, srcPitch,
-					(byte *)_hwscreen->pixels + rx1 * 2 + dst_y * dstPitch, dstPitch, r->w, dst_h);
+				const byte *srcPtr = (byte *)srcSurf->pixels + (r->x * 2 + 2) + (r->y + 1) * srcPitch;
+				byte *dstPtr = (byte *)_hwscreen->pixels + rx1 * 2 + dst_y * dstPitch;
+
+				if (useScalerPool)
+					_scalerPool->scale(scalerProc, srcPtr, srcPitch, dstPtr, dstPitch, r->w, dst_h, scale1);
+				else
+					scalerProc(srcPtr, srcPitch, dstPtr, dstPitch, r->w, dst_h);
 			}
 
 			r->x = rx1;
@@ -1116,6 +1167,15 @@ void SurfaceSdlGraphicsManager::internUpdateScreen() {
 		SDL_UnlockSurface(srcSurf);
 		SDL_UnlockSurface(_hwscreen);
 
+		_scalerStatsMicros += getMicroseconds() - scaleStartTime;
+		if (++_scalerStatsFrames == kScalerStatsFrames) {
+			debug(2, "SDL scaler: %d us per frame over the last %d frames (%d worker threads)",
+				_scalerStatsMicros / _scalerStatsFrames, _scalerStatsFrames,
+				useScalerPool ? _scalerPool->getNumThreads() : 0);
+			_scalerStatsFrames = 0;
+			_scalerStatsMicros = 0;
+		}
+
 		// Readjust the dirty rect list in case we are doing a full update.
 		// This is necessary if shaking is active.
 		if (_forceFull) {
@@ -1210,6 +1270,7 @@ void SurfaceSdlGraphicsManager::internUpdateScreen() {
 	}
 
 	_numDirtyRects = 0;
+	_dirtyRectsFlushed = false;
 	_forceFull = false;
 	_mouseNeedsRedraw = false;
 }
@@ -1350,7 +1411,7 @@ void SurfaceSdlGraphicsManager::addDirtyRect(int x, int y, int w, int h, bool re
 	if (_forceFull)
 		return;
 
-	if (_numDirtyRects == NUM_DIRTY_RECT) {
+	if (_dirtyRectsFlushed && _numDirtyRects == NUM_DIRTY_RECT) {
 		_forceFull = true;
 		return;
 	}
@@ -1393,25 +1454,99 @@ void SurfaceSdlGraphicsManager::addDirtyRect(int x, int y, int w, int h, bool re
 		h = height - y;
 	}
 
-#ifdef USE_SCALERS
-	if (_videoMode.aspectRatioCorrection && !_overlayVisible && !realCoordinates) {
-		makeRectStretchable(x, y, w, h);
-	}
-#endif
-
 	if (w == width && h == height) {
 		_forceFull = true;
 		return;
 	}
 
-	if (w > 0 && h > 0) {
+	if (w <= 0 || h <= 0)
+		return;
+
+	_dirtyRectStats.rectsSubmitted++;
+
+	if (_dirtyRectsFlushed) {
+#ifdef USE_SCALERS
+		if (_videoMode.aspectRatioCorrection && !_overlayVisible && !realCoordinates) {
+			makeRectStretchable(x, y, w, h);
+		}
+#endif
+
 		SDL_Rect *r = &_dirtyRectList[_numDirtyRects++];
 
 		r->x = x;
 		r->y = y;
 		r->w = w;
 		r->h = h;
+		return;
+	}
+
+	if (_dirtyTiles.getWidth() < width || _dirtyTiles.getHeight() < height) {
+		// The screen size changed; the tile map is set up for both the game
+		// screen and the overlay so that this only happens once per mode.
+		_dirtyTiles.resize(MAX<int>(_videoMode.screenWidth, _videoMode.overlayWidth),
+		                   MAX<int>(_videoMode.screenHeight, _videoMode.overlayHeight));
+		_forceFull = true;
+		return;
 	}
+
+	// Rects are made stretchable in flushDirtyRects(), since snapping them
+	// to tiles would undo it
+	_dirtyTiles.addRect(Common::Rect(x, y, x + w, y + h));
+}
+
+void SurfaceSdlGraphicsManager::flushDirtyRects(int width, int height) {
+	_dirtyRectsFlushed = true;
+	_dirtyRectStats.frames++;
+
+	if (!_forceFull) {
+		// Leave room for the rects added while drawing the mouse cursor
+		if (_dirtyTiles.getRects(_mergedDirtyRects, NUM_DIRTY_RECT - 4, Common::Rect(width, height))) {
+			_numDirtyRects = _mergedDirtyRects.size();
+			for (int i = 0; i < _numDirtyRects; ++i) {
+				const Common::Rect &rect = _mergedDirtyRects[i];
+				int x = rect.left, y = rect.top, w = rect.width(), h = rect.height();
+
+#ifdef USE_SCALERS
+				if (_videoMode.aspectRatioCorrection && !_overlayVisible) {
+					makeRectStretchable(x, y, w, h);
+				}
+#endif
+
+				_dirtyRectList[i].x = x;
+				_dirtyRectList[i].y = y;
+				_dirtyRectList[i].w = w;
+				_dirtyRectList[i].h = h;
+			}
+		} else {
+			_forceFull = true;
+			_dirtyRectStats.fullRedrawFallbacks++;
+		}
+	}
+	_dirtyTiles.clear();
+
+	if (_forceFull) {
+		_dirtyRectStats.fullRedraws++;
+		_dirtyRectStats.pixelsRedrawn += width * height;
+	} else {
+		_dirtyRectStats.rectsDrawn += _numDirtyRects;
+		for (int i = 0; i < _numDirtyRects; ++i)
+			_dirtyRectStats.pixelsRedrawn += _dirtyRectList[i].w * _dirtyRectList[i].h;
+	}
+
+	if (_dirtyRectStats.frames % kDirtyRectStatsFrames == 0) {
+		debug(2, "SDL dirty rects: %d frames, %d rects submitted, %d drawn, %d pixels, %d full redraws (%d on overflow)",
+			_dirtyRectStats.frames, _dirtyRectStats.rectsSubmitted, _dirtyRectStats.rectsDrawn,
+			_dirtyRectStats.pixelsRedrawn, _dirtyRectStats.fullRedraws, _dirtyRectStats.fullRedrawFallbacks);
+	}
+}
+
+void SurfaceSdlGraphicsManager::resetDirtyRectStats() {
+	_dirtyRectStats.frames = 0;
+	_dirtyRectStats.rectsSubmitted = 0;
+	_dirtyRectStats.rectsDrawn = 0;
+	_dirtyRectStats.pixelsRedrawn = 0;
+	_dirtyRectStats.fullRedraws = 0;
+	_dirtyRectStats.fullRedrawFallbacks = 0;
 }
 
 int16 SurfaceSdlGraphicsManager::getHeight() {
@@ -25,12 +25,14 @@
 
 #include "backends/graphics/graphics.h"
 #include "backends/graphics/sdl/sdl-graphics.h"
+#include "graphics/dirtytiles.h"
 #include "graphics/pixelformat.h"
 #include "graphics/scaler.h"
 #include "common/events.h"
 #include "common/system.h"
 
 #include "backends/events/sdl/sdl-events.h"
+#include "backends/graphics/surfacesdl/surfacesdl-scalerpool.h"
 
 #include "backends/platform/sdl/sdl-sys.h"
 
@@ -105,6 +107,23 @@ public:
 	virtual int16 getHeight();
 	virtual int16 getWidth();
 
+	/**
+	 * Counters describing how screen updates were drawn, to tune the
+	 * dirty rect handling for a game. They are printed at debug level 2
+	 * every kDirtyRectStatsFrames frames.
+	 */
+	struct DirtyRectStats {
+		uint32 frames;
+		uint32 rectsSubmitted;      ///< Rects passed to addDirtyRect
+		uint32 rectsDrawn;          ///< Rects left after merging dirty tiles
+		uint32 pixelsRedrawn;       ///< Screen pixels sent to the scaler
+		uint32 fullRedraws;         ///< Frames drawn completely
+		uint32 fullRedrawFallbacks; ///< Full redraws due to too many rects
+	};
+
+	const DirtyRectStats &getDirtyRectStats() const { return _dirtyRectStats; }
+	void resetDirtyRectStats();
+
 protected:
 	// PaletteManager API
 	virtual void setPalette(const byte *colors, uint start, uint num);
@@ -232,6 +251,20 @@ protected:
 	int _scalerType;
 	int _transactionMode;
 
+	/** Worker threads for the scaler, or 0 if scaling happens inline */
+	ScalerThreadPool *_scalerPool;
+
+	/**
+	 * Time spent in the scaler, to measure the effect of the thread pool.
+	 * The average is printed at debug level 2 every kScalerStatsFrames
+	 * frames, then the counters are reset.
+	 */
+	uint32 _scalerStatsFrames;
+	uint32 _scalerStatsMicros;
+	enum {
+		kScalerStatsFrames = 300
+	};
+
 	// Indicates whether it is needed to free _hwsurface in destructor
 	bool _displayDisabled;
 
@@ -249,6 +282,20 @@ protected:
 	SDL_Rect _dirtyRectList[NUM_DIRTY_RECT];
 	int _numDirtyRects;
 
+	/**
+	 * Areas marked dirty since the last screen update. They are merged
+	 * into _dirtyRectList by flushDirtyRects(); rects added after that,
+	 * e.g. for the mouse cursor, go to _dirtyRectList directly.
+	 */
+	Graphics::DirtyTileMap _dirtyTiles;
+	Common::Array<Common::Rect> _mergedDirtyRects;
+	bool _dirtyRectsFlushed;
+
+	DirtyRectStats _dirtyRectStats;
+	enum {
+		kDirtyRectStatsFrames = 300
+	};
+
 	struct MousePos {
 		// The mouse position, using either virtual (game) or real
 		// (overlay) coordinates.
@@ -317,6 +364,13 @@ protected:
 
 	virtual void addDirtyRect(int x, int y, int w, int h, bool realCoordinates = false);
 
+	/**
+	 * Fill _dirtyRectList from the dirty tiles of a source surface of the
+	 * given size, or request a full redraw if they do not fit. Must be
+	 * called by internUpdateScreen before the list is used.
+	 */
+	void flushDirtyRects(int width, int height);
+
 	virtual void drawMouse();
 	virtual void undrawMouse();
 	virtual void blitCursor();
@@ -0,0 +1,151 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "backends/graphics/surfacesdl/surfacesdl-scalerpool.h"
+
+#include "common/textconsole.h"
+#include "common/util.h"
+
+ScalerThreadPool::ScalerThreadPool(int numThreads)
+	: _numThreads(0), _threads(0), _quit(false),
+	  _scalerProc(0), _srcPtr(0), _srcPitch(0), _dstPtr(0), _dstPitch(0),
+	  _width(0), _height(0), _scaleFactor(1), _bandHeight(0),
+	  _numBands(0), _nextBand(0), _bandsDone(0) {
+
+	_mutex = SDL_CreateMutex();
+	_workCond = SDL_CreateCond();
+	_doneCond = SDL_CreateCond();
+
+	if (numThreads <= 0 || !_mutex || !_workCond || !_doneCond)
+		return;
+
+	_threads = new SDL_Thread *[numThreads];
+	for (int i = 0; i < numThreads; ++i) {
+#if SDL_VERSION_ATLEAST(1, 3, 0)
+		_threads[_numThreads] = SDL_CreateThread(workerThreadEntry, "ScummVM scaler", this);
+#else
+		_threads[_numThreads] = SDL_CreateThread(workerThreadEntry, this);
+#endif
+		if (!_threads[_numThreads]) {
+			warning("Could not create scaler thread: %s", SDL_GetError());
+			break;
+		}
+		_numThreads++;
+	}
+}
+
+ScalerThreadPool::~ScalerThreadPool() {
+	if (_mutex) {
+		SDL_LockMutex(_mutex);
+		_quit = true;
+		SDL_CondBroadcast(_workCond);
+		SDL_UnlockMutex(_mutex);
+	}
+
+	for (int i = 0; i < _numThreads; ++i)
+		SDL_WaitThread(_threads[i], NULL);
+	delete[] _threads;
+
+	if (_doneCond)
+		SDL_DestroyCond(_doneCond);
+	if (_workCond)
+		SDL_DestroyCond(_workCond);
+	if (_mutex)
+		SDL_DestroyMutex(_mutex);
+}
+
+void ScalerThreadPool::scale(ScalerProc *scalerProc, const uint8 *srcPtr, uint32 srcPitch,
+                             uint8 *dstPtr, uint32 dstPitch, int width, int height, int scaleFactor) {
+	// Split into at most two bands per thread, each at least
+	// kMinBandHeight rows high. The last band takes the remainder.
+	const int numBands = MIN(height / kMinBandHeight, (_numThreads + 1) * 2);
+
+	if (numBands < 2) {
+		scalerProc(srcPtr, srcPitch, dstPtr, dstPitch, width, height);
+		return;
+	}
+
+	SDL_LockMutex(_mutex);
+	_scalerProc = scalerProc;
+	_srcPtr = srcPtr;
+	_srcPitch = srcPitch;
+	_dstPtr = dstPtr;
+	_dstPitch = dstPitch;
+	_width = width;
+	_height = height;
+	_scaleFactor = scaleFactor;
+	_bandHeight = height / numBands;
+	_numBands = numBands;
+	_nextBand = 0;
+	_bandsDone = 0;
+	SDL_CondBroadcast(_workCond);
+
+	// Help out instead of just waiting
+	while (_nextBand < _numBands) {
+		const int band = _nextBand++;
+		SDL_UnlockMutex(_mutex);
+		scaleBand(band);
+		SDL_LockMutex(_mutex);
+		_bandsDone++;
+	}
+
+	while (_bandsDone < _numBands)
+		SDL_CondWait(_doneCond, _mutex);
+
+	_numBands = 0;
+	SDL_UnlockMutex(_mutex);
+}
+
+void ScalerThreadPool::scaleBand(int band) {
+	const int y = band * _bandHeight;
+	const int h = (band == _numBands - 1) ? _height - y : _bandHeight;
+
+	_scalerProc(_srcPtr + y * _srcPitch, _srcPitch,
+	            _dstPtr + y * _scaleFactor * _dstPitch, _dstPitch, _width, h);
+}
+
+void ScalerThreadPool::workerThread() {
+	SDL_LockMutex(_mutex);
+	while (true) {
+		while (!_quit && _nextBand >= _numBands)
+			SDL_CondWait(_workCond, _mutex);
+
+		if (_quit)
+			break;
+
+		const int band = _nextBand++;
+		SDL_UnlockMutex(_mutex);
+		scaleBand(band);
+		SDL_LockMutex(_mutex);
+
+		if (++_bandsDone == _numBands)
+			SDL_CondSignal(_doneCond);
+	}
+	SDL_UnlockMutex(_mutex);
+}
+
+int SDLCALL ScalerThreadPool::workerThreadEntry(void *arg) {
+	ScalerThreadPool *pool = (ScalerThreadPool *)arg;
+	assert(pool);
+	pool->workerThread();
+	return 0;
+}
@@ -0,0 +1,84 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef BACKENDS_GRAPHICS_SURFACESDL_SCALERPOOL_H
+#define BACKENDS_GRAPHICS_SURFACESDL_SCALERPOOL_H
+
+#include "backends/platform/sdl/sdl-sys.h"
+#include "graphics/scaler.h"
+
+/**
+ * A set of persistent worker threads which run a scaler over horizontal
+ * bands of a rectangle in parallel.
+ *
+ * Scalers read the rows around each source row, but never write to the
+ * source, so the bands can simply read across their borders while each of
+ * them writes a disjoint part of the destination.
+ */
+class ScalerThreadPool {
+public:
+	/**
+	 * @param numThreads number of worker threads to start; the calling
+	 *                   thread always takes part in the work as well
+	 */
+	ScalerThreadPool(int numThreads);
+	~ScalerThreadPool();
+
+	int getNumThreads() const { return _numThreads; }
+
+	/**
+	 * Run a scaler over the given area and return once it is fully
+	 * processed. Takes the same parameters as a ScalerProc, plus the
+	 * scale factor used to find the destination of each band.
+	 */
+	void scale(ScalerProc *scalerProc, const uint8 *srcPtr, uint32 srcPitch,
+	           uint8 *dstPtr, uint32 dstPitch, int width, int height, int scaleFactor);
+
+private:
+	enum {
+		/** Bands smaller than this are not worth a thread switch. */
+		kMinBandHeight = 16
+	};
+
+	int _numThreads;
+	SDL_Thread **_threads;
+	SDL_mutex *_mutex;
+	SDL_cond *_workCond;
+	SDL_cond *_doneCond;
+	bool _quit;
+
+	// The job currently being processed
+	ScalerProc *_scalerProc;
+	const uint8 *_srcPtr;
+	uint32 _srcPitch;
+	uint8 *_dstPtr;
+	uint32 _dstPitch;
+	int _width, _height, _scaleFactor;
+	int _bandHeight;
+	int _numBands, _nextBand, _bandsDone;
+
+	void scaleBand(int band);
+	void workerThread();
+	static int SDLCALL workerThreadEntry(void *arg);
+};
+
+#endif
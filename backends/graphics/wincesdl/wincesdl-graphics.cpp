@@ -531,6 +531,9 @@ void WINCESdlGraphicsManager::internUpdateScreen() {
 		update_scalers();
 	}
 
+	flushDirtyRects(_overlayVisible ? _videoMode.overlayWidth : _videoMode.screenWidth,
+	                _overlayVisible ? _videoMode.overlayHeight : _videoMode.screenHeight);
+
 	// Force a full redraw if requested
 	if (_forceFull) {
 		_numDirtyRects = 1;
@@ -702,6 +705,7 @@ void WINCESdlGraphicsManager::internUpdateScreen() {
 		SDL_UpdateRects(_hwscreen, numRectsOut, _dirtyRectOut);
 
 	_numDirtyRects = 0;
+	_dirtyRectsFlushed = false;
 	_forceFull = false;
 }
 
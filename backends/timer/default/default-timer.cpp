@@ -31,84 +31,149 @@ struct TimerSlot {
 	Common::String id;
 	uint32 interval;	// in microseconds
 
-	uint32 nextFireTime;	// in milliseconds
-	uint32 nextFireTimeMicro;	// microseconds part of nextFire
-
-	TimerSlot *next;
+	uint64 nextFireTime;	// in microseconds, as returned by getMicros()
 };
 
-void insertPrioQueue(TimerSlot *head, TimerSlot *newSlot) {
-	// The head points to a fake anchor TimerSlot; this common
-	// trick allows us to get rid of many special cases.
-
-	const uint32 nextFireTime = newSlot->nextFireTime;
-	TimerSlot *slot = head;
-	newSlot->next = 0;
+enum {
+	// A timer which has fallen behind by more than this many microseconds,
+	// e.g. because the process was suspended, is rescheduled relative to
+	// the current time instead of firing once for every missed interval.
+	kMaxTimerLag = 1000000
+};
 
-	// Insert the new slot into the sorted list of already scheduled
-	// timers in such a way that the list stays sorted...
-	while (true) {
-		assert(slot);
-		if (slot->next == 0 || nextFireTime < slot->next->nextFireTime) {
-			newSlot->next = slot->next;
-			slot->next = newSlot;
-			return;
-		}
-		slot = slot->next;
-	}
-}
+// Upper bounds of the jitter histogram buckets, in microseconds
+static const uint32 s_jitterBucketLimits[DefaultTimerManager::kJitterBuckets - 1] = {
+	100, 250, 500, 1000, 2000, 5000, 10000
+};
 
 
 DefaultTimerManager::DefaultTimerManager() :
-	_head(0) {
+	_runningProc(0) {
 
-	_head = new TimerSlot();
-	memset(_head, 0, sizeof(TimerSlot));
+	resetJitterHistogram();
 }
 
 DefaultTimerManager::~DefaultTimerManager() {
 	Common::StackLock lock(_mutex);
 
-	TimerSlot *slot = _head;
-	while (slot) {
-		TimerSlot *next = slot->next;
-		delete slot;
-		slot = next;
+	for (uint i = 0; i < _slots.size(); ++i)
+		delete _slots[i];
+	_slots.clear();
+}
+
+uint64 DefaultTimerManager::getMicros() {
+	return (uint64)g_system->getMillis(true) * 1000;
+}
+
+void DefaultTimerManager::siftUp(uint index) {
+	TimerSlot *slot = _slots[index];
+
+	while (index > 0) {
+		const uint parent = (index - 1) / 2;
+		if (_slots[parent]->nextFireTime <= slot->nextFireTime)
+			break;
+		_slots[index] = _slots[parent];
+		index = parent;
 	}
-	_head = 0;
+
+	_slots[index] = slot;
 }
 
-void DefaultTimerManager::handler() {
-	Common::StackLock lock(_mutex);
+void DefaultTimerManager::siftDown(uint index) {
+	TimerSlot *slot = _slots[index];
+	const uint size = _slots.size();
+
+	while (true) {
+		uint child = index * 2 + 1;
+		if (child >= size)
+			break;
+		if (child + 1 < size && _slots[child + 1]->nextFireTime < _slots[child]->nextFireTime)
+			child++;
+		if (slot->nextFireTime <= _slots[child]->nextFireTime)
+			break;
+		_slots[index] = _slots[child];
+		index = child;
+	}
+
+	_slots[index] = slot;
+}
 
-	uint32 curTime = g_system->getMillis(true);
+void DefaultTimerManager::handler() {
+	Common::StackLock handlerLock(_handlerMutex);
 
 	// Repeat as long as there is a TimerSlot that is scheduled to fire.
-	TimerSlot *slot = _head->next;
-	while (slot && slot->nextFireTime < curTime) {
-		// Remove the slot from the priority queue
-		_head->next = slot->next;
-
-		// Update the fire time and reinsert the TimerSlot into the priority
-		// queue.
-		assert(slot->interval > 0);
-		slot->nextFireTime += (slot->interval / 1000);
-		slot->nextFireTimeMicro += (slot->interval % 1000);
-		if (slot->nextFireTimeMicro > 1000) {
-			slot->nextFireTime += slot->nextFireTimeMicro / 1000;
-			slot->nextFireTimeMicro %= 1000;
+	while (true) {
+		TimerProc callback;
+		void *refCon;
+
+		{
+			Common::StackLock lock(_mutex);
+
+			if (_slots.empty())
+				break;
+
+			const uint64 curTime = getMicros();
+			TimerSlot *slot = _slots[0];
+			if (slot->nextFireTime > curTime)
+				break;
+
+			const uint64 lateness = curTime - slot->nextFireTime;
+			int bucket = 0;
+			while (bucket < kJitterBuckets - 1 && lateness > s_jitterBucketLimits[bucket])
+				bucket++;
+			_jitterHistogram[bucket]++;
+
+			// Update the fire time and restore the heap order. The next
+			// fire time is based on the previous one, not on the current
+			// time, so that the lateness of single invocations does not
+			// add up.
+			assert(slot->interval > 0);
+			if (lateness > kMaxTimerLag)
+				slot->nextFireTime = curTime + slot->interval;
+			else
+				slot->nextFireTime += slot->interval;
+			siftDown(0);
+
+			callback = slot->callback;
+			refCon = slot->refCon;
+			_runningProc = callback;
 		}
-		insertPrioQueue(_head, slot);
 
-		// Invoke the timer callback
-		assert(slot->callback);
-		slot->callback(slot->refCon);
+		// Invoke the timer callback. This is done without holding _mutex,
+		// so that timers can be installed and removed meanwhile.
+		assert(callback);
+		callback(refCon);
 
-		// Look at the next scheduled timer
-		slot = _head->next;
+		Common::StackLock lock(_mutex);
+		_runningProc = 0;
 	}
 }
 
+uint64 DefaultTimerManager::getNextFireTime() {
+	Common::StackLock lock(_mutex);
+
+	return _slots.empty() ? 0 : _slots[0]->nextFireTime;
+}
+
+uint32 DefaultTimerManager::getJitterBucketLimit(int bucket) {
+	assert(bucket >= 0 && bucket < kJitterBuckets);
+	return (bucket < kJitterBuckets - 1) ? s_jitterBucketLimits[bucket] : 0xFFFFFFFF;
+}
+
+void DefaultTimerManager::getJitterHistogram(uint32 *histogram) {
+	Common::StackLock lock(_mutex);
+
+	for (int i = 0; i < kJitterBuckets; ++i)
+		histogram[i] = _jitterHistogram[i];
+}
+
+void DefaultTimerManager::resetJitterHistogram() {
+	Common::StackLock lock(_mutex);
+
+	for (int i = 0; i < kJitterBuckets; ++i)
+		_jitterHistogram[i] = 0;
+}
+
 bool DefaultTimerManager::installTimerProc(TimerProc callback, int32 interval, void *refCon, const Common::String &id) {
 	assert(interval > 0);
 	Common::StackLock lock(_mutex);
@@ -132,44 +197,60 @@ bool DefaultTimerManager::installTimerProc(TimerProc callback, int32 interval, v
 	slot->refCon = refCon;
 	slot->id = id;
 	slot->interval = interval;
-	slot->nextFireTime = g_system->getMillis() + interval / 1000;
-	slot->nextFireTimeMicro = interval % 1000;
-	slot->next = 0;
+	slot->nextFireTime = getMicros() + interval;
+
+	_slots.push_back(slot);
+	siftUp(_slots.size() - 1);
 
-	insertPrioQueue(_head, slot);
+	if (_slots[0] == slot)
+		scheduleChanged();
 
 	return true;
 }
 
 void DefaultTimerManager::removeTimerProc(TimerProc callback) {
-	Common::StackLock lock(_mutex);
+	bool running;
 
-	TimerSlot *slot = _head;
+	{
+		Common::StackLock lock(_mutex);
 
-	while (slot->next) {
-		if (slot->next->callback == callback) {
-			TimerSlot *next = slot->next->next;
-			delete slot->next;
-			slot->next = next;
-		} else {
-			slot = slot->next;
+		// Drop the slots of the callback, and restore the heap order
+		uint kept = 0;
+		for (uint i = 0; i < _slots.size(); ++i) {
+			if (_slots[i]->callback == callback)
+				delete _slots[i];
+			else
+				_slots[kept++] = _slots[i];
 		}
+		_slots.resize(kept);
+		for (uint i = kept / 2; i-- > 0; )
+			siftDown(i);
+
+		// We need to remove all names referencing the timer proc here.
+		//
+		// Else we run into troubles, when the client code removes and readds timer
+		// callbacks.
+		//
+		// Another issues occurs when one plays a game with ALSA as music driver,
+		// does RTL and starts a different engine game with ALSA as music driver.
+		// In this case the MPU401 code will add different timer procs with the
+		// same name, resulting in two different callbacks added with the same
+		// name and causing installTimerProc to error out.
+		// A good test case is running a SCUMM with ALSA output and then a KYRA
+		// game for example.
+		for (TimerSlotMap::iterator i = _callbacks.begin(), end = _callbacks.end(); i != end; ++i) {
+			if (i->_value == callback)
+				_callbacks.erase(i);
+		}
+
+		running = (_runningProc == callback);
 	}
 
-	// We need to remove all names referencing the timer proc here.
-	//
-	// Else we run into troubles, when the client code removes and readds timer
-	// callbacks.
-	//
-	// Another issues occurs when one plays a game with ALSA as music driver,
-	// does RTL and starts a different engine game with ALSA as music driver.
-	// In this case the MPU401 code will add different timer procs with the
-	// same name, resulting in two different callbacks added with the same
-	// name and causing installTimerProc to error out.
-	// A good test case is running a SCUMM with ALSA output and then a KYRA
-	// game for example.
-	for (TimerSlotMap::iterator i = _callbacks.begin(), end = _callbacks.end(); i != end; ++i) {
-		if (i->_value == callback)
-			_callbacks.erase(i);
+	// Wait for the callback to return if handler() is invoking it in
+	// another thread right now. If the callback removes itself, this
+	// thread holds _handlerMutex already, which is fine as it is
+	// recursive.
+	if (running) {
+		Common::StackLock wait(_handlerMutex);
 	}
 }
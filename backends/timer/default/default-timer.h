@@ -24,6 +24,7 @@
 #define BACKENDS_TIMER_DEFAULT_H
 
 #include "common/str.h"
+#include "common/array.h"
 #include "common/hash-str.h"
 #include "common/timer.h"
 #include "common/mutex.h"
@@ -31,12 +32,43 @@
 struct TimerSlot;
 
 class DefaultTimerManager : public Common::TimerManager {
+public:
+	enum {
+		kJitterBuckets = 8
+	};
+
 private:
 	typedef Common::HashMap<Common::String, TimerProc, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> TimerSlotMap;
 
+	/** Protects the timer slots and the jitter histogram. */
 	Common::Mutex _mutex;
-	TimerSlot *_head;
+	/** Held while handler() runs, so that the callbacks are not invoked concurrently. */
+	Common::Mutex _handlerMutex;
+	/** Min-heap of the timer slots, ordered by their next fire time. */
+	Common::Array<TimerSlot *> _slots;
 	TimerSlotMap _callbacks;
+	/** Callback which handler() is currently invoking, if any. */
+	TimerProc _runningProc;
+
+	uint32 _jitterHistogram[kJitterBuckets];
+
+	void siftUp(uint index);
+	void siftDown(uint index);
+
+protected:
+	/**
+	 * Returns the current time in microseconds, which all fire times are
+	 * based on. Backends with a more precise monotonic clock than
+	 * OSystem::getMillis() should override this.
+	 */
+	virtual uint64 getMicros();
+
+	/**
+	 * Invoked when a timer which fires earlier than all others has been
+	 * installed. Backends which wait for the next fire time should wake
+	 * up and call getNextFireTime() again.
+	 */
+	virtual void scheduleChanged() {}
 
 public:
 	DefaultTimerManager();
@@ -46,8 +78,30 @@ public:
 
 	/**
 	 * Timer callback, to be invoked at regular time intervals by the backend.
+	 * Invokes all callbacks which are due, without holding the lock which
+	 * protects the timer slots.
 	 */
 	void handler();
+
+	/**
+	 * Returns the time (as given by getMicros()) at which the next timer
+	 * has to fire, or 0 if there are no timers.
+	 */
+	uint64 getNextFireTime();
+
+	/**
+	 * Returns the upper bound, in microseconds, of a bucket of the jitter
+	 * histogram. The last bucket has no upper bound.
+	 */
+	static uint32 getJitterBucketLimit(int bucket);
+
+	/**
+	 * Copies the jitter histogram into histogram, which must have room for
+	 * kJitterBuckets entries. Each entry counts the callbacks which were
+	 * invoked up to the limit of the bucket too late.
+	 */
+	void getJitterHistogram(uint32 *histogram);
+	void resetJitterHistogram();
 };
 
 #endif
@@ -34,19 +34,105 @@ static Uint32 timer_handler(Uint32 interval, void *param) {
 	return interval;
 }
 
-SdlTimerManager::SdlTimerManager() {
+SdlTimerManager::SdlTimerManager()
+	: _timerID(0), _thread(0), _quit(false), _scheduleChanged(false) {
 	// Initializes the SDL timer subsystem
 	if (SDL_InitSubSystem(SDL_INIT_TIMER) == -1) {
 		error("Could not initialize SDL: %s", SDL_GetError());
 	}
 
-	// Creates the timer callback
-	_timerID = SDL_AddTimer(10, &timer_handler, this);
+	_threadMutex = SDL_CreateMutex();
+	_threadCond = SDL_CreateCond();
+
+	// Creates the timer thread
+	if (_threadMutex && _threadCond) {
+#if SDL_VERSION_ATLEAST(1, 3, 0)
+		_thread = SDL_CreateThread(timerThreadEntry, "ScummVM timer", this);
+#else
+		_thread = SDL_CreateThread(timerThreadEntry, this);
+#endif
+	}
+
+	// Fall back to polling the timers every 10ms
+	if (!_thread) {
+		warning("Could not create timer thread: %s", SDL_GetError());
+		_timerID = SDL_AddTimer(10, &timer_handler, this);
+	}
 }
 
 SdlTimerManager::~SdlTimerManager() {
-	// Removes the timer callback
-	SDL_RemoveTimer(_timerID);
+	// Stops the timer thread, or removes the timer callback
+	if (_thread) {
+		SDL_LockMutex(_threadMutex);
+		_quit = true;
+		SDL_CondSignal(_threadCond);
+		SDL_UnlockMutex(_threadMutex);
+
+		SDL_WaitThread(_thread, NULL);
+	} else {
+		SDL_RemoveTimer(_timerID);
+	}
+
+	if (_threadCond)
+		SDL_DestroyCond(_threadCond);
+	if (_threadMutex)
+		SDL_DestroyMutex(_threadMutex);
+}
+
+uint64 SdlTimerManager::getMicros() {
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+	// Split the conversion, so that it does not overflow with nanosecond
+	// resolution counters
+	const uint64 counter = SDL_GetPerformanceCounter();
+	const uint64 frequency = SDL_GetPerformanceFrequency();
+	return (counter / frequency) * 1000000 + (counter % frequency) * 1000000 / frequency;
+#else
+	return DefaultTimerManager::getMicros();
+#endif
+}
+
+void SdlTimerManager::scheduleChanged() {
+	if (!_thread)
+		return;
+
+	SDL_LockMutex(_threadMutex);
+	_scheduleChanged = true;
+	SDL_CondSignal(_threadCond);
+	SDL_UnlockMutex(_threadMutex);
+}
+
+int SdlTimerManager::timerThreadEntry(void *data) {
+	((SdlTimerManager *)data)->timerThread();
+	return 0;
+}
+
+void SdlTimerManager::timerThread() {
+	SDL_LockMutex(_threadMutex);
+	while (!_quit) {
+		SDL_UnlockMutex(_threadMutex);
+		handler();
+		const uint64 nextFireTime = getNextFireTime();
+		SDL_LockMutex(_threadMutex);
+
+		// A timer which is due earlier may have been installed meanwhile
+		if (_scheduleChanged || _quit) {
+			_scheduleChanged = false;
+			continue;
+		}
+
+		// Sleep until the next timer is due, rounding up so that we do not
+		// wake up too early. installTimerProc() and the destructor wake us
+		// up earlier if needed.
+		if (!nextFireTime) {
+			SDL_CondWait(_threadCond, _threadMutex);
+		} else {
+			const uint64 curTime = getMicros();
+			if (nextFireTime > curTime)
+				SDL_CondWaitTimeout(_threadCond, _threadMutex, (Uint32)((nextFireTime - curTime + 999) / 1000));
+		}
+		_scheduleChanged = false;
+	}
+	SDL_UnlockMutex(_threadMutex);
 }
 
 #endif
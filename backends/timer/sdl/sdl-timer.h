@@ -28,8 +28,8 @@
 #include "backends/platform/sdl/sdl-sys.h"
 
 /**
- * SDL timer manager. Setups the timer callback for
- * DefaultTimerManager.
+ * SDL timer manager. Runs DefaultTimerManager::handler() on a thread of its
+ * own, which sleeps until the next timer is due.
  */
 class SdlTimerManager : public DefaultTimerManager {
 public:
@@ -37,7 +37,21 @@ public:
 	virtual ~SdlTimerManager();
 
 protected:
+	/** Fallback timer, used if the timer thread can not be started. */
 	SDL_TimerID _timerID;
+
+	SDL_Thread *_thread;
+	SDL_mutex *_threadMutex;
+	SDL_cond *_threadCond;
+	bool _quit;
+	bool _scheduleChanged;
+
+	virtual uint64 getMicros();
+	virtual void scheduleChanged();
+
+private:
+	static int timerThreadEntry(void *data);
+	void timerThread();
 };
 
 
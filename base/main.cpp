@@ -78,6 +78,9 @@
 
 static bool launcherDialog() {
 
+	// The launcher lists the games of all engines
+	PluginManager::instance().loadAllPlugins(); // only for cached manager
+
 	// Discard any command line options. Those that affect the graphics
 	// mode and the others (like bootparam etc.) should not
 	// blindly be passed to the first game launched from the launcher.
@@ -380,7 +383,8 @@ extern "C" int scummvm_main(int argc, const char * const argv[]) {
 	}
 
 	PluginManager::instance().init();
- 	PluginManager::instance().loadAllPlugins(); // load plugins for cached plugin manager
+	// Engine plugin files are loaded once a game or the launcher needs them
+ 	PluginManager::instance().loadNonFilePlugins(); // load plugins for cached plugin manager
 
 	// If we received an invalid music parameter via command line we check this here.
 	// We can't check this before loading the music plugins.
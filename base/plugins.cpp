@@ -229,7 +229,7 @@ PluginManager &PluginManager::instance() {
 	return *_instance;
 }
 
-PluginManager::PluginManager() {
+PluginManager::PluginManager() : _pluginFilesChanged(false), _allPluginsLoaded(false), _enginePluginFilesDeferred(false) {
 	// Always add the static plugin provider.
 	addPluginProvider(new StaticPluginProvider());
 }
@@ -324,20 +324,35 @@ bool PluginManagerUncached::loadPluginByFileName(const Common::String &filename)
 }
 
 /**
- * Update the config manager with a plugin file name that we found can handle
- * the game.
+ * Record in the config manager that a plugin file can handle a game. The
+ * config file is only written by flushPluginFiles(), or by the caller.
  **/
-void PluginManagerUncached::updateConfigWithFileName(const Common::String &gameId) {
-	// Check if we have a filename for the current plugin
-	if ((*_currentPlugin)->getFileName()) {
-		if (!ConfMan.hasMiscDomain("plugin_files"))
-			ConfMan.addMiscDomain("plugin_files");
+void PluginManager::updateConfigWithPluginFile(const Plugin *plugin, const Common::String &gameId) {
+	// Check if we have a filename for the plugin
+	const char *filename = plugin->getFileName();
+	if (!filename || gameId.empty())
+		return;
 
-		Common::ConfigManager::Domain *domain = ConfMan.getDomain("plugin_files");
-		assert(domain);
-		(*domain)[gameId] = (*_currentPlugin)->getFileName();
+	if (!ConfMan.hasMiscDomain("plugin_files"))
+		ConfMan.addMiscDomain("plugin_files");
 
+	Common::ConfigManager::Domain *domain = ConfMan.getDomain("plugin_files");
+	assert(domain);
+
+	if (!domain->contains(gameId) || (*domain)[gameId] != filename) {
+		(*domain)[gameId] = filename;
+		_pluginFilesChanged = true;
+	}
+}
+
+/**
+ * Write the config file if plugin files have been recorded since the last
+ * time.
+ **/
+void PluginManager::flushPluginFiles() {
+	if (_pluginFilesChanged) {
 		ConfMan.flushToDisk();
+		_pluginFilesChanged = false;
 	}
 }
 
@@ -370,12 +385,105 @@ bool PluginManagerUncached::loadNextPlugin() {
  * one plugin in memory at a time.
  **/
 void PluginManager::loadAllPlugins() {
+	if (_allPluginsLoaded)
+		return;
+
+	for (ProviderList::iterator pp = _providers.begin();
+	                            pp != _providers.end();
+	                            ++pp) {
+		// The other plugins were loaded by loadNonFilePlugins() already
+		if (_enginePluginFilesDeferred && !(*pp)->isFilePluginProvider())
+			continue;
+
+		PluginList pl((*pp)->getPlugins());
+		for (PluginList::iterator p = pl.begin(); p != pl.end(); ++p) {
+			// Keep plugin files already in memory, e.g. the one of a
+			// running game, instead of replacing them with a new copy
+			if ((*p)->getFileName() && isPluginFileLoaded((*p)->getFileName()))
+				delete *p;
+			else
+				tryLoadPlugin(*p);
+		}
+	}
+
+	_allPluginsLoaded = true;
+	_enginePluginFilesDeferred = false;
+}
+
+/**
+ * Used by only the cached plugin manager. Loads all plugins except the
+ * engine plugin files, which are only loaded once they are needed: either
+ * the one recorded for a game by loadPluginFromGameId(), or all of them by
+ * loadAllPlugins().
+ **/
+void PluginManager::loadNonFilePlugins() {
 	for (ProviderList::iterator pp = _providers.begin();
 	                            pp != _providers.end();
 	                            ++pp) {
+		if ((*pp)->isFilePluginProvider()) {
+			_enginePluginFilesDeferred = true;
+			continue;
+		}
+
 		PluginList pl((*pp)->getPlugins());
 		Common::for_each(pl.begin(), pl.end(), Common::bind1st(Common::mem_fun(&PluginManager::tryLoadPlugin), this));
 	}
+
+	_allPluginsLoaded = !_enginePluginFilesDeferred;
+}
+
+/**
+ * Used by only the cached plugin manager, as long as the engine plugin files
+ * have not all been loaded. Loads the plugin file recorded for the game in
+ * the 'plugin_files' domain.
+ **/
+bool PluginManager::loadPluginFromGameId(const Common::String &gameId) {
+	if (!_enginePluginFilesDeferred)
+		return false;
+
+	Common::ConfigManager::Domain *domain = ConfMan.getDomain("plugin_files");
+	if (!domain || !domain->contains(gameId))
+		return false;
+
+	const Common::String &filename = (*domain)[gameId];
+	if (filename.empty() || isPluginFileLoaded(filename))
+		return false;
+
+	bool found = false;
+	for (ProviderList::iterator pp = _providers.begin();
+	                            pp != _providers.end();
+	                            ++pp) {
+		if (!(*pp)->isFilePluginProvider())
+			continue;
+
+		PluginList pl((*pp)->getPlugins());
+		for (PluginList::iterator p = pl.begin(); p != pl.end(); ++p) {
+			if (!found && filename == (*p)->getFileName())
+				found = tryLoadPlugin(*p);
+			else
+				delete *p;
+		}
+	}
+	return found;
+}
+
+/**
+ * Used by only the cached plugin manager. Makes sure that all engine plugins
+ * are in memory before they are searched, unless they have been unloaded
+ * for running a game.
+ **/
+void PluginManager::loadFirstPlugin() {
+	if (_enginePluginFilesDeferred)
+		loadAllPlugins();
+}
+
+bool PluginManager::isPluginFileLoaded(const Common::String &filename) const {
+	const PluginList &engines = _pluginsInMem[PLUGIN_TYPE_ENGINE];
+	for (PluginList::const_iterator p = engines.begin(); p != engines.end(); ++p) {
+		if ((*p)->getFileName() && filename == (*p)->getFileName())
+			return true;
+	}
+	return false;
 }
 
 void PluginManager::unloadAllPlugins() {
@@ -384,6 +492,10 @@ void PluginManager::unloadAllPlugins() {
 }
 
 void PluginManager::unloadPluginsExcept(PluginType type, const Plugin *plugin, bool deletePlugin /*=true*/) {
+	// Whatever is unloaded here is loaded again by loadAllPlugins()
+	_allPluginsLoaded = false;
+	_enginePluginFilesDeferred = false;
+
 	Plugin *found = NULL;
 	for (PluginList::iterator p = _pluginsInMem[type].begin(); p != _pluginsInMem[type].end(); ++p) {
 		if (*p == plugin) {
@@ -445,6 +557,7 @@ void PluginManager::addToPluginsInMemList(Plugin *plugin) {
 // Engine plugins
 
 #include "engines/metaengine.h"
+#include "engines/advancedDetector.h"
 
 namespace Common {
 DECLARE_SINGLETON(EngineManager);
@@ -479,10 +592,15 @@ GameDescriptor EngineManager::findGame(const Common::String &gameName, const Eng
 	// We failed to find it using the gameid. Scan the list of plugins
 	PluginMan.loadFirstPlugin();
 	do {
-		result = findGameInLoadedPlugins(gameName, plugin);
+		const EnginePlugin *found;
+		result = findGameInLoadedPlugins(gameName, &found);
+		if (plugin)
+			*plugin = found;
+
 		if (!result.gameid().empty()) {
 			// Update with new plugin file name
-			PluginMan.updateConfigWithFileName(gameName);
+			PluginMan.updateConfigWithPluginFile(found, gameName);
+			PluginMan.flushPluginFiles();
 			break;
 		}
 	} while (PluginMan.loadNextPlugin());
@@ -518,6 +636,10 @@ GameList EngineManager::detectGames(const Common::FSList &fslist) const {
 	GameList candidates;
 	EnginePlugin::List plugins;
 	EnginePlugin::List::const_iterator iter;
+
+	// Let the engines share the MD5s of the files they have in common
+	AdvancedDetector::beginDetectionPass();
+
 	PluginManager::instance().loadFirstPlugin();
 	do {
 		plugins = getPlugins();
@@ -527,6 +649,8 @@ GameList EngineManager::detectGames(const Common::FSList &fslist) const {
 			candidates.push_back((**iter)->detectGames(fslist));
 		}
 	} while (PluginManager::instance().loadNextPlugin());
+
+	AdvancedDetector::endDetectionPass();
 	return candidates;
 }
 
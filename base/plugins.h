@@ -311,9 +311,13 @@ protected:
 
 	PluginList _pluginsInMem[PLUGIN_TYPE_MAX];
 	ProviderList _providers;
+	bool _pluginFilesChanged;
+	bool _allPluginsLoaded;
+	bool _enginePluginFilesDeferred;	///< Only loadNonFilePlugins() was called
 
 	bool tryLoadPlugin(Plugin *plugin);
 	void addToPluginsInMemList(Plugin *plugin);
+	bool isPluginFileLoaded(const Common::String &filename) const;
 
 	static PluginManager *_instance;
 	PluginManager();
@@ -328,12 +332,16 @@ public:
 
 	// Functions used by the uncached PluginManager
 	virtual void init()	{}
-	virtual void loadFirstPlugin() {}
 	virtual bool loadNextPlugin() { return false; }
-	virtual bool loadPluginFromGameId(const Common::String &gameId) { return false; }
-	virtual void updateConfigWithFileName(const Common::String &gameId) {}
+
+	// Functions used by both PluginManagers
+	virtual void loadFirstPlugin();
+	virtual bool loadPluginFromGameId(const Common::String &gameId);
+	void updateConfigWithPluginFile(const Plugin *plugin, const Common::String &gameId);
+	void flushPluginFiles();
 
 	// Functions used only by the cached PluginManager
+	virtual void loadNonFilePlugins();
 	virtual void loadAllPlugins();
 	void unloadAllPlugins();
 
@@ -360,8 +368,8 @@ public:
 	virtual void loadFirstPlugin();
 	virtual bool loadNextPlugin();
 	virtual bool loadPluginFromGameId(const Common::String &gameId);
-	virtual void updateConfigWithFileName(const Common::String &gameId);
 
+	virtual void loadNonFilePlugins() {}	// init() loads those
 	virtual void loadAllPlugins() {} 	// we don't allow this
 };
 
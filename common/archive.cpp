@@ -22,6 +22,7 @@
 
 #include "common/archive.h"
 #include "common/fs.h"
+#include "common/stream.h"
 #include "common/system.h"
 #include "common/textconsole.h"
 
@@ -61,6 +62,10 @@ int Archive::listMatchingMembers(ArchiveMemberList &list, const String &pattern)
 }
 
 
+bool Archive::prefetchMember(const String &name) const {
+	return false;
+}
+
 
 SearchSet::ArchiveNodeList::iterator SearchSet::find(const String &name) {
 	ArchiveNodeList::iterator it = _list.begin();
@@ -92,6 +97,7 @@ void SearchSet::insert(const Node &node) {
 			break;
 	}
 	_list.insert(it, node);
+	_index.clear();
 }
 
 void SearchSet::add(const String &name, Archive *archive, int priority, bool autoFree) {
@@ -174,6 +180,7 @@ void SearchSet::remove(const String &name) {
 		if (it->_autoFree)
 			delete it->_arc;
 		_list.erase(it);
+		_index.clear();
 	}
 }
 
@@ -188,6 +195,7 @@ void SearchSet::clear() {
 	}
 
 	_list.clear();
+	_index.clear();
 }
 
 void SearchSet::setPriority(const String &name, int priority) {
@@ -206,17 +214,39 @@ void SearchSet::setPriority(const String &name, int priority) {
 	insert(node);
 }
 
-bool SearchSet::hasFile(const String &name) const {
-	if (name.empty())
-		return false;
+void SearchSet::setIndexed(bool indexed) {
+	_indexed = indexed;
+	_index.clear();
+}
+
+Archive *SearchSet::findArchive(const String &name) const {
+	if (_indexed) {
+		MemberIndex::const_iterator indexed = _index.find(name);
+		if (indexed != _index.end())
+			return indexed->_value;
+	}
+
+	Archive *archive = 0;
 
 	ArchiveNodeList::const_iterator it = _list.begin();
 	for ( ; it != _list.end(); ++it) {
-		if (it->_arc->hasFile(name))
-			return true;
+		if (it->_arc->hasFile(name)) {
+			archive = it->_arc;
+			break;
+		}
 	}
 
-	return false;
+	if (_indexed)
+		_index[name] = archive;
+
+	return archive;
+}
+
+bool SearchSet::hasFile(const String &name) const {
+	if (name.empty())
+		return false;
+
+	return findArchive(name) != 0;
 }
 
 int SearchSet::listMatchingMembers(ArchiveMemberList &list, const String &pattern) const {
@@ -243,29 +273,78 @@ const ArchiveMemberPtr SearchSet::getMember(const String &name) const {
 	if (name.empty())
 		return ArchiveMemberPtr();
 
-	ArchiveNodeList::const_iterator it = _list.begin();
-	for ( ; it != _list.end(); ++it) {
-		if (it->_arc->hasFile(name))
-			return it->_arc->getMember(name);
-	}
+	Archive *archive = findArchive(name);
+	if (!archive)
+		return ArchiveMemberPtr();
 
-	return ArchiveMemberPtr();
+	return archive->getMember(name);
 }
 
 SeekableReadStream *SearchSet::createReadStreamForMember(const String &name) const {
 	if (name.empty())
 		return 0;
 
+	Archive *indexedArchive = 0;
+
+	if (_indexed) {
+		indexedArchive = findArchive(name);
+		if (!indexedArchive)
+			return 0;
+
+		SeekableReadStream *stream = indexedArchive->createReadStreamForMember(name);
+		if (stream)
+			return stream;
+
+		// The archive claims to have the member but could not open it.
+		// Try the others, like the unindexed search would.
+	}
+
 	ArchiveNodeList::const_iterator it = _list.begin();
 	for ( ; it != _list.end(); ++it) {
+		if (it->_arc == indexedArchive)
+			continue;
+
 		SeekableReadStream *stream = it->_arc->createReadStreamForMember(name);
-		if (stream)
+		if (stream) {
+			if (_indexed)
+				_index[name] = it->_arc;
 			return stream;
+		}
 	}
 
 	return 0;
 }
 
+bool SearchSet::prefetchMember(const String &name) const {
+	if (name.empty())
+		return false;
+
+	Archive *archive = findArchive(name);
+	if (!archive)
+		return false;
+
+	if (archive->prefetchMember(name)) {
+		_prefetchHits++;
+		return true;
+	}
+
+	_prefetchMisses++;
+	return false;
+}
+
+int SearchSet::prefetchMatchingMembers(const String &pattern) const {
+	ArchiveMemberList list;
+	listMatchingMembers(list, pattern);
+
+	int misses = 0;
+	for (ArchiveMemberList::const_iterator it = list.begin(); it != list.end(); ++it) {
+		if (!prefetchMember((*it)->getName()))
+			misses++;
+	}
+
+	return misses;
+}
+
 
 SearchManager::SearchManager() {
 	clear();	// Force a reset
@@ -24,6 +24,7 @@
 #define COMMON_ARCHIVE_H
 
 #include "common/str.h"
+#include "common/hash-str.h"
 #include "common/list.h"
 #include "common/ptr.h"
 #include "common/singleton.h"
@@ -117,6 +118,18 @@ public:
 	 * @return the newly created input stream
 	 */
 	virtual SeekableReadStream *createReadStreamForMember(const String &name) const = 0;
+
+	/**
+	 * Hints that the member with the specified name is going to be read
+	 * soon, so that its data can be loaded in the background. The default
+	 * implementation does nothing, as opening a member may already mean
+	 * loading or decompressing it. Archives which can pass the hint on
+	 * cheaply should override this.
+	 *
+	 * @return true if the data of the member is already in memory, false if
+	 *         it still has to be loaded or if the member does not exist
+	 */
+	virtual bool prefetchMember(const String &name) const;
 };
 
 
@@ -146,7 +159,19 @@ class SearchSet : public Archive {
 	// Add an archive keeping the list sorted by descending priority.
 	void insert(const Node& node);
 
+	// Archive providing each name looked up so far, or 0 if none has it.
+	typedef HashMap<String, Archive *, IgnoreCase_Hash, IgnoreCase_EqualTo> MemberIndex;
+	bool _indexed;
+	mutable MemberIndex _index;
+
+	// Find the archive with the highest priority providing a file.
+	Archive *findArchive(const String &name) const;
+
+	mutable uint32 _prefetchHits;
+	mutable uint32 _prefetchMisses;
+
 public:
+	SearchSet() : _indexed(false), _prefetchHits(0), _prefetchMisses(0) {}
 	virtual ~SearchSet() { clear(); }
 
 	/**
@@ -230,6 +255,19 @@ public:
 	 */
 	void setPriority(const String& name, int priority);
 
+	/**
+	 * Enable or disable the member index. When it is enabled, the archive
+	 * providing a file (or the fact that no archive provides it) is
+	 * remembered the first time its name is looked up, so that further
+	 * lookups of that name take a single hash probe instead of querying
+	 * every archive. The index is dropped whenever an archive is added,
+	 * removed or reprioritized.
+	 *
+	 * Only enable it if the contents of the archives in the set do not
+	 * change afterwards.
+	 */
+	void setIndexed(bool indexed);
+
 	virtual bool hasFile(const String &name) const;
 	virtual int listMatchingMembers(ArchiveMemberList &list, const String &pattern) const;
 	virtual int listMembers(ArchiveMemberList &list) const;
@@ -241,6 +279,28 @@ public:
 	 * opening the first file encountered that matches the name.
 	 */
 	virtual SeekableReadStream *createReadStreamForMember(const String &name) const;
+
+	/**
+	 * Hints that a file is going to be read soon, by passing the hint on
+	 * to the first archive providing it. Requests for files which are in
+	 * memory already are counted as hits, all others as misses.
+	 */
+	virtual bool prefetchMember(const String &name) const;
+
+	/**
+	 * Prefetch all files matching the given pattern.
+	 *
+	 * @return the number of files which are not in memory yet
+	 */
+	int prefetchMatchingMembers(const String &pattern) const;
+
+	/**
+	 * Get the number of prefetch requests which found the data in memory
+	 * already (hits), and the number of requests which had to load it
+	 * (misses), since the last call to resetPrefetchStats().
+	 */
+	void getPrefetchStats(uint32 &hits, uint32 &misses) const { hits = _prefetchHits; misses = _prefetchMisses; }
+	void resetPrefetchStats() { _prefetchHits = _prefetchMisses = 0; }
 };
 
 
@@ -0,0 +1,55 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef COMMON_ATOMIC_H
+#define COMMON_ATOMIC_H
+
+#include "common/scummsys.h"
+
+#if defined(_MSC_VER)
+// Pulls in intrin.h while working around its setjmp use
+#include "common/math.h"
+#endif
+
+namespace Common {
+
+/**
+ * Full memory barrier: no load or store may be reordered across it, neither
+ * by the compiler nor by the CPU.
+ *
+ * This is the only primitive the lock-free helpers in ScummVM rely on. On
+ * compilers we do not know about it degrades to nothing, which is still
+ * correct on single core targets.
+ */
+inline void memoryBarrier() {
+#if defined(__GNUC__)
+	__sync_synchronize();
+#elif defined(_MSC_VER)
+	// MSVC gives volatile accesses acquire/release semantics, and the
+	// x86 targets it supports do not reorder stores with other stores.
+	_ReadWriteBarrier();
+#endif
+}
+
+} // End of namespace Common
+
+#endif
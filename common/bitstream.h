@@ -64,9 +64,21 @@ public:
 	/** Read a multi-bit value from the bit stream, without changing the stream's position. */
 	virtual uint32 peekBits(uint8 n) = 0;
 
+	/**
+	 * Read a multi-bit value from the bit stream, without changing the stream's position.
+	 * Bits past the end of the stream are read as 0 instead of causing an error.
+	 *
+	 * @param n         Number of bits to read.
+	 * @param available Set to the number of bits that were actually in the stream.
+	 */
+	virtual uint32 peekBitsPadded(uint8 n, uint8 &available) = 0;
+
 	/** Add a bit to the value x, making it an n+1-bit value. */
 	virtual void addBit(uint32 &x, uint32 n) = 0;
 
+	/** Does the bit stream hand out the bits of each value from MSB to LSB? */
+	virtual bool isMSBFirst() const = 0;
+
 protected:
 	BitStream() {
 	}
@@ -127,6 +139,29 @@ private:
 			_value <<= 32 - valueBits;
 		}
 
+	/** Return the number of bits left in the current value. */
+	inline uint32 bitsInValue() const {
+		return (_inValue == 0) ? 0 : (valueBits - _inValue);
+	}
+
+	/** Return the next n bits of the current value, 0 < n < 32. */
+	inline uint32 valueBitsPeek(uint8 n) const {
+		if (isMSB2LSB)
+			return _value >> (32 - n);
+		else
+			return _value & (((uint32)1 << n) - 1);
+	}
+
+	/** Drop the next n bits of the current value, 0 < n < 32. */
+	inline void valueBitsSkip(uint8 n) {
+		if (isMSB2LSB)
+			_value <<= n;
+		else
+			_value >>= n;
+
+		_inValue = (_inValue + n) % valueBits;
+	}
+
 public:
 	/** Create a bit stream using this input data stream and optionally delete it on destruction. */
 	BitStreamImpl(SeekableReadStream *stream, bool disposeAfterUse = false) :
@@ -191,6 +226,13 @@ public:
 		if (n > 32)
 			error("BitStreamImpl::getBits(): Too many bits requested to be read");
 
+		// Fast path: all bits are within the current value
+		if (n <= bitsInValue()) {
+			uint32 v = valueBitsPeek(n);
+			valueBitsSkip(n);
+			return v;
+		}
+
 		// Read the number of bits
 		uint32 v = 0;
 
@@ -228,6 +270,10 @@ public:
 	 * The bit order is the same as in getBits().
 	 */
 	uint32 peekBits(uint8 n) {
+		// Fast path: all bits are within the current value
+		if (n > 0 && n <= bitsInValue())
+			return valueBitsPeek(n);
+
 		uint32 value   = _value;
 		uint8  inValue = _inValue;
 		uint32 curPos  = _stream->pos();
@@ -241,6 +287,31 @@ public:
 		return v;
 	}
 
+	/**
+	 * Read a multi-bit value from the bit stream, without changing the stream's position.
+	 * Bits past the end of the stream are read as 0.
+	 *
+	 * The bit order is the same as in getBits().
+	 */
+	uint32 peekBitsPadded(uint8 n, uint8 &available) {
+		// Fast path: all bits are within the current value
+		if (n > 0 && n <= bitsInValue()) {
+			available = n;
+			return valueBitsPeek(n);
+		}
+
+		uint32 left = size() - pos();
+		available = (left < n) ? left : n;
+
+		uint32 v = peekBits(available);
+
+		// Bits past the end of the stream come after the available ones
+		if (isMSB2LSB && available < n)
+			v = (available == 0) ? 0 : (v << (n - available));
+
+		return v;
+	}
+
 	/**
 	 * Add a bit to the value x, making it an n+1-bit value.
 	 *
@@ -272,10 +343,39 @@ public:
 
 	/** Skip the specified amount of bits. */
 	void skip(uint32 n) {
+		// Skip what's left of the current value
+		uint32 inValue = bitsInValue();
+		if (inValue > 0) {
+			if (n < inValue) {
+				if (n > 0)
+					valueBitsSkip(n);
+				return;
+			}
+
+			valueBitsSkip(inValue);
+			n -= inValue;
+		}
+
+		// Skip whole values in the data stream
+		if (n >= valueBits) {
+			uint32 values = n / valueBits;
+
+			if ((size() - pos()) < values * valueBits)
+				error("BitStreamImpl::skip(): End of bit stream reached");
+
+			_stream->skip(values * (valueBits / 8));
+			n -= values * valueBits;
+		}
+
 		while (n-- > 0)
 			getBit();
 	}
 
+	/** Does the bit stream hand out the bits of each value from MSB to LSB? */
+	bool isMSBFirst() const {
+		return isMSB2LSB;
+	}
+
 	/** Return the stream position in bits. */
 	uint32 pos() const {
 		if (_stream->pos() == 0)
@@ -141,6 +141,16 @@ uint32 File::read(void *ptr, uint32 len) {
 	return _handle->read(ptr, len);
 }
 
+const byte *File::getDirectPointer(uint32 offset, uint32 len) const {
+	assert(_handle);
+	return _handle->getDirectPointer(offset, len);
+}
+
+bool File::prefetch(uint32 offset, uint32 len) {
+	assert(_handle);
+	return _handle->prefetch(offset, len);
+}
+
 
 DumpFile::DumpFile() : _handle(0) {
 }
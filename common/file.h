@@ -126,6 +126,8 @@ public:
 	int32 size() const;	// implement abstract SeekableReadStream method
 	bool seek(int32 offs, int whence = SEEK_SET);	// implement abstract SeekableReadStream method
 	uint32 read(void *dataPtr, uint32 dataSize);	// implement abstract SeekableReadStream method
+	const byte *getDirectPointer(uint32 offset, uint32 len) const;
+	bool prefetch(uint32 offset, uint32 len);
 };
 
 
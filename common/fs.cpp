@@ -21,6 +21,7 @@
  */
 
 #include "common/system.h"
+#include "common/stream.h"
 #include "common/textconsole.h"
 #include "backends/fs/abstract-fs.h"
 #include "backends/fs/fs-factory.h"
@@ -237,6 +238,24 @@ SeekableReadStream *FSDirectory::createReadStreamForMember(const String &name) c
 	return stream;
 }
 
+bool FSDirectory::prefetchMember(const String &name) const {
+	if (name.empty() || !_node.isDirectory())
+		return false;
+
+	FSNode *node = lookupCache(_fileCache, name);
+	if (!node)
+		return false;
+
+	// Opening a plain file does not read it, so this is cheap
+	SeekableReadStream *stream = node->createReadStream();
+	if (!stream)
+		return false;
+
+	const bool inMemory = stream->prefetch(0, stream->size());
+	delete stream;
+	return inMemory;
+}
+
 FSDirectory *FSDirectory::getSubDirectory(const String &name, int depth, bool flat) {
 	return getSubDirectory(String(), name, depth, flat);
 }
@@ -342,6 +342,11 @@ public:
 	 * for success.
 	 */
 	virtual SeekableReadStream *createReadStreamForMember(const String &name) const;
+
+	/**
+	 * Open the specified file and pass the prefetch hint on to its stream.
+	 */
+	virtual bool prefetchMember(const String &name) const;
 };
 
 
@@ -58,6 +58,11 @@ Huffman::Huffman(uint8 maxLength, uint32 codeCount, const uint32 *codes, const u
 		// And put the pointer to the symbol/code struct into the symbol list.
 		_symbols[i] = &_codes[lengths[i] - 1].back();
 	}
+
+	_lookupBits = MIN<uint8>(maxLength, kLookupBits);
+
+	buildLookupTable(_lookupMSB, true);
+	buildLookupTable(_lookupLSB, false);
 }
 
 Huffman::~Huffman() {
@@ -66,9 +71,153 @@ Huffman::~Huffman() {
 void Huffman::setSymbols(const uint32 *symbols) {
 	for (uint32 i = 0; i < _symbols.size(); i++)
 		_symbols[i]->symbol = symbols ? *symbols++ : i;
+
+	setLookupSymbols(_lookupMSB);
+	setLookupSymbols(_lookupLSB);
+}
+
+void Huffman::buildLookupTable(LookupTable &table, bool msbFirst) {
+	const uint32 lookupBits = _lookupBits;
+	const uint32 lookupSize = 1 << lookupBits;
+
+	LookupEntry empty;
+	empty.symbol = 0;
+	empty.code = 0;
+	empty.length = 0;
+	empty.subBits = 0;
+
+	table.resize(lookupSize);
+	for (uint32 i = 0; i < lookupSize; i++)
+		table[i] = empty;
+
+	// Codes are entered shortest first and in list order, which is the order
+	// getSymbolSlow() tries them in. An entry already taken by an earlier
+	// code is never overwritten, so both find the same code.
+
+	// Short codes fill all first-level entries starting with them
+	for (uint32 length = 1; length <= MIN<uint32>(lookupBits, _codes.size()); length++) {
+		const uint32 fill = 1 << (lookupBits - length);
+
+		for (CodeList::const_iterator cCode = _codes[length - 1].begin(); cCode != _codes[length - 1].end(); ++cCode) {
+			if (cCode->code >> length)
+				continue; // Can never match
+
+			for (uint32 i = 0; i < fill; i++) {
+				uint32 index = msbFirst ? ((cCode->code << (lookupBits - length)) | i) : (cCode->code | (i << length));
+				LookupEntry &entry = table[index];
+
+				if (entry.length == 0) {
+					entry.symbol = cCode->symbol;
+					entry.code = &*cCode;
+					entry.length = length;
+				}
+			}
+		}
+	}
+
+	if (_codes.size() <= lookupBits)
+		return;
+
+	// Size the second-level tables after the longest code behind each prefix
+	Array<uint8> maxLength;
+	maxLength.resize(lookupSize);
+	for (uint32 i = 0; i < lookupSize; i++)
+		maxLength[i] = 0;
+
+	for (uint32 length = lookupBits + 1; length <= _codes.size(); length++) {
+		for (CodeList::const_iterator cCode = _codes[length - 1].begin(); cCode != _codes[length - 1].end(); ++cCode) {
+			uint32 prefix = msbFirst ? (cCode->code >> (length - lookupBits)) : (cCode->code & (lookupSize - 1));
+
+			if ((length < 32 && (cCode->code >> length)) || table[prefix].length != 0)
+				continue; // Can never match, or hidden behind a shorter code
+
+			maxLength[prefix] = length;
+		}
+	}
+
+	for (uint32 prefix = 0; prefix < lookupSize; prefix++) {
+		if (maxLength[prefix] == 0)
+			continue;
+
+		uint32 subBits = maxLength[prefix] - lookupBits;
+
+		if (subBits > kMaxSubBits) {
+			table[prefix].subBits = kSubTableSlow;
+			continue;
+		}
+
+		uint32 offset = table.size();
+
+		table[prefix].symbol = offset;
+		table[prefix].subBits = subBits;
+
+		table.resize(offset + (1 << subBits));
+		for (uint32 i = offset; i < table.size(); i++)
+			table[i] = empty;
+	}
+
+	// Long codes fill all second-level entries starting with their remaining bits
+	for (uint32 length = lookupBits + 1; length <= _codes.size(); length++) {
+		for (CodeList::const_iterator cCode = _codes[length - 1].begin(); cCode != _codes[length - 1].end(); ++cCode) {
+			uint32 prefix = msbFirst ? (cCode->code >> (length - lookupBits)) : (cCode->code & (lookupSize - 1));
+
+			if ((length < 32 && (cCode->code >> length)) || maxLength[prefix] == 0 || table[prefix].subBits == kSubTableSlow)
+				continue;
+
+			const uint32 offset = table[prefix].symbol;
+			const uint32 subBits = table[prefix].subBits;
+			const uint32 restBits = length - lookupBits;
+			const uint32 fill = 1 << (subBits - restBits);
+			const uint32 rest = msbFirst ? (cCode->code & ((1 << restBits) - 1)) : (cCode->code >> lookupBits);
+
+			for (uint32 i = 0; i < fill; i++) {
+				uint32 index = offset + (msbFirst ? ((rest << (subBits - restBits)) | i) : (rest | (i << restBits)));
+				LookupEntry &entry = table[index];
+
+				if (entry.length == 0) {
+					entry.symbol = cCode->symbol;
+					entry.code = &*cCode;
+					entry.length = length;
+				}
+			}
+		}
+	}
+}
+
+void Huffman::setLookupSymbols(LookupTable &table) {
+	for (uint32 i = 0; i < table.size(); i++)
+		if (table[i].length != 0)
+			table[i].symbol = table[i].code->symbol;
 }
 
 uint32 Huffman::getSymbol(BitStream &bits) const {
+	const bool msbFirst = bits.isMSBFirst();
+	const LookupEntry *table = msbFirst ? &_lookupMSB[0] : &_lookupLSB[0];
+
+	uint8 available;
+	uint32 peek = bits.peekBitsPadded(_lookupBits, available);
+	const LookupEntry *entry = &table[peek];
+
+	if (entry->subBits != 0) {
+		if (entry->subBits == kSubTableSlow)
+			return getSymbolSlow(bits);
+
+		const uint8 subBits = entry->subBits;
+
+		peek = bits.peekBitsPadded(_lookupBits + subBits, available);
+		entry = &table[entry->symbol + (msbFirst ? (peek & ((1 << subBits) - 1)) : (peek >> _lookupBits))];
+	}
+
+	// Unknown codes and codes running past the end of the stream are
+	// left to the slow path, which reports them
+	if (entry->length == 0 || entry->length > available)
+		return getSymbolSlow(bits);
+
+	bits.skip(entry->length);
+	return entry->symbol;
+}
+
+uint32 Huffman::getSymbolSlow(BitStream &bits) const {
 	uint32 code = 0;
 
 	for (uint32 i = 0; i < _codes.size(); i++) {
@@ -70,11 +70,46 @@ private:
 	typedef Array<CodeList> CodeLists;
 	typedef Array<Symbol *> SymbolList;
 
+	/**
+	 * An entry of the lookup tables.
+	 *
+	 * Codes of up to kLookupBits bits are found with a single lookup of
+	 * the next kLookupBits bits in the first-level table. Longer codes
+	 * lead to a second-level table, indexed by the bits that follow.
+	 */
+	struct LookupEntry {
+		uint32 symbol;  ///< The symbol, or the offset of the second-level table.
+		const Symbol *code; ///< The code's entry in _codes.
+		uint8  length;  ///< Length of the code, 0 if none matches.
+		uint8  subBits; ///< Number of bits indexing the second-level table, 0 if none.
+	};
+
+	typedef Array<LookupEntry> LookupTable;
+
+	enum {
+		kLookupBits    =  9, ///< Bits looked up in the first-level table.
+		kMaxSubBits    = 12, ///< Maximum number of bits looked up in a second-level table.
+		kSubTableSlow  = 0xFF ///< subBits value of codes which are too long for a second-level table.
+	};
+
 	/** Lists of codes and their symbols, sorted by code length. */
 	CodeLists _codes;
 
 	/** Sorted list of pointers to the symbols. */
 	SymbolList _symbols;
+
+	/** Number of bits looked up in the first-level table. */
+	uint8 _lookupBits;
+
+	/** Lookup tables for streams with MSB to LSB and LSB to MSB bit order. */
+	LookupTable _lookupMSB;
+	LookupTable _lookupLSB;
+
+	void buildLookupTable(LookupTable &table, bool msbFirst);
+	void setLookupSymbols(LookupTable &table);
+
+	/** Return the next symbol by reading one bit at a time. */
+	uint32 getSymbolSlow(BitStream &bits) const;
 };
 
 } // End of namespace Common
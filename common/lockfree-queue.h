@@ -0,0 +1,113 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef COMMON_LOCKFREE_QUEUE_H
+#define COMMON_LOCKFREE_QUEUE_H
+
+#include "common/scummsys.h"
+#include "common/atomic.h"
+#include "common/noncopyable.h"
+
+namespace Common {
+
+/**
+ * Fixed size FIFO which one producer thread and one consumer thread can use
+ * concurrently without any locking.
+ *
+ * The producer may only call push() and full(), the consumer may only call
+ * pop() and empty(). If more than one thread needs to push (or pop), these
+ * threads have to serialize among themselves, e.g. through a Mutex; this
+ * still keeps the other side from ever waiting.
+ *
+ * @tparam T    element type, must be copy assignable
+ * @tparam SIZE capacity of the queue, must be a power of two
+ */
+template<class T, uint SIZE>
+class LockFreeQueue : NonCopyable {
+public:
+	LockFreeQueue() : _head(0), _tail(0) {
+		assert(SIZE > 0 && (SIZE & (SIZE - 1)) == 0);
+	}
+
+	/**
+	 * Append an element to the queue. Producer side only.
+	 *
+	 * @return false if the queue is full, in which case nothing is stored
+	 */
+	bool push(const T &x) {
+		const uint32 tail = _tail;
+		if (tail - _head == SIZE)
+			return false;
+
+		_storage[tail & (SIZE - 1)] = x;
+		// Make sure the element is visible before the consumer sees it
+		memoryBarrier();
+		_tail = tail + 1;
+		return true;
+	}
+
+	/**
+	 * Remove the oldest element from the queue. Consumer side only.
+	 *
+	 * @return false if the queue is empty, in which case x is untouched
+	 */
+	bool pop(T &x) {
+		const uint32 head = _head;
+		if (head == _tail)
+			return false;
+
+		memoryBarrier();
+		x = _storage[head & (SIZE - 1)];
+		// Make sure the element has been read before its slot is reused
+		memoryBarrier();
+		_head = head + 1;
+		return true;
+	}
+
+	bool empty() const {
+		return _head == _tail;
+	}
+
+	bool full() const {
+		return _tail - _head == SIZE;
+	}
+
+	uint size() const {
+		return _tail - _head;
+	}
+
+	uint capacity() const {
+		return SIZE;
+	}
+
+private:
+	T _storage[SIZE];
+
+	/** Index of the next element to pop, only written by the consumer. */
+	volatile uint32 _head;
+	/** Index of the next free slot, only written by the producer. */
+	volatile uint32 _tail;
+};
+
+} // End of namespace Common
+
+#endif
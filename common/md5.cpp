@@ -110,7 +110,14 @@ static void md5_process(md5_context *ctx, const uint8 data[64]) {
 
 #undef F
 
-#define F(x, y, z) (y ^ (z & (x ^ y)))
+#undef P
+
+// Split G(b,c,d) = (b & d) | (c & ~d) into two additions, so that only
+// the last one has to wait for the result of the previous step
+#define P(a, b, c, d, k, s, t)                                  \
+{                                                               \
+	a += X[k] + t + (c & ~d); a += b & d; a = S(a,s) + b;   \
+}
 
 	P(A, B, C, D,  1,  5, 0xF61E2562);
 	P(D, A, B, C,  6,  9, 0xC040B340);
@@ -129,7 +136,12 @@ static void md5_process(md5_context *ctx, const uint8 data[64]) {
 	P(C, D, A, B,  7, 14, 0x676F02D9);
 	P(B, C, D, A, 12, 20, 0x8D2A4C8A);
 
-#undef F
+#undef P
+
+#define P(a, b, c, d, k, s, t)                    \
+{                                                 \
+	a += F(b,c,d) + X[k] + t; a = S(a,s) + b; \
+}
 
 #define F(x, y, z) (x ^ y ^ z)
 
@@ -177,6 +189,9 @@ static void md5_process(md5_context *ctx, const uint8 data[64]) {
 	ctx->state[1] += B;
 	ctx->state[2] += C;
 	ctx->state[3] += D;
+
+#undef P
+#undef S
 }
 
 void md5_update(md5_context *ctx, const uint8 *input, uint32 length) {
@@ -244,6 +259,13 @@ void md5_finish(md5_context *ctx, uint8 digest[16]) {
 }
 
 
+enum {
+	// Number of bytes read from the stream at once. A multiple of the
+	// MD5 block size, so that md5_update() can hash the data in place
+	// instead of copying it into the context buffer.
+	kMD5ReadSize = 64 * 1024
+};
+
 bool computeStreamMD5(ReadStream &stream, uint8 digest[16], uint32 length) {
 
 #ifdef DISABLE_MD5
@@ -251,15 +273,20 @@ bool computeStreamMD5(ReadStream &stream, uint8 digest[16], uint32 length) {
 #else
 	md5_context ctx;
 	int i;
-	unsigned char buf[1000];
 	bool restricted = (length != 0);
 	uint32 readlen;
 
-	if (!restricted || sizeof(buf) <= length)
-		readlen = sizeof(buf);
+	if (!restricted || kMD5ReadSize <= length)
+		readlen = kMD5ReadSize;
 	else
 		readlen = length;
 
+	// Allocated on the heap, since the buffer is too large for the stack
+	// of some ports
+	uint8 *buf = (uint8 *)malloc(readlen);
+	if (!buf)
+		return false;
+
 	md5_starts(&ctx);
 
 	while ((i = stream.read(buf, readlen)) > 0) {
@@ -270,11 +297,13 @@ bool computeStreamMD5(ReadStream &stream, uint8 digest[16], uint32 length) {
 			if (length == 0)
 				break;
 
-			if (sizeof(buf) > length)
+			if (readlen > length)
 				readlen = length;
 		}
 	}
 
+	free(buf);
+
 	md5_finish(&ctx, digest);
 #endif
 	return true;
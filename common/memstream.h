@@ -70,6 +70,14 @@ public:
 	int32 size() const { return _size; }
 
 	bool seek(int32 offs, int whence = SEEK_SET);
+
+	const byte *getDirectPointer(uint32 offset, uint32 len) const {
+		if (offset > _size || len > _size - offset)
+			return 0;
+		return _ptrOrig + offset;
+	}
+
+	bool prefetch(uint32 offset, uint32 len) { return true; }
 };
 
 
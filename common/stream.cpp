@@ -25,6 +25,7 @@
 #include "common/memstream.h"
 #include "common/substream.h"
 #include "common/str.h"
+#include "common/util.h"
 
 namespace Common {
 
@@ -240,6 +241,20 @@ bool SeekableSubReadStream::seek(int32 offset, int whence) {
 	return ret;
 }
 
+const byte *SeekableSubReadStream::getDirectPointer(uint32 offset, uint32 len) const {
+	if (offset > _end - _begin || len > _end - _begin - offset)
+		return 0;
+
+	return _parentStream->getDirectPointer(_begin + offset, len);
+}
+
+bool SeekableSubReadStream::prefetch(uint32 offset, uint32 len) {
+	if (offset >= _end - _begin)
+		return true;
+
+	return _parentStream->prefetch(_begin + offset, MIN(len, _end - _begin - offset));
+}
+
 uint32 SafeSeekableSubReadStream::read(void *dataPtr, uint32 dataSize) {
 	// Make sure the parent stream is at the right position
 	seek(0, SEEK_CUR);
@@ -369,6 +384,8 @@ public:
 	virtual int32 size() const { return _parentStream->size(); }
 
 	virtual bool seek(int32 offset, int whence = SEEK_SET);
+
+	virtual bool prefetch(uint32 offset, uint32 len) { return _parentStream->prefetch(offset, len); }
 };
 
 BufferedSeekableReadStream::BufferedSeekableReadStream(SeekableReadStream *parentStream, uint32 bufSize, DisposeAfterUse::Flag disposeParentStream)
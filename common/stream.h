@@ -371,6 +371,32 @@ public:
 	 */
 	virtual bool skip(uint32 offset) { return seek(offset, SEEK_CUR); }
 
+	/**
+	 * Obtains a pointer to a range of the stream data, without copying it.
+	 * This is only possible for streams which keep all their data in
+	 * memory, e.g. a MemoryReadStream or a memory mapped file. The stream
+	 * position is not changed, and the pointer stays valid for as long as
+	 * the stream exists.
+	 *
+	 * @param offset	the start of the range, relative to the start of the stream
+	 * @param len		the length of the range in bytes
+	 * @return a pointer to the data, or 0 if the range can not be accessed directly
+	 */
+	virtual const byte *getDirectPointer(uint32 offset, uint32 len) const { return 0; }
+
+	/**
+	 * Hints that a range of the stream data is going to be read soon.
+	 * Streams backed by files may then start loading it in the background,
+	 * so that the actual reads do not have to wait for the storage. The
+	 * stream position is not changed.
+	 *
+	 * @param offset	the start of the range, relative to the start of the stream
+	 * @param len		the length of the range in bytes
+	 * @return true if the data is already in memory, false if it still has
+	 *         to be loaded or if the stream can not tell
+	 */
+	virtual bool prefetch(uint32 offset, uint32 len) { return false; }
+
 	/**
 	 * Reads at most one less than the number of characters specified
 	 * by bufSize from the and stores them in the string buf. Reading
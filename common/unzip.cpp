@@ -105,7 +105,11 @@ typedef struct {
 
 #include "common/fs.h"
 #include "common/unzip.h"
+#include "common/array.h"
 #include "common/memstream.h"
+#include "common/mutex.h"
+#include "common/ptr.h"
+#include "common/zlib.h"
 
 #include "common/hashmap.h"
 #include "common/hash-str.h"
@@ -376,10 +380,20 @@ typedef struct {
 typedef Common::HashMap<Common::String, cached_file_in_zip, Common::IgnoreCase_Hash,
 	Common::IgnoreCase_EqualTo> ZipHash;
 
+/* the zipfile stream, shared between the archive and the streams of its
+   members, which may outlive the archive */
+struct ZipSharedStream {
+	Common::ScopedPtr<Common::SeekableReadStream> _stream;
+	Common::Mutex _mutex;			/* to be held while seeking and reading _stream */
+
+	ZipSharedStream(Common::SeekableReadStream *stream) : _stream(stream) {}
+};
+
 /* unz_s contain internal information about the zipfile
 */
 typedef struct {
 	Common::SeekableReadStream *_stream;				/* io structore of the zipfile */
+	Common::SharedPtr<ZipSharedStream> _shared;		/* owner of _stream */
 	unz_global_info gi;				/* public global information */
 	uLong byte_before_the_zipfile;	/* byte before the zipfile, (>0 for sfx)*/
 	uLong num_file;					/* number of the current file in the zipfile*/
@@ -541,6 +555,7 @@ unzFile unzOpen(Common::SeekableReadStream *stream) {
 
 	int err=UNZ_OK;
 
+	us->_shared = Common::SharedPtr<ZipSharedStream>(new ZipSharedStream(stream));
 	us->_stream = stream;
 
 	central_pos = unzlocal_SearchCentralDir(*us->_stream);
@@ -593,7 +608,6 @@ unzFile unzOpen(Common::SeekableReadStream *stream) {
 		err=UNZ_BADZIPFILE;
 
 	if (err != UNZ_OK) {
-		delete us->_stream;
 		delete us;
 		return NULL;
 	}
@@ -642,7 +656,6 @@ int unzClose(unzFile file) {
 	if (s->pfile_in_zip_read != NULL)
 		unzCloseCurrentFile(file);
 
-	delete s->_stream;
 	delete s;
 	return UNZ_OK;
 }
@@ -1419,8 +1432,19 @@ namespace Common {
 
 
 class ZipArchive : public Archive {
+	enum {
+		// Deflated members up to this size are inflated into memory at once
+		kMaxInflatedMemberSize = 64 * 1024
+	};
+
 	unzFile _zipFile;
 
+	/**
+	 * Find a member and the offset of its data in the zipfile stream.
+	 * The shared mutex must be held.
+	 */
+	bool locateMember(const String &name, unz_file_info &fileInfo, uint32 &dataStart) const;
+
 public:
 	ZipArchive(unzFile zipFile);
 
@@ -1431,6 +1455,7 @@ public:
 	virtual int listMembers(ArchiveMemberList &list) const;
 	virtual const ArchiveMemberPtr getMember(const String &name) const;
 	virtual SeekableReadStream *createReadStreamForMember(const String &name) const;
+	virtual bool prefetchMember(const String &name) const;
 };
 
 /*
@@ -1451,6 +1476,260 @@ public:
 };
 */
 
+/**
+ * Stream over a single member of a ZIP file, which reads the data from the
+ * zipfile stream on demand. Any number of these may be used at the same
+ * time, and they may outlive their archive.
+ *
+ * Deflated members are inflated on the fly. Every kCheckpointInterval bytes
+ * of output, a copy of the state of the decompressor is saved, so that
+ * seeking only has to inflate from the closest checkpoint before the new
+ * position instead of from the start of the member.
+ */
+class ZipMemberReadStream : public SeekableReadStream {
+	enum {
+		kCheckpointInterval = 1024 * 1024
+	};
+
+	SharedPtr<ZipSharedStream> _zip;
+	const uint32 _dataStart;	///< Offset of the data in the zipfile
+	const uint32 _compressedSize;
+	const uint32 _size;
+	const bool _deflated;
+
+	uint32 _pos;
+	bool _eos;
+	bool _err;
+
+#ifdef USE_ZLIB
+	const uint32 _expectedCrc;
+	uint32 _crc;
+	uint32 _crcPos;	///< Amount of data covered by _crc
+
+	z_stream _stream;
+	bool _streamInitialized;
+	byte *_buffer;
+	uint32 _compressedPos;	///< Amount of compressed data read into _buffer so far
+	InflateCheckpoints _checkpoints;
+#endif
+
+	uint32 readStored(void *dataPtr, uint32 dataSize) {
+		StackLock lock(_zip->_mutex);
+
+		_zip->_stream->seek(_dataStart + _pos, SEEK_SET);
+		return _zip->_stream->read(dataPtr, dataSize);
+	}
+
+#ifdef USE_ZLIB
+	bool fillBuffer() {
+		const uint32 size = MIN<uint32>(UNZ_BUFSIZE, _compressedSize - _compressedPos);
+
+		StackLock lock(_zip->_mutex);
+
+		_zip->_stream->seek(_dataStart + _compressedPos, SEEK_SET);
+		if (_zip->_stream->read(_buffer, size) != size)
+			return false;
+
+		_compressedPos += size;
+		_stream.next_in = _buffer;
+		_stream.avail_in = size;
+		return true;
+	}
+
+	/** Restart inflating from the last checkpoint at or before pos. */
+	void restoreCheckpoint(uint32 pos) {
+		const uint32 checkpointPos = _checkpoints.find(pos);
+
+		inflateEnd(&_stream);
+		_streamInitialized = false;
+
+		if (checkpointPos == 0) {
+			_pos = 0;
+			_compressedPos = 0;
+			_streamInitialized = (inflateInit2(&_stream, -MAX_WBITS) == Z_OK);
+		} else {
+			_pos = checkpointPos;
+			_streamInitialized = (_checkpoints.restore(checkpointPos, &_stream, _compressedPos) == Z_OK);
+		}
+
+		if (!_streamInitialized)
+			_err = true;
+
+		_stream.avail_in = 0;
+	}
+
+	uint32 readDeflated(void *dataPtr, uint32 dataSize) {
+		byte *out = (byte *)dataPtr;
+		uint32 left = dataSize;
+
+		while (left > 0 && !_err) {
+			const uint32 outPos = _pos + dataSize - left;
+			if (outPos == _checkpoints.getNextPos())
+				_checkpoints.save(&_stream, _compressedPos - _stream.avail_in);
+
+			if (_stream.avail_in == 0 && _compressedPos < _compressedSize && !fillBuffer()) {
+				_err = true;
+				break;
+			}
+
+			// Stop at the next checkpoint, so that its state can be saved
+			const uint32 chunk = MIN(left, _checkpoints.getNextPos() - outPos);
+			_stream.next_out = out;
+			_stream.avail_out = chunk;
+
+			const int zlibErr = inflate(&_stream, Z_SYNC_FLUSH);
+			const uint32 produced = chunk - _stream.avail_out;
+			out += produced;
+			left -= produced;
+
+			if (zlibErr == Z_STREAM_END)
+				break;
+
+			// Z_BUF_ERROR only means that no progress was possible, which is
+			// an error once all of the compressed data has been used up
+			if (zlibErr != Z_OK && (zlibErr != Z_BUF_ERROR || produced == 0))
+				_err = true;
+		}
+
+		return dataSize - left;
+	}
+
+	void updateCrc(const void *dataPtr, uint32 size) {
+		// Only data read in sequence from the start can be checked
+		if (_pos != _crcPos)
+			return;
+
+		_crc = crc32(_crc, (const Bytef *)dataPtr, size);
+		_crcPos += size;
+
+		if (_crcPos == _size && _crc != _expectedCrc) {
+			warning("ZipMemberReadStream: CRC mismatch");
+			_err = true;
+		}
+	}
+#endif
+
+public:
+	ZipMemberReadStream(const SharedPtr<ZipSharedStream> &zip, uint32 dataStart, uint32 compressedSize, uint32 size, bool deflated, uint32 crc)
+		: _zip(zip), _dataStart(dataStart), _compressedSize(compressedSize), _size(size), _deflated(deflated),
+		  _pos(0), _eos(false), _err(false)
+#ifdef USE_ZLIB
+		  , _expectedCrc(crc), _crc(crc32(0, Z_NULL, 0)), _crcPos(0), _stream(), _streamInitialized(false), _buffer(0), _compressedPos(0),
+		  _checkpoints(kCheckpointInterval)
+#endif
+		  {
+
+		if (_deflated) {
+#ifdef USE_ZLIB
+			_buffer = (byte *)malloc(UNZ_BUFSIZE);
+			// Negative window bits, as there is no zlib header
+			_streamInitialized = _buffer && (inflateInit2(&_stream, -MAX_WBITS) == Z_OK);
+			if (!_streamInitialized)
+				_err = true;
+#else
+			_err = true;
+#endif
+		}
+	}
+
+	~ZipMemberReadStream() {
+#ifdef USE_ZLIB
+		if (_streamInitialized)
+			inflateEnd(&_stream);
+
+		free(_buffer);
+#endif
+	}
+
+	bool err() const { return _err; }
+	void clearErr() { _eos = false; }
+	bool eos() const { return _eos; }
+	int32 pos() const { return _pos; }
+	int32 size() const { return _size; }
+
+	uint32 read(void *dataPtr, uint32 dataSize) {
+		if (dataSize > _size - _pos) {
+			dataSize = _size - _pos;
+			_eos = true;
+		}
+
+		if (_err || dataSize == 0)
+			return 0;
+
+		uint32 size;
+#ifdef USE_ZLIB
+		if (_deflated)
+			size = readDeflated(dataPtr, dataSize);
+		else
+#endif
+			size = readStored(dataPtr, dataSize);
+
+		// The member is shorter than its directory entry claims
+		if (size != dataSize)
+			_err = true;
+
+#ifdef USE_ZLIB
+		updateCrc(dataPtr, size);
+#endif
+		_pos += size;
+		return size;
+	}
+
+	bool seek(int32 offset, int whence = SEEK_SET) {
+		int32 newPos = offset;
+		if (whence == SEEK_CUR)
+			newPos += _pos;
+		else if (whence == SEEK_END)
+			newPos += _size;
+
+		if (newPos < 0 || newPos > (int32)_size)
+			return false;
+
+		_eos = false;
+
+#ifdef USE_ZLIB
+		if (_deflated) {
+			// Go back to a checkpoint if needed, or if it is closer than
+			// the current position
+			if ((uint32)newPos < _pos || _checkpoints.find(newPos) > _pos)
+				restoreCheckpoint(newPos);
+
+			// Inflate the data up to the new position
+			byte tmpBuf[4096];
+			while (!_err && _pos < (uint32)newPos)
+				read(tmpBuf, MIN<uint32>(sizeof(tmpBuf), newPos - _pos));
+
+			return !_err;
+		}
+#endif
+
+		_pos = newPos;
+		return true;
+	}
+
+	const byte *getDirectPointer(uint32 offset, uint32 len) const {
+		// Stored members can be accessed in place if the zipfile itself can
+		if (_deflated || offset > _size || len > _size - offset)
+			return 0;
+
+		return _zip->_stream->getDirectPointer(_dataStart + offset, len);
+	}
+
+	bool prefetch(uint32 offset, uint32 len) {
+		if (offset >= _size)
+			return true;
+
+		StackLock lock(_zip->_mutex);
+
+		// There is no telling where a range of a deflated member ends up
+		// in the zipfile, so load all of its compressed data instead
+		if (_deflated)
+			return _zip->_stream->prefetch(_dataStart, _compressedSize);
+
+		return _zip->_stream->prefetch(_dataStart + offset, MIN(len, _size - offset));
+	}
+};
+
 ZipArchive::ZipArchive(unzFile zipFile) : _zipFile(zipFile) {
 	assert(_zipFile);
 }
@@ -1460,6 +1739,11 @@ ZipArchive::~ZipArchive() {
 }
 
 bool ZipArchive::hasFile(const String &name) const {
+	// Locating the file changes the current file of the archive, which
+	// createReadStreamForMember() may be using on another thread
+	unz_s *const archive = (unz_s *)_zipFile;
+	StackLock lock(archive->_shared->_mutex);
+
 	return (unzLocateFile(_zipFile, name.c_str(), 2) == UNZ_OK);
 }
 
@@ -1483,36 +1767,74 @@ const ArchiveMemberPtr ZipArchive::getMember(const String &name) const {
 	return ArchiveMemberPtr(new GenericArchiveMember(name, this));
 }
 
-SeekableReadStream *ZipArchive::createReadStreamForMember(const String &name) const {
+bool ZipArchive::locateMember(const String &name, unz_file_info &fileInfo, uint32 &dataStart) const {
+	unz_s *const archive = (unz_s *)_zipFile;
+
 	if (unzLocateFile(_zipFile, name.c_str(), 2) != UNZ_OK)
-		return 0;
+		return false;
+
+	uInt headerSize;
+	uLong extraFieldOffset;
+	uInt extraFieldSize;
+	if (unzlocal_CheckCurrentFileCoherencyHeader(archive, &headerSize, &extraFieldOffset, &extraFieldSize) != UNZ_OK)
+		return false;
+
+	fileInfo = archive->cur_file_info;
+	dataStart = archive->cur_file_info_internal.offset_curfile + SIZEZIPLOCALHEADER +
+	            headerSize + archive->byte_before_the_zipfile;
+	return true;
+}
 
+SeekableReadStream *ZipArchive::createReadStreamForMember(const String &name) const {
+	unz_s *const archive = (unz_s *)_zipFile;
+	ScopedPtr<ZipMemberReadStream> stream;
 	unz_file_info fileInfo;
-	if (unzOpenCurrentFile(_zipFile) != UNZ_OK)
-		return 0;
 
-	if (unzGetCurrentFileInfo(_zipFile, &fileInfo, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK)
+	{
+		// Locating the file changes the current file of the archive, and
+		// checking its header uses the zipfile stream
+		StackLock lock(archive->_shared->_mutex);
+
+		uint32 dataStart;
+		if (!locateMember(name, fileInfo, dataStart))
+			return 0;
+
+		stream.reset(new ZipMemberReadStream(archive->_shared, dataStart, fileInfo.compressed_size,
+		                                     fileInfo.uncompressed_size, fileInfo.compression_method == Z_DEFLATED, fileInfo.crc));
+	}
+
+	if (stream->err())
 		return 0;
 
+	// Stored members are always read directly from the zipfile. Small
+	// deflated ones are inflated at once, since the decompressor state
+	// kept by the stream would take more memory than their data.
+	if (fileInfo.compression_method != Z_DEFLATED || fileInfo.uncompressed_size > kMaxInflatedMemberSize)
+		return stream.release();
+
 	byte *buffer = (byte *)malloc(fileInfo.uncompressed_size);
 	assert(buffer);
 
-	if (unzReadCurrentFile(_zipFile, buffer, fileInfo.uncompressed_size) != (int)fileInfo.uncompressed_size) {
-		free(buffer);
-		return 0;
-	}
-
-	if (unzCloseCurrentFile(_zipFile) != UNZ_OK) {
+	if (stream->read(buffer, fileInfo.uncompressed_size) != fileInfo.uncompressed_size || stream->err()) {
 		free(buffer);
 		return 0;
 	}
 
 	return new MemoryReadStream(buffer, fileInfo.uncompressed_size, DisposeAfterUse::YES);
+}
+
+bool ZipArchive::prefetchMember(const String &name) const {
+	// Only the compressed data is prefetched. Opening the member would
+	// inflate small deflated members right away.
+	unz_s *const archive = (unz_s *)_zipFile;
+	StackLock lock(archive->_shared->_mutex);
+
+	unz_file_info fileInfo;
+	uint32 dataStart;
+	if (!locateMember(name, fileInfo, dataStart))
+		return false;
 
-	// FIXME: instead of reading all into a memory stream, we could
-	// instead create a new ZipStream class. But then we have to be
-	// careful to handle the case where the client code opens multiple
-	// files in the archive and tries to use them independently.
+	return archive->_stream->prefetch(dataStart, fileInfo.compressed_size);
 }
 
 Archive *makeZipArchive(const String &name) {
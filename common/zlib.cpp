@@ -24,6 +24,7 @@
 #define FORBIDDEN_SYMBOL_ALLOW_ALL
 
 #include "common/zlib.h"
+#include "common/array.h"
 #include "common/ptr.h"
 #include "common/util.h"
 #include "common/stream.h"
@@ -141,6 +142,47 @@ bool inflateZlibInstallShield(byte *dst, uint dstLen, const byte *src, uint srcL
 	return true;
 }
 
+struct InflateCheckpoints::Checkpoint {
+	uint32 inputPos;	// position of the next compressed byte
+	z_stream stream;	// copy of the zlib state
+};
+
+InflateCheckpoints::InflateCheckpoints(uint32 interval) : _interval(interval), _nextPos(interval) {
+}
+
+InflateCheckpoints::~InflateCheckpoints() {
+	for (uint i = 0; i < _checkpoints.size(); i++) {
+		inflateEnd(&_checkpoints[i]->stream);
+		delete _checkpoints[i];
+	}
+}
+
+void InflateCheckpoints::save(z_stream *stream, uint32 inputPos) {
+	Checkpoint *checkpoint = new Checkpoint();
+	checkpoint->inputPos = inputPos;
+
+	if (inflateCopy(&checkpoint->stream, stream) != Z_OK) {
+		delete checkpoint;
+		_nextPos = 0xFFFFFFFF;
+		return;
+	}
+
+	_checkpoints.push_back(checkpoint);
+	_nextPos += _interval;
+}
+
+uint32 InflateCheckpoints::find(uint32 pos) const {
+	return MIN<uint32>(pos / _interval, _checkpoints.size()) * _interval;
+}
+
+int InflateCheckpoints::restore(uint32 checkpointPos, z_stream *stream, uint32 &inputPos) const {
+	assert(checkpointPos > 0 && checkpointPos / _interval <= _checkpoints.size());
+
+	Checkpoint *checkpoint = _checkpoints[checkpointPos / _interval - 1];
+	inputPos = checkpoint->inputPos;
+	return inflateCopy(stream, &checkpoint->stream);
+}
+
 #ifndef RELEASE_BUILD
 static bool _shownBackwardSeekingWarning = false;
 #endif
@@ -149,11 +191,16 @@ static bool _shownBackwardSeekingWarning = false;
  * A simple wrapper class which can be used to wrap around an arbitrary
  * other SeekableReadStream and will then provide on-the-fly decompression support.
  * Assumes the compressed data to be in gzip format.
+ *
+ * While decompressing, the state of zlib is saved every CHECKPOINT_INTERVAL
+ * bytes, so that seeking only has to restart decompression from the closest
+ * checkpoint before the new position instead of from the start of the file.
  */
 class GZipReadStream : public SeekableReadStream {
 protected:
 	enum {
-		BUFSIZE = 16384		// 1 << MAX_WBITS
+		BUFSIZE = 16384,		// 1 << MAX_WBITS
+		CHECKPOINT_INTERVAL = 256 * 1024
 	};
 
 	byte	_buf[BUFSIZE];
@@ -164,10 +211,11 @@ protected:
 	uint32 _pos;
 	uint32 _origSize;
 	bool _eos;
+	InflateCheckpoints _checkpoints;
 
 public:
 
-	GZipReadStream(SeekableReadStream *w, uint32 knownSize = 0) : _wrapped(w), _stream() {
+	GZipReadStream(SeekableReadStream *w, uint32 knownSize = 0) : _wrapped(w), _stream(), _checkpoints(CHECKPOINT_INTERVAL) {
 		assert(w != 0);
 
 		// Verify file header is correct
@@ -214,26 +262,39 @@ public:
 	}
 
 	uint32 read(void *dataPtr, uint32 dataSize) {
-		_stream.next_out = (byte *)dataPtr;
-		_stream.avail_out = dataSize;
+		byte *out = (byte *)dataPtr;
+		uint32 left = dataSize;
 
 		// Keep going while we get no error
-		while (_zlibErr == Z_OK && _stream.avail_out) {
+		while (_zlibErr == Z_OK && left) {
+			const uint32 outPos = _pos + dataSize - left;
+			if (outPos == _checkpoints.getNextPos())
+				_checkpoints.save(&_stream, _wrapped->pos() - _stream.avail_in);
+
 			if (_stream.avail_in == 0 && !_wrapped->eos()) {
 				// If we are out of input data: Read more data, if available.
 				_stream.next_in = _buf;
 				_stream.avail_in = _wrapped->read(_buf, BUFSIZE);
 			}
+
+			// Stop at the next checkpoint, so that its state can be saved
+			const uint32 chunk = MIN(left, _checkpoints.getNextPos() - outPos);
+			_stream.next_out = out;
+			_stream.avail_out = chunk;
+
 			_zlibErr = inflate(&_stream, Z_NO_FLUSH);
+
+			out += chunk - _stream.avail_out;
+			left -= chunk - _stream.avail_out;
 		}
 
 		// Update the position counter
-		_pos += dataSize - _stream.avail_out;
+		_pos += dataSize - left;
 
-		if (_zlibErr == Z_STREAM_END && _stream.avail_out > 0)
+		if (_zlibErr == Z_STREAM_END && left > 0)
 			_eos = true;
 
-		return dataSize - _stream.avail_out;
+		return dataSize - left;
 	}
 
 	bool eos() const {
@@ -262,10 +323,23 @@ public:
 
 		assert(newPos >= 0);
 
-		if ((uint32)newPos < _pos) {
-			// To search backward, we have to restart the whole decompression
-			// from the start of the file. A rather wasteful operation, best
-			// to avoid it. :/
+		// Continue from the closest checkpoint before the new position, if
+		// we have to go back or if it is ahead of the current position
+		const uint32 checkpointPos = _checkpoints.find(newPos);
+
+		if (checkpointPos > 0 && ((uint32)newPos < _pos || checkpointPos > _pos)) {
+			uint32 wrappedPos;
+			inflateEnd(&_stream);
+			_zlibErr = _checkpoints.restore(checkpointPos, &_stream, wrappedPos);
+			if (_zlibErr != Z_OK)
+				return false;	// FIXME: STREAM REWRITE
+			_pos = checkpointPos;
+			_wrapped->seek(wrappedPos, SEEK_SET);
+			_stream.next_in = _buf;
+			_stream.avail_in = 0;
+		} else if ((uint32)newPos < _pos) {
+			// To search backward before the first checkpoint, we have to
+			// restart the whole decompression from the start of the file.
 
 #ifndef RELEASE_BUILD
 			if (!_shownBackwardSeekingWarning) {
@@ -24,6 +24,11 @@
 #define COMMON_ZLIB_H
 
 #include "common/scummsys.h"
+#include "common/array.h"
+
+#if defined(USE_ZLIB)
+struct z_stream_s;
+#endif
 
 namespace Common {
 
@@ -96,6 +101,61 @@ bool inflateZlibHeaderless(byte *dst, uint dstLen, const byte *src, uint srcLen,
  */
 bool inflateZlibInstallShield(byte *dst, uint dstLen, const byte *src, uint srcLen);
 
+/**
+ * Copies of the state of a zlib decompressor, taken every interval bytes
+ * of output. A seekable stream which inflates its data on the fly can use
+ * them to restart decompression from the closest checkpoint before a new
+ * position, instead of from the start of the data.
+ */
+class InflateCheckpoints {
+public:
+	InflateCheckpoints(uint32 interval);
+	~InflateCheckpoints();
+
+	/**
+	 * Return the output position at which the next checkpoint is due.
+	 * Callers should stop inflating there and call save().
+	 */
+	uint32 getNextPos() const { return _nextPos; }
+
+	/**
+	 * Save a copy of the state of stream as the checkpoint at
+	 * getNextPos(). If it can not be copied, no further checkpoints are
+	 * taken, since they have to be evenly spaced.
+	 *
+	 * @param stream	the decompressor, positioned at getNextPos()
+	 * @param inputPos	the position of the next compressed byte which
+	 *                  the decompressor will consume
+	 */
+	void save(z_stream_s *stream, uint32 inputPos);
+
+	/**
+	 * Return the output position of the last checkpoint at or before pos,
+	 * or 0 if there is none.
+	 */
+	uint32 find(uint32 pos) const;
+
+	/**
+	 * Initialize stream with a copy of the checkpoint at checkpointPos,
+	 * which has to be a position returned by find(). Any previous state
+	 * of stream must have been freed with inflateEnd() before.
+	 *
+	 * @param inputPos	set to the position of the next compressed byte
+	 * @return the zlib result code of copying the state
+	 */
+	int restore(uint32 checkpointPos, z_stream_s *stream, uint32 &inputPos) const;
+
+private:
+	struct Checkpoint;
+
+	const uint32 _interval;
+	uint32 _nextPos;
+
+	// Checkpoint i is at (i + 1) * _interval. These are kept on the heap,
+	// since zlib does not allow moving a z_stream around.
+	Array<Checkpoint *> _checkpoints;
+};
+
 #endif
 
 /**
@@ -368,10 +368,72 @@ void AdvancedMetaEngine::composeFileHashMap(FileMap &allFiles, const Common::FSL
 	}
 }
 
+/**
+ * Sizes and MD5s computed during the current detection pass, indexed by
+ * file path and number of hashed bytes. Only allocated while a pass is
+ * running.
+ */
+typedef Common::HashMap<Common::String, ADFileProperties> ADFilePropertiesCache;
+
+static ADFilePropertiesCache *s_detectionCache = 0;
+static int s_detectionPassDepth = 0;
+static AdvancedDetector::DetectionStats s_detectionStats = { 0, 0, 0 };
+
+namespace AdvancedDetector {
+
+void beginDetectionPass() {
+	if (s_detectionPassDepth++ == 0)
+		s_detectionCache = new ADFilePropertiesCache();
+}
+
+void endDetectionPass() {
+	assert(s_detectionPassDepth > 0);
+
+	if (--s_detectionPassDepth == 0) {
+		delete s_detectionCache;
+		s_detectionCache = 0;
+	}
+}
+
+const DetectionStats &getDetectionStats() {
+	return s_detectionStats;
+}
+
+void resetDetectionStats() {
+	s_detectionStats.filesHashed = 0;
+	s_detectionStats.cacheHits = 0;
+	s_detectionStats.hashTime = 0;
+}
+
+} // End of namespace AdvancedDetector
+
 bool AdvancedMetaEngine::getFileProperties(const Common::FSNode &parent, const FileMap &allFiles, const ADGameDescription &game, const Common::String fname, ADFileProperties &fileProps) const {
 	// FIXME/TODO: We don't handle the case that a file is listed as a regular
 	// file and as one with resource fork.
 
+	Common::String cacheKey;
+
+	if (game.flags & ADGF_MACRESFORK) {
+		cacheKey = Common::String::format("%s/%s:%u:resfork", parent.getPath().c_str(), fname.c_str(), _md5Bytes);
+	} else {
+		if (!allFiles.contains(fname))
+			return false;
+
+		cacheKey = Common::String::format("%s:%u", allFiles[fname].getPath().c_str(), _md5Bytes);
+	}
+
+	if (s_detectionCache) {
+		ADFilePropertiesCache::const_iterator cached = s_detectionCache->find(cacheKey);
+
+		if (cached != s_detectionCache->end()) {
+			fileProps = cached->_value;
+			s_detectionStats.cacheHits++;
+			return true;
+		}
+	}
+
+	const uint32 startTime = g_system->getMillis();
+
 	if (game.flags & ADGF_MACRESFORK) {
 		Common::MacResManager macResMan;
 
@@ -380,19 +442,22 @@ bool AdvancedMetaEngine::getFileProperties(const Common::FSNode &parent, const F
 
 		fileProps.md5 = macResMan.computeResForkMD5AsString(_md5Bytes);
 		fileProps.size = macResMan.getResForkDataSize();
-		return true;
-	}
+	} else {
+		Common::File testFile;
+
+		if (!testFile.open(allFiles[fname]))
+			return false;
 
-	if (!allFiles.contains(fname))
-		return false;
+		fileProps.size = (int32)testFile.size();
+		fileProps.md5 = Common::computeStreamMD5AsString(testFile, _md5Bytes);
+	}
 
-	Common::File testFile;
+	s_detectionStats.filesHashed++;
+	s_detectionStats.hashTime += g_system->getMillis() - startTime;
 
-	if (!testFile.open(allFiles[fname]))
-		return false;
+	if (s_detectionCache)
+		(*s_detectionCache)[cacheKey] = fileProps;
 
-	fileProps.size = (int32)testFile.size();
-	fileProps.md5 = Common::computeStreamMD5AsString(testFile, _md5Bytes);
 	return true;
 }
 
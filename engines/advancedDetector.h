@@ -331,4 +331,37 @@ protected:
 	bool getFileProperties(const Common::FSNode &parent, const FileMap &allFiles, const ADGameDescription &game, const Common::String fname, ADFileProperties &fileProps) const;
 };
 
+
+namespace AdvancedDetector {
+
+/**
+ * Statistics about the files hashed by AdvancedMetaEngine while detecting
+ * games.
+ */
+struct DetectionStats {
+	uint32 filesHashed;	///< Number of files whose MD5 was computed
+	uint32 cacheHits;	///< Number of MD5s taken from the detection cache
+	uint32 hashTime;	///< Time spent computing MD5s, in milliseconds
+};
+
+/**
+ * Start a detection pass. While a pass is running, the sizes and MD5s
+ * computed by any AdvancedMetaEngine are cached by path and number of
+ * hashed bytes, so that engines probing the same files do not read them
+ * again. Passes may be nested; the cache is dropped when the outermost
+ * pass ends, so that files changed between two passes are not missed.
+ */
+void beginDetectionPass();
+
+/** End a detection pass started by beginDetectionPass(). */
+void endDetectionPass();
+
+/** Return the statistics collected since the last resetDetectionStats(). */
+const DetectionStats &getDetectionStats();
+
+/** Reset the statistics returned by getDetectionStats(). */
+void resetDetectionStats();
+
+} // End of namespace AdvancedDetector
+
 #endif
@@ -58,6 +58,7 @@
 #include "sci/video/robot_decoder.h"
 #endif
 
+#include "common/algorithm.h"
 #include "common/file.h"
 #include "common/savefile.h"
 
@@ -81,6 +82,7 @@ Console::Console(SciEngine *engine) : GUI::Debugger(),
 	// Variables
 	DVar_Register("sleeptime_factor",	&g_debug_sleeptime_factor, DVAR_INT, 0);
 	DVar_Register("gc_interval",		&engine->_gamestate->scriptGCInterval, DVAR_INT, 0);
+	DVar_Register("gc_incremental",		&engine->_gamestate->gcIncremental, DVAR_BOOL, 0);
 	DVar_Register("simulated_key",		&g_debug_simulated_key, DVAR_INT, 0);
 	DVar_Register("track_mouse_clicks",	&g_debug_track_mouse_clicks, DVAR_BOOL, 0);
 	DVar_Register("script_abort_flag",	&_engine->_gamestate->abortScriptProcessing, DVAR_INT, 0);
@@ -109,6 +111,7 @@ Console::Console(SciEngine *engine) : GUI::Debugger(),
 	DCmd_Register("resource_id",		WRAP_METHOD(Console, cmdResourceId));
 	DCmd_Register("resource_info",		WRAP_METHOD(Console, cmdResourceInfo));
 	DCmd_Register("resource_types",		WRAP_METHOD(Console, cmdResourceTypes));
+	DCmd_Register("resource_cache",		WRAP_METHOD(Console, cmdResourceCache));
 	DCmd_Register("list",				WRAP_METHOD(Console, cmdList));
 	DCmd_Register("hexgrep",			WRAP_METHOD(Console, cmdHexgrep));
 	DCmd_Register("verify_scripts",		WRAP_METHOD(Console, cmdVerifyScripts));
@@ -151,6 +154,7 @@ Console::Console(SciEngine *engine) : GUI::Debugger(),
 	DCmd_Register("gc_reachable",		WRAP_METHOD(Console, cmdGCShowReachable));
 	DCmd_Register("gc_freeable",		WRAP_METHOD(Console, cmdGCShowFreeable));
 	DCmd_Register("gc_normalize",		WRAP_METHOD(Console, cmdGCNormalize));
+	DCmd_Register("gc_stats",			WRAP_METHOD(Console, cmdGCStats));
 	// Music/SFX
 	DCmd_Register("songlib",			WRAP_METHOD(Console, cmdSongLib));
 	DCmd_Register("songinfo",			WRAP_METHOD(Console, cmdSongInfo));
@@ -206,6 +210,7 @@ Console::Console(SciEngine *engine) : GUI::Debugger(),
 	DCmd_Register("bpe",				WRAP_METHOD(Console, cmdBreakpointFunction));		// alias
 	// VM
 	DCmd_Register("script_steps",		WRAP_METHOD(Console, cmdScriptSteps));
+	DCmd_Register("vm_profile",			WRAP_METHOD(Console, cmdVMProfile));
 	DCmd_Register("vm_varlist",			WRAP_METHOD(Console, cmdVMVarlist));
 	DCmd_Register("vmvarlist",			WRAP_METHOD(Console, cmdVMVarlist));				// alias
 	DCmd_Register("vl",					WRAP_METHOD(Console, cmdVMVarlist));				// alias
@@ -230,6 +235,8 @@ Console::Console(SciEngine *engine) : GUI::Debugger(),
 	_debugState.breakpointWasHit = false;
 	_debugState._breakpoints.clear(); // No breakpoints defined
 	_debugState._activeBreakpointTypes = 0;
+	_debugState._vmProfile.enabled = false;
+	_debugState._vmProfile.reset();
 }
 
 Console::~Console() {
@@ -312,6 +319,7 @@ bool Console::cmdHelp(int argc, const char **argv) {
 	DebugPrintf("---------\n");
 	DebugPrintf("sleeptime_factor: Factor to multiply with wait times in kWait()\n");
 	DebugPrintf("gc_interval: Number of kernel calls in between garbage collections\n");
+	DebugPrintf("gc_incremental: Spreads garbage collections over several kernel calls\n");
 	DebugPrintf("simulated_key: Add a key with the specified scan code to the event list\n");
 	DebugPrintf("track_mouse_clicks: Toggles mouse click tracking to the console\n");
 	DebugPrintf("weak_validations: Turns some validation errors into warnings\n");
@@ -348,6 +356,7 @@ bool Console::cmdHelp(int argc, const char **argv) {
 	DebugPrintf(" resource_id - Identifies a resource number by splitting it up in resource type and resource number\n");
 	DebugPrintf(" resource_info - Shows info about a resource\n");
 	DebugPrintf(" resource_types - Shows the valid resource types\n");
+	DebugPrintf(" resource_cache - Shows or changes the resource cache size and statistics\n");
 	DebugPrintf(" list - Lists all the resources of a given type\n");
 	DebugPrintf(" hexgrep - Searches some resources for a particular sequence of bytes, represented as hexadecimal numbers\n");
 	DebugPrintf(" verify_scripts - Performs sanity checks on SCI1.1-SCI2.1 game scripts (e.g. if they're up to 64KB in total)\n");
@@ -387,6 +396,7 @@ bool Console::cmdHelp(int argc, const char **argv) {
 	DebugPrintf(" gc_reachable - Lists all addresses directly reachable from a given memory object\n");
 	DebugPrintf(" gc_freeable - Lists all addresses freeable in a given segment\n");
 	DebugPrintf(" gc_normalize - Prints the \"normal\" address of a given address\n");
+	DebugPrintf(" gc_stats - Shows garbage collector pause times\n");
 	DebugPrintf("\n");
 	DebugPrintf("Music/SFX:\n");
 	DebugPrintf(" songlib - Shows the song library\n");
@@ -428,6 +438,7 @@ bool Console::cmdHelp(int argc, const char **argv) {
 	DebugPrintf("\n");
 	DebugPrintf("VM:\n");
 	DebugPrintf(" script_steps - Shows the number of executed SCI operations\n");
+	DebugPrintf(" vm_profile - Counts executed opcodes and kernel calls\n");
 	DebugPrintf(" vm_varlist / vmvarlist / vl - Shows the addresses of variables in the VM\n");
 	DebugPrintf(" vm_vars / vmvars / vv - Displays or changes variables in the VM\n");
 	DebugPrintf(" stack - Lists the specified number of stack elements\n");
@@ -792,6 +803,45 @@ bool Console::cmdResourceTypes(int argc, const char **argv) {
 	return true;
 }
 
+bool Console::cmdResourceCache(int argc, const char **argv) {
+	ResourceManager *resMan = _engine->getResMan();
+
+	if (argc > 2) {
+		DebugPrintf("Shows the resource cache statistics, or changes the cache size\n");
+		DebugPrintf("Usage: %s [<size in KB> | reset]\n", argv[0]);
+		return true;
+	}
+
+	if (argc == 2) {
+		if (!scumm_stricmp(argv[1], "reset")) {
+			resMan->resetCacheStats();
+			DebugPrintf("Resource cache statistics reset\n");
+		} else {
+			int size = atoi(argv[1]);
+			if (size <= 0) {
+				DebugPrintf("Invalid cache size '%s'\n", argv[1]);
+				return true;
+			}
+			resMan->setCacheSize(size * 1024);
+			DebugPrintf("Resource cache size set to %d KB\n", size);
+		}
+		return true;
+	}
+
+	const ResourceManager::CacheStats &stats = resMan->getCacheStats();
+	uint32 lookups = stats.hits + stats.misses;
+
+	DebugPrintf("Cache size: %d KB, %d KB in use, %d KB locked\n",
+				resMan->getCacheSize() / 1024, resMan->getCacheUsage() / 1024, resMan->getLockedMemory() / 1024);
+	DebugPrintf("Lookups: %d hits, %d misses (%d%% hits)\n", stats.hits, stats.misses,
+				lookups ? stats.hits * 100 / lookups : 0);
+	DebugPrintf("Evictions: %d\n", stats.evictions);
+	DebugPrintf("Decompressed: %d resources in %d ms\n", stats.decompressions, stats.decompressTime);
+	DebugPrintf("Preloaded: %d resources\n", stats.preloads);
+
+	return true;
+}
+
 bool Console::cmdHexgrep(int argc, const char **argv) {
 	if (argc < 4) {
 		DebugPrintf("Searches some resources for a particular sequence of bytes, represented as decimal or hexadecimal numbers.\n");
@@ -2237,6 +2287,31 @@ bool Console::cmdGCInvoke(int argc, const char **argv) {
 	return true;
 }
 
+bool Console::cmdGCStats(int argc, const char **argv) {
+	GCStatistics &stats = _engine->_gamestate->_gcState->stats;
+
+	if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+		stats.reset();
+		DebugPrintf("Garbage collector statistics cleared\n");
+		return true;
+	} else if (argc != 1) {
+		DebugPrintf("Shows garbage collector statistics.\n");
+		DebugPrintf("Usage: %s [reset]\n", argv[0]);
+		return true;
+	}
+
+	DebugPrintf("Mode: %s%s\n", _engine->_gamestate->gcIncremental ? "incremental" : "full",
+		gc_in_progress(_engine->_gamestate) ? " (collection in progress)" : "");
+	DebugPrintf("Collections: %d, incremental steps: %d\n", stats.collections, stats.steps);
+	DebugPrintf("Entries freed by the last collection: %d\n", stats.freed);
+	DebugPrintf("Longest pause: %d ms last collection, %d ms overall\n", stats.lastPause, stats.maxPause);
+	DebugPrintf("Total time: %d ms", stats.totalTime);
+	if (stats.collections)
+		DebugPrintf(", %d ms per collection", stats.totalTime / stats.collections);
+	DebugPrintf("\n");
+	return true;
+}
+
 bool Console::cmdGCObjects(int argc, const char **argv) {
 	AddrSet *use_map = findAllActiveReferences(_engine->_gamestate);
 
@@ -2710,6 +2785,89 @@ bool Console::cmdScriptSteps(int argc, const char **argv) {
 	return true;
 }
 
+#ifndef REDUCE_MEMORY_USAGE
+extern const char *opcodeNames[]; // from scriptdebug.cpp
+#endif
+
+struct OpcodeCountGreater {
+	const uint32 *_counts;
+	OpcodeCountGreater(const uint32 *counts) : _counts(counts) {}
+	bool operator()(uint a, uint b) const { return _counts[a] > _counts[b]; }
+};
+
+struct KernelCallTimeGreater {
+	const VMProfile &_profile;
+	KernelCallTimeGreater(const VMProfile &profile) : _profile(profile) {}
+	bool operator()(uint a, uint b) const {
+		if (_profile.kernelCallTimes[a] != _profile.kernelCallTimes[b])
+			return _profile.kernelCallTimes[a] > _profile.kernelCallTimes[b];
+		return _profile.kernelCallCounts[a] > _profile.kernelCallCounts[b];
+	}
+};
+
+bool Console::cmdVMProfile(int argc, const char **argv) {
+	VMProfile &profile = _debugState._vmProfile;
+
+	if (argc != 2) {
+		DebugPrintf("Counts the opcodes and kernel calls executed by the VM, and the time\n");
+		DebugPrintf("spent in each kernel call.\n");
+		DebugPrintf("Usage: %s on|off|reset|show\n", argv[0]);
+		DebugPrintf("Profiling is currently %s\n", profile.enabled ? "on" : "off");
+		return true;
+	}
+
+	if (strcmp(argv[1], "on") == 0) {
+		profile.enabled = true;
+		DebugPrintf("VM profiling enabled\n");
+	} else if (strcmp(argv[1], "off") == 0) {
+		profile.enabled = false;
+		DebugPrintf("VM profiling disabled\n");
+	} else if (strcmp(argv[1], "reset") == 0) {
+		profile.reset();
+		DebugPrintf("VM profile cleared\n");
+	} else if (strcmp(argv[1], "show") == 0) {
+		Common::Array<uint> opcodes;
+		uint32 totalOps = 0;
+		for (uint i = 0; i < ARRAYSIZE(profile.opcodeCounts); i++) {
+			if (profile.opcodeCounts[i]) {
+				opcodes.push_back(i);
+				totalOps += profile.opcodeCounts[i];
+			}
+		}
+		Common::sort(opcodes.begin(), opcodes.end(), OpcodeCountGreater(profile.opcodeCounts));
+
+		DebugPrintf("Opcodes (%d executed):\n", totalOps);
+		for (uint i = 0; i < opcodes.size(); i++) {
+			const uint opcode = opcodes[i];
+#ifndef REDUCE_MEMORY_USAGE
+			DebugPrintf(" %02x %-8s %10d (%.1f%%)\n", opcode, opcodeNames[opcode], profile.opcodeCounts[opcode],
+				100.0 * profile.opcodeCounts[opcode] / totalOps);
+#else
+			DebugPrintf(" %02x %10d (%.1f%%)\n", opcode, profile.opcodeCounts[opcode],
+				100.0 * profile.opcodeCounts[opcode] / totalOps);
+#endif
+		}
+
+		Common::Array<uint> kernelCalls;
+		for (uint i = 0; i < profile.kernelCallCounts.size(); i++) {
+			if (profile.kernelCallCounts[i])
+				kernelCalls.push_back(i);
+		}
+		Common::sort(kernelCalls.begin(), kernelCalls.end(), KernelCallTimeGreater(profile));
+
+		DebugPrintf("Kernel calls:\n");
+		for (uint i = 0; i < kernelCalls.size(); i++) {
+			const uint kernelCallNr = kernelCalls[i];
+			DebugPrintf(" k%-20s %10d calls %8d ms\n", _engine->getKernel()->getKernelName(kernelCallNr).c_str(),
+				profile.kernelCallCounts[kernelCallNr], profile.kernelCallTimes[kernelCallNr]);
+		}
+	} else {
+		DebugPrintf("Unknown parameter %s\n", argv[1]);
+	}
+
+	return true;
+}
+
 bool Console::cmdBacktrace(int argc, const char **argv) {
 	DebugPrintf("Call stack (current base: 0x%x):\n", _engine->_gamestate->executionStackBase);
 	Common::List<ExecStack>::const_iterator iter;
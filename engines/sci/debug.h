@@ -23,6 +23,7 @@
 #ifndef SCI_DEBUG_H
 #define SCI_DEBUG_H
 
+#include "common/array.h"
 #include "common/list.h"
 #include "sci/engine/vm_types.h"	// for StackPtr
 
@@ -60,6 +61,33 @@ enum DebugSeeking {
 	kDebugSeekStepOver = 5      // Step forward until we reach same stack-level again
 };
 
+/**
+ * Execution statistics gathered by run_vm() while profiling is enabled with
+ * the vm_profile console command. Kernel call times are inclusive, i.e. they
+ * also contain the time spent in any script code the kernel call invoked.
+ */
+struct VMProfile {
+	bool enabled;
+	uint32 opcodeCounts[128];
+	Common::Array<uint32> kernelCallCounts;
+	Common::Array<uint32> kernelCallTimes; ///< Accumulated time spent in each kernel call, in milliseconds
+
+	void reset() {
+		memset(opcodeCounts, 0, sizeof(opcodeCounts));
+		kernelCallCounts.clear();
+		kernelCallTimes.clear();
+	}
+
+	void addKernelCall(uint kernelCallNr, uint32 time) {
+		if (kernelCallNr >= kernelCallCounts.size()) {
+			kernelCallCounts.resize(kernelCallNr + 1);
+			kernelCallTimes.resize(kernelCallNr + 1);
+		}
+		kernelCallCounts[kernelCallNr]++;
+		kernelCallTimes[kernelCallNr] += time;
+	}
+};
+
 struct DebugState {
 	bool debugging;
 	bool breakpointWasHit;
@@ -72,6 +100,7 @@ struct DebugState {
 	StackPtr old_sp;
 	Common::List<Breakpoint> _breakpoints;   //< List of breakpoints
 	int _activeBreakpointTypes;  //< Bit mask specifying which types of breakpoints are active
+	VMProfile _vmProfile;        //< Opcode and kernel call statistics
 };
 
 // Various global variables used for debugging are declared here
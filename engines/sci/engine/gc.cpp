@@ -22,6 +22,7 @@
 
 #include "sci/engine/gc.h"
 #include "common/array.h"
+#include "common/system.h"
 #include "sci/graphics/ports.h"
 
 namespace Sci {
@@ -80,29 +81,41 @@ static AddrSet *normalizeAddresses(SegManager *segMan, const AddrSet &nonnormal_
 	return normal_map;
 }
 
-static void processWorkList(SegManager *segMan, WorklistManager &wm, const Common::Array<SegmentObj *> &heap) {
+/**
+ * Processes entries from the work list, pushing their outgoing references,
+ * until the list is empty or maxEntries have been processed.
+ * @return true if the work list has been emptied
+ */
+static bool processWorkList(SegManager *segMan, WorklistManager &wm, const Common::Array<SegmentObj *> &heap, uint maxEntries = 0xFFFFFFFF, bool skipFreed = false) {
 	SegmentId stackSegment = segMan->findSegmentByType(SEG_TYPE_STACK);
 	while (!wm._worklist.empty()) {
+		if (maxEntries-- == 0)
+			return false;
+
 		reg_t reg = wm._worklist.back();
 		wm._worklist.pop_back();
 		if (reg.getSegment() != stackSegment) { // No need to repeat this one
 			debugC(kDebugLevelGC, "[GC] Checking %04x:%04x", PRINT_REG(reg));
 			if (reg.getSegment() < heap.size() && heap[reg.getSegment()]) {
+				// Entries may have been freed by the scripts in between the
+				// steps of an incremental collection
+				if (skipFreed && !heap[reg.getSegment()]->isValidOffset(reg.getOffset()))
+					continue;
+
 				// Valid heap object? Find its outgoing references!
 				wm.pushArray(heap[reg.getSegment()]->listAllOutgoingReferences(reg));
 			}
 		}
 	}
+	return true;
 }
 
-AddrSet *findAllActiveReferences(EngineState *s) {
+static void collectRoots(EngineState *s, Common::Array<reg_t> &roots) {
 	assert(!s->_executionStack.empty());
 
-	WorklistManager wm;
-
 	// Initialize registers
-	wm.push(s->r_acc);
-	wm.push(s->r_prev);
+	roots.push_back(s->r_acc);
+	roots.push_back(s->r_prev);
 
 	// Initialize value stack
 	// We do this one by hand since the stack doesn't know the current execution stack
@@ -117,7 +130,7 @@ AddrSet *findAllActiveReferences(EngineState *s) {
 	const StackPtr sp = iter->sp;
 
 	for (reg_t *pos = s->stack_base; pos < sp; pos++)
-		wm.push(*pos);
+		roots.push_back(*pos);
 
 	debugC(kDebugLevelGC, "[GC] -- Finished adding value stack");
 
@@ -127,10 +140,10 @@ AddrSet *findAllActiveReferences(EngineState *s) {
 		const ExecStack &es = *iter;
 
 		if (es.type != EXEC_STACK_TYPE_KERNEL) {
-			wm.push(es.objp);
-			wm.push(es.sendp);
+			roots.push_back(es.objp);
+			roots.push_back(es.sendp);
 			if (es.type == EXEC_STACK_TYPE_VARSELECTOR)
-				wm.push(*(es.getVarPointer(s->_segMan)));
+				roots.push_back(*(es.getVarPointer(s->_segMan)));
 		}
 	}
 
@@ -145,13 +158,24 @@ AddrSet *findAllActiveReferences(EngineState *s) {
 			Script *script = (Script *)heap[i];
 
 			if (script->getLockers()) { // Explicitly loaded?
-				wm.pushArray(script->listObjectReferences());
+				const Common::Array<reg_t> tmp = script->listObjectReferences();
+				for (Common::Array<reg_t>::const_iterator it = tmp.begin(); it != tmp.end(); ++it)
+					roots.push_back(*it);
 			}
 		}
 	}
 
 	debugC(kDebugLevelGC, "[GC] -- Finished explicitly loaded scripts, done with root set");
+}
+
+AddrSet *findAllActiveReferences(EngineState *s) {
+	WorklistManager wm;
 
+	Common::Array<reg_t> roots;
+	collectRoots(s, roots);
+	wm.pushArray(roots);
+
+	const Common::Array<SegmentObj *> &heap = s->_segMan->getSegments();
 	processWorkList(s->_segMan, wm, heap);
 
 	if (g_sci->_gfxPorts)
@@ -160,11 +184,14 @@ AddrSet *findAllActiveReferences(EngineState *s) {
 	return normalizeAddresses(s->_segMan, wm._map);
 }
 
-void run_gc(EngineState *s) {
-	SegManager *segMan = s->_segMan;
+/**
+ * Frees all deallocatable entries which are not in the set of active
+ * references.
+ * @return the number of freed entries
+ */
+static uint32 sweep(SegManager *segMan, const AddrSet &activeRefs) {
+	uint32 freed = 0;
 
-	// Some debug stuff
-	debugC(kDebugLevelGC, "[GC] Running...");
 #ifdef GC_DEBUG_CODE
 	const char *segnames[SEG_TYPE_MAX + 1];
 	int segcount[SEG_TYPE_MAX + 1];
@@ -172,9 +199,6 @@ void run_gc(EngineState *s) {
 	memset(segcount, 0, sizeof(segcount));
 #endif
 
-	// Compute the set of all segments references currently in use.
-	AddrSet *activeRefs = findAllActiveReferences(s);
-
 	// Iterate over all segments, and check for each whether it
 	// contains stuff that can be collected.
 	const Common::Array<SegmentObj *> &heap = segMan->getSegments();
@@ -192,10 +216,11 @@ void run_gc(EngineState *s) {
 			const Common::Array<reg_t> tmp = mobj->listAllDeallocatable(seg);
 			for (Common::Array<reg_t>::const_iterator it = tmp.begin(); it != tmp.end(); ++it) {
 				const reg_t addr = *it;
-				if (!activeRefs->contains(addr)) {
+				if (!activeRefs.contains(addr)) {
 					// Not found -> we can free it
 					mobj->freeAtAddress(segMan, addr);
 					debugC(kDebugLevelGC, "[GC] Deallocating %04x:%04x", PRINT_REG(addr));
+					freed++;
 #ifdef GC_DEBUG_CODE
 					segcount[type]++;
 #endif
@@ -205,8 +230,6 @@ void run_gc(EngineState *s) {
 		}
 	}
 
-	delete activeRefs;
-
 #ifdef GC_DEBUG_CODE
 	// Output debug summary of garbage collection
 	debugC(kDebugLevelGC, "[GC] Summary:");
@@ -214,6 +237,151 @@ void run_gc(EngineState *s) {
 		if (segcount[i])
 			debugC(kDebugLevelGC, "\t%d\t* %s", segcount[i], segnames[i]);
 #endif
+
+	return freed;
+}
+
+static void recordPause(GCState &gc, uint32 pause) {
+	gc.stats.totalTime += pause;
+	gc.cyclePause = MAX(gc.cyclePause, pause);
+	gc.stats.maxPause = MAX(gc.stats.maxPause, pause);
+}
+
+static void finishCollection(GCState &gc, uint32 freed) {
+	gc.stats.collections++;
+	gc.stats.freed = freed;
+	gc.stats.lastPause = gc.cyclePause;
+	gc.cyclePause = 0;
+}
+
+void run_gc(EngineState *s) {
+	SegManager *segMan = s->_segMan;
+	GCState &gc = *s->_gcState;
+	const uint32 startTime = g_system->getMillis();
+
+	// A full collection supersedes any incremental one in progress
+	cancel_gc(s);
+
+	// Some debug stuff
+	debugC(kDebugLevelGC, "[GC] Running...");
+
+	// Compute the set of all segments references currently in use.
+	AddrSet *activeRefs = findAllActiveReferences(s);
+
+	const uint32 freed = sweep(segMan, *activeRefs);
+
+	delete activeRefs;
+
+	recordPause(gc, g_system->getMillis() - startTime);
+	finishCollection(gc, freed);
+}
+
+/**
+ * Pushes the outgoing references of an entry again, even if it has already
+ * been marked, as they may have changed since.
+ */
+static void rescan(SegManager *segMan, WorklistManager &wm, reg_t reg) {
+	if (!wm._map.contains(reg)) {
+		wm.push(reg);
+		return;
+	}
+
+	const Common::Array<SegmentObj *> &heap = segMan->getSegments();
+	if (reg.getSegment() != segMan->findSegmentByType(SEG_TYPE_STACK) && reg.getSegment() < heap.size()
+			&& heap[reg.getSegment()] && heap[reg.getSegment()]->isValidOffset(reg.getOffset()))
+		wm.pushArray(heap[reg.getSegment()]->listAllOutgoingReferences(reg));
+}
+
+void run_gc_step(EngineState *s) {
+	// Number of work list entries to process per step
+	const uint kStepSize = 500;
+
+	SegManager *segMan = s->_segMan;
+	GCState &gc = *s->_gcState;
+	const uint32 startTime = g_system->getMillis();
+	const Common::Array<SegmentObj *> &heap = segMan->getSegments();
+
+	if (gc.marking && segMan->haveGCSegmentsChanged()) {
+		// Scripts have been loaded or unloaded since the collection started,
+		// which may have invalidated what has been marked so far
+		debugC(kDebugLevelGC, "[GC] Segments changed, restarting incremental collection");
+		cancel_gc(s);
+	}
+
+	if (!gc.marking) {
+		debugC(kDebugLevelGC, "[GC] Starting incremental collection");
+		gc.wm._worklist.clear();
+		gc.wm._map.clear();
+
+		Common::Array<reg_t> roots;
+		collectRoots(s, roots);
+		gc.wm.pushArray(roots);
+
+		segMan->setGCBarrier(true);
+		gc.marking = true;
+	}
+
+	// Entries allocated since the last step are live
+	gc.wm.pushArray(segMan->getGCAllocations());
+	segMan->getGCAllocations().clear();
+
+	gc.stats.steps++;
+
+	if (processWorkList(segMan, gc.wm, heap, kStepSize, true)) {
+		// Marking is done. Rescan the roots, and everything marked in the
+		// segments which have been written to in the meantime, to pick up
+		// the references which the scripts have moved around.
+		Common::Array<reg_t> roots;
+		collectRoots(s, roots);
+		for (Common::Array<reg_t>::const_iterator it = roots.begin(); it != roots.end(); ++it)
+			rescan(segMan, gc.wm, *it);
+
+		Common::Array<reg_t> dirty;
+		for (AddrSet::const_iterator it = gc.wm._map.begin(); it != gc.wm._map.end(); ++it) {
+			if (segMan->isGCDirty(it->_key.getSegment()))
+				dirty.push_back(it->_key);
+		}
+		for (Common::Array<reg_t>::const_iterator it = dirty.begin(); it != dirty.end(); ++it)
+			rescan(segMan, gc.wm, *it);
+
+		gc.wm.pushArray(segMan->getGCAllocations());
+		processWorkList(segMan, gc.wm, heap, 0xFFFFFFFF, true);
+
+		if (g_sci->_gfxPorts)
+			g_sci->_gfxPorts->processEngineHunkList(gc.wm);
+
+		segMan->setGCBarrier(false);
+		gc.marking = false;
+
+		AddrSet *activeRefs = normalizeAddresses(segMan, gc.wm._map);
+		gc.wm._worklist.clear();
+		gc.wm._map.clear();
+
+		const uint32 freed = sweep(segMan, *activeRefs);
+		delete activeRefs;
+
+		debugC(kDebugLevelGC, "[GC] Incremental collection done, %d entries freed", freed);
+		recordPause(gc, g_system->getMillis() - startTime);
+		finishCollection(gc, freed);
+	} else {
+		recordPause(gc, g_system->getMillis() - startTime);
+	}
+}
+
+bool gc_in_progress(EngineState *s) {
+	return s->_gcState->marking;
+}
+
+void cancel_gc(EngineState *s) {
+	GCState &gc = *s->_gcState;
+
+	if (gc.marking) {
+		gc.marking = false;
+		gc.cyclePause = 0;
+		gc.wm._worklist.clear();
+		gc.wm._map.clear();
+		s->_segMan->setGCBarrier(false);
+	}
 }
 
 } // End of namespace Sci
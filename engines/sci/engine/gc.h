@@ -42,6 +42,45 @@ struct reg_t_Hash {
  */
 typedef Common::HashMap<reg_t, bool, reg_t_Hash> AddrSet;
 
+struct WorklistManager {
+	Common::Array<reg_t> _worklist;
+	AddrSet _map;	// used for 2 contains() calls, inside push() and run_gc()
+
+	void push(reg_t reg);
+	void pushArray(const Common::Array<reg_t> &tmp);
+};
+
+/**
+ * Pause times and other statistics of the garbage collector. All times are
+ * in milliseconds.
+ */
+struct GCStatistics {
+	uint32 collections;	///< Number of completed collections
+	uint32 steps;		///< Number of incremental marking steps
+	uint32 freed;		///< Number of entries freed by the last collection
+	uint32 lastPause;	///< Longest pause of the last collection
+	uint32 maxPause;	///< Longest pause of all collections
+	uint32 totalTime;	///< Time spent in all collections
+
+	void reset() {
+		collections = steps = freed = 0;
+		lastPause = maxPause = totalTime = 0;
+	}
+};
+
+/**
+ * State of the garbage collector which is kept between the steps of an
+ * incremental collection.
+ */
+struct GCState {
+	bool marking;		///< An incremental collection is in progress
+	uint32 cyclePause;	///< Longest pause of the collection in progress
+	WorklistManager wm;
+	GCStatistics stats;
+
+	GCState() : marking(false), cyclePause(0) { stats.reset(); }
+};
+
 /**
  * Finds all used references and normalises them to their memory addresses
  * @param s The state to gather all information from
@@ -55,14 +94,27 @@ AddrSet *findAllActiveReferences(EngineState *s);
  */
 void run_gc(EngineState *s);
 
-struct WorklistManager {
-	Common::Array<reg_t> _worklist;
-	AddrSet _map;	// used for 2 contains() calls, inside push() and run_gc()
+/**
+ * Runs one step of an incremental garbage collection, starting a new one
+ * if none is in progress. Every step marks a limited number of objects;
+ * the SegManager write barrier tracks what the scripts modify in between,
+ * so that the final step only has to rescan the roots and the modified
+ * segments before freeing the unreachable objects.
+ * @param s The state in which we should gc
+ */
+void run_gc_step(EngineState *s);
 
-	void push(reg_t reg);
-	void pushArray(const Common::Array<reg_t> &tmp);
-};
+/**
+ * Checks whether an incremental garbage collection is in progress
+ * @param s The state to check
+ */
+bool gc_in_progress(EngineState *s);
 
+/**
+ * Abandons an incremental garbage collection in progress, if any
+ * @param s The state in which the collection runs
+ */
+void cancel_gc(EngineState *s);
 
 } // End of namespace Sci
 
@@ -111,10 +111,25 @@ struct Vertex {
 	// Previous vertex in shortest path
 	Vertex *path_prev;
 
+	// Position in the vertex index of the pathfinding state
+	int index;
+
+	// A* set membership: position in the open set heap (-1 when not in
+	// the open set), the order in which the vertex entered the open set,
+	// and whether the shortest path to this vertex is known
+	int heapPos;
+	uint32 openOrder;
+	bool closed;
+
 public:
 	Vertex(const Common::Point &p) : v(p) {
+		costF = HUGE_DISTANCE;
 		costG = HUGE_DISTANCE;
 		path_prev = NULL;
+		index = -1;
+		heapPos = -1;
+		openOrder = 0;
+		closed = false;
 	}
 };
 
@@ -236,6 +251,106 @@ public:
 
 typedef Common::List<Polygon *> PolygonList;
 
+/**
+ * Visibility between the vertices of one polygon set. Only vertices that
+ * are part of an edge are covered, as visibility between those depends on
+ * nothing but the polygon set itself. Rows are filled in lazily, when
+ * their vertex is expanded by the A* search.
+ */
+struct VisibilityGraph {
+	// Polygon set this graph belongs to: for every polygon with edges,
+	// its vertex count followed by the coordinates of its vertices
+	Common::Array<int16> key;
+
+	// Number of vertices covered by this graph
+	uint size;
+
+	// Number of 32-bit words per row
+	uint pitch;
+
+	// Whether a row has been computed yet
+	Common::Array<bool> rowKnown;
+
+	// Visibility bits, one row per vertex
+	Common::Array<uint32> bits;
+
+	VisibilityGraph(const Common::Array<int16> &k, uint n) : key(k), size(n) {
+		pitch = (n + 31) / 32;
+		rowKnown.resize(n);
+		for (uint i = 0; i < n; i++)
+			rowKnown[i] = false;
+		bits.resize(n * pitch);
+		for (uint i = 0; i < bits.size(); i++)
+			bits[i] = 0;
+	}
+
+	bool isVisible(uint from, uint to) const {
+		return (bits[from * pitch + to / 32] & (1U << (to % 32))) != 0;
+	}
+
+	void setVisible(uint from, uint to) {
+		bits[from * pitch + to / 32] |= (1U << (to % 32));
+	}
+};
+
+/**
+ * Keeps the visibility graphs of the most recently used polygon sets, so
+ * that repeated kAvoidPath calls on the same room don't need to redo the
+ * visibility tests for every expanded vertex.
+ */
+class PathfindingCache {
+public:
+	PathfindingCache() : _hits(0), _misses(0) {}
+
+	~PathfindingCache() {
+		for (Common::List<VisibilityGraph *>::iterator it = _graphs.begin(); it != _graphs.end(); ++it)
+			delete *it;
+	}
+
+	/**
+	 * Returns the visibility graph for a polygon set, creating an empty one
+	 * if there is none. The least recently used graph is dropped when the
+	 * cache is full.
+	 */
+	VisibilityGraph *lookup(const Common::Array<int16> &key, uint size) {
+		for (Common::List<VisibilityGraph *>::iterator it = _graphs.begin(); it != _graphs.end(); ++it) {
+			VisibilityGraph *graph = *it;
+			if (graph->size == size && graph->key == key) {
+				_graphs.erase(it);
+				_graphs.push_front(graph);
+				_hits++;
+				return graph;
+			}
+		}
+
+		_misses++;
+
+		if (_graphs.size() >= kMaxGraphs) {
+			delete _graphs.back();
+			_graphs.pop_back();
+		}
+
+		VisibilityGraph *graph = new VisibilityGraph(key, size);
+		_graphs.push_front(graph);
+		return graph;
+	}
+
+	uint32 getHits() const { return _hits; }
+	uint32 getMisses() const { return _misses; }
+
+private:
+	enum {
+		kMaxGraphs = 4
+	};
+
+	Common::List<VisibilityGraph *> _graphs; // most recently used first
+	uint32 _hits, _misses;
+};
+
+void freePathfindingCache(PathfindingCache *cache) {
+	delete cache;
+}
+
 // Pathfinding state
 struct PathfindingState {
 	// List of all polygons
@@ -250,6 +365,11 @@ struct PathfindingState {
 	// Total number of vertices
 	int vertices;
 
+	// Cached visibility between the vertices with edges, and the row of
+	// each entry of vertex_index in it (-1 for vertices without edges)
+	VisibilityGraph *visGraph;
+	int *visIndex;
+
 	// Point to prepend and append to final path
 	Common::Point *_prependPoint;
 	Common::Point *_appendPoint;
@@ -261,6 +381,8 @@ struct PathfindingState {
 		vertex_start = NULL;
 		vertex_end = NULL;
 		vertex_index = NULL;
+		visGraph = NULL;
+		visIndex = NULL;
 		_prependPoint = NULL;
 		_appendPoint = NULL;
 		vertices = 0;
@@ -268,6 +390,7 @@ struct PathfindingState {
 
 	~PathfindingState() {
 		free(vertex_index);
+		free(visIndex);
 
 		delete _prependPoint;
 		delete _appendPoint;
@@ -659,42 +782,73 @@ static int inside(const Common::Point &p, Vertex *vertex) {
 	return 0;
 }
 
+/**
+ * Determines whether a vertex is visible from another vertex
+ * @param s				the pathfinding state
+ * @param vertex_cur	the vertex to look from
+ * @param vertex		the vertex to look at
+ * @return true if the line between the two vertices doesn't cross any polygon
+ */
+static bool is_visible(PathfindingState *s, Vertex *vertex_cur, Vertex *vertex) {
+	// Make sure we don't intersect a polygon locally at the vertices
+	if ((vertex == vertex_cur) || (inside(vertex->v, vertex_cur)) || (inside(vertex_cur->v, vertex)))
+		return false;
+
+	// Check for intersecting edges
+	for (int j = 0; j < s->vertices; j++) {
+		Vertex *edge = s->vertex_index[j];
+		if (VERTEX_HAS_EDGES(edge)) {
+			if (between(vertex_cur->v, vertex->v, edge->v)) {
+				// If we hit a vertex, make sure we can pass through it without intersecting its polygon
+				if ((inside(vertex_cur->v, edge)) || (inside(vertex->v, edge)))
+					return false;
+
+				// This edge won't properly intersect, so we continue
+				continue;
+			}
+
+			if (intersect_proper(vertex_cur->v, vertex->v, edge->v, CLIST_NEXT(edge)->v))
+				return false;
+		}
+	}
+
+	return true;
+}
+
 /**
  * Returns a list of all vertices that are visible from a particular vertex.
+ * Visibility between two vertices with edges is taken from the visibility
+ * graph of the polygon set when there is one, as vertices without edges
+ * (such as a start or end point not on a polygon) can't block the line
+ * between them.
  * @param s				the pathfinding state
  * @param vertex_cur	the vertex
  * @return list of vertices that are visible from vert
  */
 static VertexList *visible_vertices(PathfindingState *s, Vertex *vertex_cur) {
 	VertexList *visVerts = new VertexList();
+	VisibilityGraph *graph = s->visGraph;
+	int row = graph ? s->visIndex[vertex_cur->index] : -1;
+
+	if (row != -1 && !graph->rowKnown[row]) {
+		for (int i = 0; i < s->vertices; i++) {
+			int col = s->visIndex[i];
+			if (col != -1 && is_visible(s, vertex_cur, s->vertex_index[i]))
+				graph->setVisible(row, col);
+		}
+		graph->rowKnown[row] = true;
+	}
 
 	for (int i = 0; i < s->vertices; i++) {
 		Vertex *vertex = s->vertex_index[i];
+		bool visible;
 
-		// Make sure we don't intersect a polygon locally at the vertices
-		if ((vertex == vertex_cur) || (inside(vertex->v, vertex_cur)) || (inside(vertex_cur->v, vertex)))
-			continue;
-
-		// Check for intersecting edges
-		int j;
-		for (j = 0; j < s->vertices; j++) {
-			Vertex *edge = s->vertex_index[j];
-			if (VERTEX_HAS_EDGES(edge)) {
-				if (between(vertex_cur->v, vertex->v, edge->v)) {
-					// If we hit a vertex, make sure we can pass through it without intersecting its polygon
-					if ((inside(vertex_cur->v, edge)) || (inside(vertex->v, edge)))
-						break;
-
-					// This edge won't properly intersect, so we continue
-					continue;
-				}
-
-				if (intersect_proper(vertex_cur->v, vertex->v, edge->v, CLIST_NEXT(edge)->v))
-					break;
-			}
-		}
+		if (row != -1 && s->visIndex[i] != -1)
+			visible = graph->isVisible(row, s->visIndex[i]);
+		else
+			visible = is_visible(s, vertex_cur, vertex);
 
-		if (j == s->vertices)
+		if (visible)
 			visVerts->push_front(vertex);
 	}
 
@@ -1293,15 +1447,133 @@ static PathfindingState *convert_polygon_set(EngineState *s, reg_t poly_list, Co
 		Vertex *vertex;
 
 		CLIST_FOREACH(vertex, &polygon->vertices) {
+			vertex->index = count;
 			pf_s->vertex_index[count++] = vertex;
 		}
 	}
 
 	pf_s->vertices = count;
 
+	// Look up the visibility graph of the vertices with edges
+	Common::Array<int16> key;
+	int edgeVertices = 0;
+
+	pf_s->visIndex = (int *)malloc(sizeof(int) * count);
+
+	for (PolygonList::iterator it = pf_s->polygons.begin(); it != pf_s->polygons.end(); ++it) {
+		polygon = *it;
+		Vertex *vertex;
+
+		if (!VERTEX_HAS_EDGES(polygon->vertices.first())) {
+			pf_s->visIndex[polygon->vertices.first()->index] = -1;
+			continue;
+		}
+
+		key.push_back(polygon->vertices.size());
+
+		CLIST_FOREACH(vertex, &polygon->vertices) {
+			key.push_back(vertex->v.x);
+			key.push_back(vertex->v.y);
+			pf_s->visIndex[vertex->index] = edgeVertices++;
+		}
+	}
+
+	if (!s->_pathfindingCache)
+		s->_pathfindingCache = new PathfindingCache();
+
+	pf_s->visGraph = s->_pathfindingCache->lookup(key, edgeVertices);
+
+	debugC(kDebugLevelAvoidPath, "[avoidpath] Visibility cache: %d hits, %d misses",
+	       s->_pathfindingCache->getHits(), s->_pathfindingCache->getMisses());
+
 	return pf_s;
 }
 
+/**
+ * Binary min-heap of the vertices in the A* open set, ordered on F cost. Of
+ * vertices with equal F cost, the one that entered the open set last comes
+ * out first, which matches the order in which the original linear scan over
+ * the open set picked them.
+ */
+class OpenSet {
+public:
+	OpenSet() : _order(0) {}
+
+	bool empty() const { return _heap.empty(); }
+
+	Vertex *top() const { return _heap[0]; }
+
+	void push(Vertex *vertex) {
+		vertex->openOrder = _order++;
+		vertex->heapPos = _heap.size();
+		_heap.push_back(vertex);
+		siftUp(vertex->heapPos);
+	}
+
+	void pop() {
+		Vertex *last = _heap.back();
+		_heap[0]->heapPos = -1;
+		_heap.pop_back();
+
+		if (!_heap.empty()) {
+			_heap[0] = last;
+			last->heapPos = 0;
+			siftDown(0);
+		}
+	}
+
+	/** Restores the heap order after the F cost of a vertex has decreased */
+	void update(Vertex *vertex) {
+		siftUp(vertex->heapPos);
+	}
+
+private:
+	static bool before(const Vertex *a, const Vertex *b) {
+		if (a->costF != b->costF)
+			return a->costF < b->costF;
+		return a->openOrder > b->openOrder;
+	}
+
+	void place(uint pos, Vertex *vertex) {
+		_heap[pos] = vertex;
+		vertex->heapPos = pos;
+	}
+
+	void siftUp(uint pos) {
+		Vertex *vertex = _heap[pos];
+
+		while (pos > 0) {
+			uint parent = (pos - 1) / 2;
+			if (!before(vertex, _heap[parent]))
+				break;
+			place(pos, _heap[parent]);
+			pos = parent;
+		}
+
+		place(pos, vertex);
+	}
+
+	void siftDown(uint pos) {
+		Vertex *vertex = _heap[pos];
+		uint size = _heap.size();
+
+		while (2 * pos + 1 < size) {
+			uint child = 2 * pos + 1;
+			if (child + 1 < size && before(_heap[child + 1], _heap[child]))
+				child++;
+			if (!before(_heap[child], vertex))
+				break;
+			place(pos, _heap[child]);
+			pos = child;
+		}
+
+		place(pos, vertex);
+	}
+
+	Common::Array<Vertex *> _heap;
+	uint32 _order;
+};
+
 /**
  * Computes a shortest path from vertex_start to vertex_end. The caller can
  * construct the resulting path by following the path_prev links from
@@ -1310,40 +1582,27 @@ static PathfindingState *convert_polygon_set(EngineState *s, reg_t poly_list, Co
  * Parameters: (PathfindingState *) s: The pathfinding state
  */
 static void AStar(PathfindingState *s) {
-	// Vertices of which the shortest path is known
-	VertexList closedSet;
-
-	// The remaining vertices
-	VertexList openSet;
+	// The vertices of which the shortest path is not known yet. Vertices of
+	// which it is known are flagged as closed.
+	OpenSet openSet;
 
-	openSet.push_front(s->vertex_start);
 	s->vertex_start->costG = 0;
 	s->vertex_start->costF = (uint32)sqrt((float)s->vertex_start->v.sqrDist(s->vertex_end->v));
+	openSet.push(s->vertex_start);
 
 	while (!openSet.empty()) {
-		// Find vertex in open set with lowest F cost
-		VertexList::iterator vertex_min_it = openSet.end();
-		Vertex *vertex_min = 0;
-		uint32 min = HUGE_DISTANCE;
+		// Take vertex in open set with lowest F cost
+		Vertex *vertex_min = openSet.top();
 
-		for (VertexList::iterator it = openSet.begin(); it != openSet.end(); ++it) {
-			Vertex *vertex = *it;
-			if (vertex->costF < min) {
-				vertex_min_it = it;
-				vertex_min = *vertex_min_it;
-				min = vertex->costF;
-			}
-		}
-
-		assert(vertex_min != 0);	// the vertex cost should never be bigger than HUGE_DISTANCE
+		assert(vertex_min->costF < HUGE_DISTANCE);	// the vertex cost should never be bigger than HUGE_DISTANCE
 
 		// Check if we are done
 		if (vertex_min == s->vertex_end)
 			break;
 
 		// Move vertex from set open to set closed
-		closedSet.push_front(vertex_min);
-		openSet.erase(vertex_min_it);
+		openSet.pop();
+		vertex_min->closed = true;
 
 		VertexList *visVerts = visible_vertices(s, vertex_min);
 
@@ -1351,12 +1610,9 @@ static void AStar(PathfindingState *s) {
 			uint32 new_dist;
 			Vertex *vertex = *it;
 
-			if (closedSet.contains(vertex))
+			if (vertex->closed)
 				continue;
 
-			if (!openSet.contains(vertex))
-				openSet.push_front(vertex);
-
 			new_dist = vertex_min->costG + (uint32)sqrt((float)vertex_min->v.sqrDist(vertex->v));
 
 			// When travelling to a vertex on the screen edge, we
@@ -1383,6 +1639,11 @@ static void AStar(PathfindingState *s) {
 				vertex->costF = vertex->costG + (uint32)sqrt((float)vertex->v.sqrDist(s->vertex_end->v));
 				vertex->path_prev = vertex_min;
 			}
+
+			if (vertex->heapPos == -1)
+				openSet.push(vertex);
+			else
+				openSet.update(vertex);
 		}
 
 		delete visVerts;
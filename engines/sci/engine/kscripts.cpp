@@ -42,6 +42,10 @@ reg_t kLoad(EngineState *s, int argc, reg_t *argv) {
 	if (restype == kResourceTypeMemory)
 		return s->_segMan->allocateHunkEntry("kLoad()", resnr);
 
+	// Rooms load their resources up front, so let the resource manager read
+	// them while the game is idle (if warm-up is enabled)
+	g_sci->getResMan()->queuePreload(ResourceId(restype, resnr));
+
 	return make_reg(0, ((restype << 11) | resnr)); // Return the resource identifier as handle
 }
 
@@ -64,6 +64,7 @@ void Script::freeScript() {
 	_lockers = 1;
 	_markedAsDeleted = false;
 	_objects.clear();
+	invalidateDecodedCode();
 }
 
 void Script::load(int script_nr, ResourceManager *resMan, ScriptPatcher *scriptPatcher) {
@@ -464,9 +465,59 @@ void Script::mcpyInOut(int dst, const void *src, size_t n) {
 	if (_buf) {
 		assert(dst + n <= _bufSize);
 		memcpy(_buf + dst, src, n);
+		invalidateDecodedCode();
 	}
 }
 
+const PMachineInstruction *Script::getDecodedInstruction(uint32 offset) {
+	if (offset >= _bufSize)
+		return NULL;
+
+	if (_decodedSlots.empty())
+		_decodedSlots.resize(_bufSize);
+
+	uint16 slot = _decodedSlots[offset];
+	if (slot) {
+		PMachineInstruction &instruction = _decodedCode[slot - 1];
+		if (instruction.size <= PMachineInstruction::kMaxSize && offset + instruction.size <= _bufSize &&
+			!memcmp(instruction.bytes, _buf + offset, instruction.size))
+			return &instruction;
+	} else {
+		if (_decodedCode.size() >= 0xFFFF)
+			return NULL;
+		_decodedCode.push_back(PMachineInstruction());
+		slot = _decodedCode.size();
+		_decodedSlots[offset] = slot;
+	}
+
+	PMachineInstruction &instruction = _decodedCode[slot - 1];
+	instruction.size = readPMachineInstruction(_buf + offset, instruction.extOpcode, instruction.params);
+	instruction.jumpTarget = 0;
+
+	// Keep the bytecode, so that changes to any of it are noticed
+	if (instruction.size > PMachineInstruction::kMaxSize || offset + instruction.size > _bufSize)
+		return NULL;
+	memcpy(instruction.bytes, _buf + offset, instruction.size);
+
+	switch (instruction.extOpcode >> 1) {
+	case op_bt:
+	case op_bnt:
+	case op_jmp:
+	case op_call:
+		instruction.jumpTarget = offset + instruction.size + instruction.params[0];
+		break;
+	default:
+		break;
+	}
+
+	return &instruction;
+}
+
+void Script::invalidateDecodedCode() {
+	_decodedSlots.clear();
+	_decodedCode.clear();
+}
+
 bool Script::isValidOffset(uint16 offset) const {
 	return offset < _bufSize;
 }
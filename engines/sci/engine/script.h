@@ -49,6 +49,22 @@ enum ScriptObjectTypes {
 
 typedef Common::HashMap<uint16, Object> ObjMap;
 
+/**
+ * A PMachine instruction as decoded by readPMachineInstruction(), cached by
+ * the script it belongs to so that run_vm() does not have to parse the
+ * bytecode again each time the instruction is executed.
+ */
+struct PMachineInstruction {
+	/** Longest instruction that is cached; only op_file can be longer */
+	enum { kMaxSize = 8 };
+
+	byte extOpcode;     /**< "Extended" opcode, including the operand size bit */
+	uint16 size;        /**< Length of the instruction in bytes */
+	int16 params[4];    /**< Decoded operands */
+	uint32 jumpTarget;  /**< Resolved target offset of branches, jumps and local calls */
+	byte bytes[kMaxSize]; /**< The bytecode the instruction was decoded from */
+};
+
 class Script : public SegmentObj {
 private:
 	int _nr; /**< Script number */
@@ -75,6 +91,9 @@ private:
 
 	ObjMap _objects;	/**< Table for objects, contains property variables */
 
+	Common::Array<uint16> _decodedSlots; /**< Per buffer offset: index + 1 into _decodedCode, 0 if not decoded yet */
+	Common::Array<PMachineInstruction> _decodedCode;
+
 public:
 	int getLocalsOffset() const { return _localsOffset; }
 	uint16 getLocalsCount() const { return _localsCount; }
@@ -226,6 +245,24 @@ public:
 	 */
 	void mcpyInOut(int dst, const void *src, size_t n);
 
+	/**
+	 * Returns the instruction at the given offset, decoding it the first time
+	 * it is requested. Scripts mix code and data, so there is no upfront pass
+	 * over the whole buffer: only offsets that are actually executed get
+	 * decoded. An entry is decoded again if any of its bytes has changed in
+	 * the meantime.
+	 * @param offset	script-relative offset of the instruction
+	 * @return			the decoded instruction, or NULL if it could not be
+	 * 					cached and has to be read from the bytecode instead
+	 */
+	const PMachineInstruction *getDecodedInstruction(uint32 offset);
+
+	/**
+	 * Drops all decoded instructions, for when the script buffer has been
+	 * written to.
+	 */
+	void invalidateDecodedCode();
+
 	/**
 	 * Finds the pointer where a block of a specific type starts from,
 	 * in SCI0 - SCI1 games
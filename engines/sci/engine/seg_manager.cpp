@@ -40,6 +40,9 @@ SegManager::SegManager(ResourceManager *resMan, ScriptPatcher *scriptPatcher)
 	_saveDirPtr = NULL_REG;
 	_parserPtr = NULL_REG;
 
+	_gcBarrierActive = false;
+	_gcSegmentsChanged = false;
+
 #ifdef ENABLE_SCI32
 	_arraysSegId = 0;
 	_stringSegId = 0;
@@ -63,6 +66,7 @@ void SegManager::resetSegMan() {
 
 	// And reinitialize
 	_heap.push_back(0);
+	_gcSegmentsChanged = true;
 
 	_clonesSegId = 0;
 	_listsSegId = 0;
@@ -124,6 +128,9 @@ SegmentObj *SegManager::allocSegment(SegmentObj *mem, SegmentId *segid) {
 	}
 	_heap[id] = mem;
 
+	if (_gcBarrierActive)
+		_gcSegmentsChanged = true;
+
 	return mem;
 }
 
@@ -170,6 +177,18 @@ void SegManager::deallocate(SegmentId seg) {
 
 	delete mobj;
 	_heap[seg] = NULL;
+
+	if (_gcBarrierActive)
+		_gcSegmentsChanged = true;
+}
+
+void SegManager::setGCBarrier(bool active) {
+	_gcBarrierActive = active;
+	_gcSegmentsChanged = false;
+	_gcAllocations.clear();
+	_gcDirtySegments.clear();
+	if (active)
+		_gcDirtySegments.resize(_heap.size());
 }
 
 bool SegManager::isHeapObject(reg_t pos) const {
@@ -230,6 +249,8 @@ Object *SegManager::getObject(reg_t pos) const {
 	SegmentObj *mobj = getSegmentObj(pos.getSegment());
 	Object *obj = NULL;
 
+	gcWriteBarrier(pos.getSegment());
+
 	if (mobj != NULL) {
 		if (mobj->getType() == SEG_TYPE_CLONES) {
 			CloneTable *ct = (CloneTable *)mobj;
@@ -390,6 +411,7 @@ reg_t SegManager::allocateHunkEntry(const char *hunk_type, int size) {
 
 	reg_t addr = make_reg(_hunksSegId, offset);
 	Hunk *h = &(table->_table[offset]);
+	gcRecordAllocation(addr);
 
 	if (!h)
 		return NULL_REG;
@@ -424,6 +446,7 @@ Clone *SegManager::allocateClone(reg_t *addr) {
 	offset = table->allocEntry();
 
 	*addr = make_reg(_clonesSegId, offset);
+	gcRecordAllocation(*addr);
 	return &(table->_table[offset]);
 }
 
@@ -438,6 +461,7 @@ List *SegManager::allocateList(reg_t *addr) {
 	offset = table->allocEntry();
 
 	*addr = make_reg(_listsSegId, offset);
+	gcRecordAllocation(*addr);
 	return &(table->_table[offset]);
 }
 
@@ -452,6 +476,7 @@ Node *SegManager::allocateNode(reg_t *addr) {
 	offset = table->allocEntry();
 
 	*addr = make_reg(_nodesSegId, offset);
+	gcRecordAllocation(*addr);
 	return &(table->_table[offset]);
 }
 
@@ -472,6 +497,7 @@ List *SegManager::lookupList(reg_t addr) {
 	}
 
 	ListTable *lt = (ListTable *)_heap[addr.getSegment()];
+	gcWriteBarrier(addr.getSegment());
 
 	if (!lt->isValidEntry(addr.getOffset())) {
 		error("Attempt to use non-list %04x:%04x as list", PRINT_REG(addr));
@@ -493,6 +519,7 @@ Node *SegManager::lookupNode(reg_t addr, bool stopOnDiscarded) {
 	}
 
 	NodeTable *nt = (NodeTable *)_heap[addr.getSegment()];
+	gcWriteBarrier(addr.getSegment());
 
 	if (!nt->isValidEntry(addr.getOffset())) {
 		if (!stopOnDiscarded)
@@ -515,6 +542,7 @@ SegmentRef SegManager::dereference(reg_t pointer) {
 	}
 
 	SegmentObj *mobj = _heap[pointer.getSegment()];
+	gcWriteBarrier(pointer.getSegment());
 	return mobj->dereference(pointer);
 }
 
@@ -855,6 +883,7 @@ SciArray<reg_t> *SegManager::allocateArray(reg_t *addr) {
 	offset = table->allocEntry();
 
 	*addr = make_reg(_arraysSegId, offset);
+	gcRecordAllocation(*addr);
 	return &(table->_table[offset]);
 }
 
@@ -863,6 +892,7 @@ SciArray<reg_t> *SegManager::lookupArray(reg_t addr) {
 		error("Attempt to use non-array %04x:%04x as array", PRINT_REG(addr));
 
 	ArrayTable *arrayTable = (ArrayTable *)_heap[addr.getSegment()];
+	gcWriteBarrier(addr.getSegment());
 
 	if (!arrayTable->isValidEntry(addr.getOffset()))
 		error("Attempt to use non-array %04x:%04x as array", PRINT_REG(addr));
@@ -895,6 +925,7 @@ SciString *SegManager::allocateString(reg_t *addr) {
 	offset = table->allocEntry();
 
 	*addr = make_reg(_stringSegId, offset);
+	gcRecordAllocation(*addr);
 	return &(table->_table[offset]);
 }
 
@@ -903,6 +934,7 @@ SciString *SegManager::lookupString(reg_t addr) {
 		error("lookupString: Attempt to use non-string %04x:%04x as string", PRINT_REG(addr));
 
 	StringTable *stringTable = (StringTable *)_heap[addr.getSegment()];
+	gcWriteBarrier(addr.getSegment());
 
 	if (!stringTable->isValidEntry(addr.getOffset()))
 		error("lookupString: Attempt to use non-string %04x:%04x as string", PRINT_REG(addr));
@@ -441,7 +441,46 @@ public:
 
 	const Common::Array<SegmentObj *> &getSegments() const { return _heap; }
 
+	// Incremental garbage collection support, see run_gc_step()
+
+	/**
+	 * Starts or stops tracking which segments may be written to, and which
+	 * entries get allocated, while an incremental collection is marking.
+	 */
+	void setGCBarrier(bool active);
+
+	/**
+	 * Write barrier: records that the given segment may be modified through
+	 * a pointer that has just been handed out.
+	 */
+	void gcWriteBarrier(SegmentId seg) const {
+		if (_gcBarrierActive && seg < _gcDirtySegments.size())
+			_gcDirtySegments[seg] = true;
+	}
+
+	/** Returns true if the segment has been written to since setGCBarrier(true) */
+	bool isGCDirty(SegmentId seg) const { return seg < _gcDirtySegments.size() && _gcDirtySegments[seg]; }
+
+	/** Returns true if segments have been allocated or freed since setGCBarrier(true) */
+	bool haveGCSegmentsChanged() const { return _gcSegmentsChanged; }
+
+	/** Entries allocated since setGCBarrier(true) or the last call; the caller clears the array */
+	Common::Array<reg_t> &getGCAllocations() { return _gcAllocations; }
+
 private:
+	void gcRecordAllocation(reg_t addr) {
+		if (_gcBarrierActive) {
+			_gcAllocations.push_back(addr);
+			// The slot may have been in use and marked before
+			gcWriteBarrier(addr.getSegment());
+		}
+	}
+
+	bool _gcBarrierActive;
+	bool _gcSegmentsChanged;
+	mutable Common::Array<bool> _gcDirtySegments;
+	Common::Array<reg_t> _gcAllocations;
+
 	Common::Array<SegmentObj *> _heap;
 	Common::Array<Class> _classTable; /**< Table of all classes */
 	/** Map script ids to segment ids. */
@@ -27,6 +27,7 @@
 #include "sci/event.h"
 
 #include "sci/engine/file.h"
+#include "sci/engine/gc.h"
 #include "sci/engine/kernel.h"
 #include "sci/engine/state.h"
 #include "sci/engine/selector.h"
@@ -73,12 +74,14 @@ EngineState::EngineState(SegManager *segMan)
 #ifdef ENABLE_SCI32
 	_virtualIndexFile(0),
 #endif
-	_dirseeker() {
+	_dirseeker(), _gcState(new GCState()), _pathfindingCache(0) {
 
 	reset(false);
 }
 
 EngineState::~EngineState() {
+	delete _gcState;
+	freePathfindingCache(_pathfindingCache);
 	delete _msgState;
 #ifdef ENABLE_SCI32
 	delete _virtualIndexFile;
@@ -90,6 +93,7 @@ void EngineState::reset(bool isRestoring) {
 		_memorySegmentSize = 0;
 		_fileHandles.resize(5);
 		abortScriptProcessing = kAbortNone;
+		gcIncremental = false;
 	}
 
 	executionStackBase = 0;
@@ -104,6 +108,7 @@ void EngineState::reset(bool isRestoring) {
 	lastWaitTime = 0;
 
 	gcCountDown = 0;
+	cancel_gc(this);
 
 	_throttleCounter = 0;
 	_throttleLastTime = 0;
@@ -135,7 +140,11 @@ void EngineState::speedThrottler(uint32 neededSleep) {
 		uint32 duration = curTime - _throttleLastTime;
 
 		if (duration < neededSleep) {
-			g_sci->sleep(neededSleep - duration);
+			// Use the idle time to load queued resources
+			g_sci->getResMan()->processPreloads(neededSleep - duration);
+			duration = g_system->getMillis() - _throttleLastTime;
+			if (duration < neededSleep)
+				g_sci->sleep(neededSleep - duration);
 			_throttleLastTime = g_system->getMillis();
 		} else {
 			_throttleLastTime = curTime;
@@ -45,11 +45,16 @@ namespace Sci {
 
 class FileHandle;
 class DirSeeker;
+struct GCState;
+class PathfindingCache;
 class EventManager;
 class MessageState;
 class SoundCommandParser;
 class VirtualIndexFile;
 
+/** Frees the kAvoidPath visibility graph cache, see kpathing.cpp */
+void freePathfindingCache(PathfindingCache *cache);
+
 enum AbortGameState {
 	kAbortNone = 0,
 	kAbortLoadGame = 1,
@@ -184,6 +189,10 @@ public:
 	void shrinkStackToBase();
 
 	int gcCountDown; /**< Number of kernel calls until next gc */
+	bool gcIncremental; /**< Spread garbage collections over several kernel calls */
+	GCState *_gcState; /**< Incremental collection in progress, and GC statistics */
+
+	PathfindingCache *_pathfindingCache; /**< Visibility graphs of recently used kAvoidPath polygon sets */
 
 	MessageState *_msgState;
 
@@ -22,6 +22,7 @@
 
 #include "common/debug.h"
 #include "common/debug-channels.h"
+#include "common/system.h"
 
 #include "sci/sci.h"
 #include "sci/console.h"
@@ -200,6 +201,11 @@ static void write_var(EngineState *s, int type, int index, reg_t value) {
 
 		s->variables[type][index] = value;
 
+		// Globals and locals are not roots of the garbage collector,
+		// so tell it about the write
+		if (type == VAR_GLOBAL || type == VAR_LOCAL)
+			s->_segMan->gcWriteBarrier(s->variablesSegment[type]);
+
 		if (type == VAR_GLOBAL && index == 90) {
 			// The game is trying to change its speech/subtitle settings
 			if (!g_sci->getEngineState()->_syncedAudioOptions || s->variables[VAR_GLOBAL][4] == TRUE_REG) {
@@ -542,6 +548,8 @@ void run_vm(EngineState *s) {
 	reg_t r_temp; // Temporary register
 	StackPtr s_temp; // Temporary stack pointer
 	int16 opparams[4]; // opcode parameters
+	uint32 jumpTarget; // resolved target of branches, jumps and local calls
+	VMProfile &vmProfile = g_sci->_debugState._vmProfile;
 
 	s->r_rest = 0;	// &rest adjusts the parameter count by this value
 	// Current execution data:
@@ -621,10 +629,28 @@ void run_vm(EngineState *s) {
 			error("run_vm(): program counter gone astray, addr: %d, code buffer size: %d",
 			s->xs->addr.pc.getOffset(), scr->getBufSize());
 
-		// Get opcode
+		// Get opcode. Instructions are normally taken from the script's cache
+		// of decoded code. While debugging, they are read from the bytecode,
+		// so that whatever has been done to the script memory in the
+		// console is always honored.
 		byte extOpcode;
-		s->xs->addr.pc.incOffset(readPMachineInstruction(scr->getBuf(s->xs->addr.pc.getOffset()), extOpcode, opparams));
+		const PMachineInstruction *decoded = NULL;
+		if (!g_sci->_debugState.debugging)
+			decoded = scr->getDecodedInstruction(s->xs->addr.pc.getOffset());
+
+		if (decoded) {
+			extOpcode = decoded->extOpcode;
+			memcpy(opparams, decoded->params, sizeof(opparams));
+			jumpTarget = decoded->jumpTarget;
+			s->xs->addr.pc.incOffset(decoded->size);
+		} else {
+			s->xs->addr.pc.incOffset(readPMachineInstruction(scr->getBuf(s->xs->addr.pc.getOffset()), extOpcode, opparams));
+			jumpTarget = s->xs->addr.pc.getOffset() + opparams[0];
+		}
 		const byte opcode = extOpcode >> 1;
+
+		if (vmProfile.enabled)
+			vmProfile.opcodeCounts[opcode]++;
 		//debug("%s: %d, %d, %d, %d, acc = %04x:%04x, script %d, local script %d", opcodeNames[opcode], opparams[0], opparams[1], opparams[2], opparams[3], PRINT_REG(s->r_acc), scr->getScriptNumber(), local_script->getScriptNumber());
 
 #ifdef ABORT_ON_INFINITE_LOOP
@@ -759,7 +785,7 @@ void run_vm(EngineState *s) {
 		case op_bt: // 0x17 (23)
 			// Branch relative if true
 			if (s->r_acc.getOffset() || s->r_acc.getSegment())
-				s->xs->addr.pc.incOffset(opparams[0]);
+				s->xs->addr.pc.setOffset(jumpTarget);
 
 			if (s->xs->addr.pc.getOffset() >= local_script->getScriptSize())
 				error("[VM] op_bt: request to jump past the end of script %d (offset %d, script is %d bytes)",
@@ -769,7 +795,7 @@ void run_vm(EngineState *s) {
 		case op_bnt: // 0x18 (24)
 			// Branch relative if not true
 			if (!(s->r_acc.getOffset() || s->r_acc.getSegment()))
-				s->xs->addr.pc.incOffset(opparams[0]);
+				s->xs->addr.pc.setOffset(jumpTarget);
 
 			if (s->xs->addr.pc.getOffset() >= local_script->getScriptSize())
 				error("[VM] op_bnt: request to jump past the end of script %d (offset %d, script is %d bytes)",
@@ -777,7 +803,7 @@ void run_vm(EngineState *s) {
 			break;
 
 		case op_jmp: // 0x19 (25)
-			s->xs->addr.pc.incOffset(opparams[0]);
+			s->xs->addr.pc.setOffset(jumpTarget);
 
 			if (s->xs->addr.pc.getOffset() >= local_script->getScriptSize())
 				error("[VM] op_jmp: request to jump past the end of script %d (offset %d, script is %d bytes)",
@@ -826,7 +852,7 @@ void run_vm(EngineState *s) {
 			StackPtr call_base = s->xs->sp - argc;
 			s->xs->sp[1].incOffset(s->r_rest);
 
-			uint32 localCallOffset = s->xs->addr.pc.getOffset() + opparams[0];
+			uint32 localCallOffset = jumpTarget;
 
 			ExecStack xstack(s->xs->objp, s->xs->objp, s->xs->sp,
 							(call_base->requireUint16()) + s->r_rest, call_base,
@@ -845,10 +871,17 @@ void run_vm(EngineState *s) {
 		}
 
 		case op_callk: { // 0x21 (33)
-			// Run the garbage collector, if needed
-			if (s->gcCountDown-- <= 0) {
+			// Run the garbage collector, if needed. Once an incremental
+			// collection has been started, it gets a step on every kernel
+			// call until it is done.
+			if (s->gcIncremental && gc_in_progress(s)) {
+				run_gc_step(s);
+			} else if (s->gcCountDown-- <= 0) {
 				s->gcCountDown = s->scriptGCInterval;
-				run_gc(s);
+				if (s->gcIncremental)
+					run_gc_step(s);
+				else
+					run_gc(s);
 			}
 
 			// Call kernel function
@@ -863,7 +896,13 @@ void run_vm(EngineState *s) {
 			if (!oldScriptHeader)
 				argc += s->r_rest;
 
-			callKernelFunc(s, opparams[0], argc);
+			if (vmProfile.enabled) {
+				uint32 kernelStartTime = g_system->getMillis();
+				callKernelFunc(s, opparams[0], argc);
+				vmProfile.addKernelCall(opparams[0], g_system->getMillis() - kernelStartTime);
+			} else {
+				callKernelFunc(s, opparams[0], argc);
+			}
 
 			if (!oldScriptHeader)
 				s->r_rest = 0;
@@ -1086,6 +1125,9 @@ void run_vm(EngineState *s) {
 		case op_aTop: // 0x32 (50)
 			// Accumulator To Property
 			validate_property(s, obj, opparams[0]) = s->r_acc;
+			// obj is cached across incremental GC steps, so property
+			// writes have to tell the collector about themselves
+			s->_segMan->gcWriteBarrier(s->xs->objp.getSegment());
 			break;
 
 		case op_pTos: // 0x33 (51)
@@ -1096,6 +1138,7 @@ void run_vm(EngineState *s) {
 		case op_sTop: // 0x34 (52)
 			// Stack To Property
 			validate_property(s, obj, opparams[0]) = POP32();
+			s->_segMan->gcWriteBarrier(s->xs->objp.getSegment());
 			break;
 
 		case op_ipToa: // 0x35 (53)
@@ -1110,6 +1153,7 @@ void run_vm(EngineState *s) {
 				opProperty += 1;
 			else
 				opProperty -= 1;
+			s->_segMan->gcWriteBarrier(s->xs->objp.getSegment());
 
 			if (opcode == op_ipToa || opcode == op_dpToa)
 				s->r_acc = opProperty;
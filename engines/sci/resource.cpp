@@ -22,9 +22,11 @@
 
 // Resource library
 
+#include "common/config-manager.h"
 #include "common/file.h"
 #include "common/fs.h"
 #include "common/macresman.h"
+#include "common/system.h"
 #include "common/textconsole.h"
 
 #include "sci/resource.h"
@@ -189,6 +191,7 @@ Resource::Resource(ResourceManager *resMan, ResourceId id) : _resMan(resMan), _i
 	_fileOffset = 0;
 	_status = kResStatusNoMalloc;
 	_lockers = 0;
+	_compressed = false;
 	_source = NULL;
 	_header = NULL;
 	_headerSize = 0;
@@ -368,7 +371,15 @@ Common::SeekableReadStream *ResourceManager::getVolumeFile(ResourceSource *sourc
 }
 
 void ResourceManager::loadResource(Resource *res) {
+	uint32 startTime = g_system->getMillis();
+
+	res->_compressed = false;
 	res->_source->loadResource(this, res);
+
+	if (res->_compressed) {
+		_cacheStats.decompressions++;
+		_cacheStats.decompressTime += g_system->getMillis() - startTime;
+	}
 }
 
 
@@ -967,7 +978,11 @@ ResourceManager::ResourceManager() {
 void ResourceManager::init(bool initFromFallbackDetector) {
 	_memoryLocked = 0;
 	_memoryLRU = 0;
+	_maxMemoryLRU = MAX_MEMORY;
 	_LRU.clear();
+	_cacheStats.reset();
+	_preloadEnabled = false;
+	_preloadQueue.clear();
 	_resMap.clear();
 	_audioMapSCI1 = NULL;
 
@@ -1019,6 +1034,15 @@ void ResourceManager::init(bool initFromFallbackDetector) {
 
 	debugC(1, kDebugLevelResMan, "resMan: Detected %s", getSciVersionDesc(getSciVersion()));
 
+	// SCI32 resources are much larger, so keep more of them around
+	if (getSciVersion() >= SCI_VERSION_2)
+		_maxMemoryLRU = MAX_MEMORY_SCI32;
+	if (ConfMan.hasKey("resource_cache_size") && ConfMan.getInt("resource_cache_size") > 0)
+		_maxMemoryLRU = ConfMan.getInt("resource_cache_size") * 1024;
+	_preloadEnabled = ConfMan.hasKey("resource_warmup") && ConfMan.getBool("resource_warmup");
+
+	debugC(1, kDebugLevelResMan, "resMan: Keeping up to %d KB of unlocked resources", _maxMemoryLRU / 1024);
+
 	switch (_viewType) {
 	case kViewEga:
 		debugC(1, kDebugLevelResMan, "resMan: Detected EGA graphic resources");
@@ -1108,11 +1132,23 @@ void ResourceManager::printLRU() {
 }
 
 void ResourceManager::freeOldResources() {
-	while (MAX_MEMORY < _memoryLRU) {
+	while (_maxMemoryLRU < _memoryLRU) {
 		assert(!_LRU.empty());
-		Resource *goner = *_LRU.reverse_begin();
+
+		// Of the least recently used resources, free the oldest one that
+		// can be read back without decompressing it, if there is one
+		Common::List<Resource *>::iterator it = _LRU.reverse_begin();
+		Resource *goner = *it;
+
+		for (int i = 1; i < EVICTION_WINDOW && goner->_compressed && it != _LRU.begin(); i++) {
+			--it;
+			if (!(*it)->_compressed)
+				goner = *it;
+		}
+
 		removeFromLRU(goner);
 		goner->unalloc();
+		_cacheStats.evictions++;
 #ifdef SCI_VERBOSE_RESMAN
 		debug("resMan-debug: LRU: Freeing %s.%03d (%d bytes)", getResourceTypeName(goner->type), goner->number, goner->size);
 #endif
@@ -1138,10 +1174,14 @@ Resource *ResourceManager::findResource(ResourceId id, bool lock) {
 	if (!retval)
 		return NULL;
 
-	if (retval->_status == kResStatusNoMalloc)
+	if (retval->_status == kResStatusNoMalloc) {
+		_cacheStats.misses++;
 		loadResource(retval);
-	else if (retval->_status == kResStatusEnqueued)
-		removeFromLRU(retval);
+	} else {
+		_cacheStats.hits++;
+		if (retval->_status == kResStatusEnqueued)
+			removeFromLRU(retval);
+	}
 	// Unless an error occurred, the resource is now either
 	// locked or allocated, but never queued or freed.
 
@@ -1184,6 +1224,41 @@ void ResourceManager::unlockResource(Resource *res) {
 	freeOldResources();
 }
 
+void ResourceManager::setCacheSize(int size) {
+	_maxMemoryLRU = size;
+	freeOldResources();
+}
+
+void ResourceManager::queuePreload(ResourceId id) {
+	if (!_preloadEnabled)
+		return;
+
+	Resource *res = testResource(id);
+	if (res && res->_status == kResStatusNoMalloc)
+		_preloadQueue.push_back(id);
+}
+
+void ResourceManager::processPreloads(uint32 maxTime) {
+	uint32 startTime = g_system->getMillis();
+
+	while (!_preloadQueue.empty() && g_system->getMillis() - startTime < maxTime) {
+		Resource *res = testResource(_preloadQueue.front());
+		_preloadQueue.pop_front();
+
+		// Skip resources that have been loaded in the meantime
+		if (!res || res->_status != kResStatusNoMalloc)
+			continue;
+
+		loadResource(res);
+
+		if (res->_status == kResStatusAllocated) {
+			_cacheStats.preloads++;
+			addToLRU(res);
+			freeOldResources();
+		}
+	}
+}
+
 const char *ResourceManager::versionDescription(ResVersion version) const {
 	switch (version) {
 	case kResVersionUnknown:
@@ -2189,6 +2264,8 @@ int Resource::decompress(ResVersion volVersion, Common::SeekableReadStream *file
 	if (errorNum)
 		return errorNum;
 
+	_compressed = (compression != kCompNone);
+
 	// getting a decompressor
 	Decompressor *dec = NULL;
 	switch (compression) {
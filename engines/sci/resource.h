@@ -271,6 +271,7 @@ protected:
 	int32 _fileOffset; /**< Offset in file */
 	ResourceStatus _status;
 	uint16 _lockers; /**< Number of places where this resource was locked */
+	bool _compressed; /**< Whether the data had to be decompressed when it was loaded */
 	ResourceSource *_source;
 	ResourceManager *_resMan;
 
@@ -333,6 +334,53 @@ public:
 	 */
 	void unlockResource(Resource *res);
 
+	/** Counters for the cache of unlocked resources */
+	struct CacheStats {
+		uint32 hits;           ///< Lookups of resources that were still in memory
+		uint32 misses;         ///< Lookups that had to load the resource
+		uint32 evictions;      ///< Resources freed to stay within the cache size
+		uint32 decompressions; ///< Loads of compressed resources
+		uint32 decompressTime; ///< Milliseconds spent reading and decompressing those
+		uint32 preloads;       ///< Resources loaded ahead of time by the warm-up queue
+
+		CacheStats() { reset(); }
+
+		void reset() {
+			hits = misses = evictions = 0;
+			decompressions = decompressTime = 0;
+			preloads = 0;
+		}
+	};
+
+	const CacheStats &getCacheStats() const { return _cacheStats; }
+	void resetCacheStats() { _cacheStats.reset(); }
+
+	/** Returns the number of bytes of unlocked resources kept in memory at most */
+	int getCacheSize() const { return _maxMemoryLRU; }
+	/** Returns the number of bytes of unlocked resources currently in memory */
+	int getCacheUsage() const { return _memoryLRU; }
+	/** Returns the number of bytes of locked resources */
+	int getLockedMemory() const { return _memoryLocked; }
+
+	/**
+	 * Changes the cache size, freeing resources if necessary.
+	 * @param size	The number of bytes of unlocked resources to keep at most
+	 */
+	void setCacheSize(int size);
+
+	/**
+	 * Queues a resource to be loaded ahead of time, when the engine is
+	 * idle. Does nothing unless the "resource_warmup" option is set.
+	 * @param id	The resource to load
+	 */
+	void queuePreload(ResourceId id);
+
+	/**
+	 * Loads queued resources until the queue is empty or the time is up.
+	 * @param maxTime	Milliseconds that may be spent loading
+	 */
+	void processPreloads(uint32 maxTime);
+
 	/**
 	 * Tests whether a resource exists.
 	 *
@@ -410,19 +458,30 @@ public:
 	ResourceType convertResType(byte type);
 
 protected:
-	// Maximum number of bytes to allow being allocated for resources
+	// Default number of bytes to allow being allocated for resources. The
+	// "resource_cache_size" option (in KB) overrides this.
 	// Note: maxMemory will not be interpreted as a hard limit, only as a restriction
 	// for resources which are not explicitly locked. However, a warning will be
 	// issued whenever this limit is exceeded.
 	enum {
-		MAX_MEMORY = 256 * 1024	// 256KB
+		MAX_MEMORY = 256 * 1024,	// 256KB
+		MAX_MEMORY_SCI32 = 4 * 1024 * 1024	// 4MB
+	};
+
+	// Number of least recently used resources considered when freeing one
+	enum {
+		EVICTION_WINDOW = 8
 	};
 
 	ViewType _viewType; // Used to determine if the game has EGA or VGA graphics
 	Common::List<ResourceSource *> _sources;
 	int _memoryLocked;	///< Amount of resource bytes in locked memory
 	int _memoryLRU;		///< Amount of resource bytes under LRU control
+	int _maxMemoryLRU;	///< Amount of resource bytes allowed under LRU control
 	Common::List<Resource *> _LRU; ///< Last Resource Used list
+	CacheStats _cacheStats;
+	bool _preloadEnabled;	///< Whether queuePreload() queues anything
+	Common::List<ResourceId> _preloadQueue; ///< Resources to load when idle
 	ResourceMap _resMap;
 	Common::List<Common::File *> _volumeFiles; ///< list of opened volume files
 	ResourceSource *_audioMapSCI1; ///< Currently loaded audio map for SCI1
@@ -57,6 +57,9 @@ BaseFileManager::BaseFileManager(Common::Language lang, bool detectionMode) {
 	_detectionMode = detectionMode;
 	_language = lang;
 	_resources = nullptr;
+	// The packages do not change while the game runs, so remember which
+	// one provides each file instead of asking all of them every time
+	_packages.setIndexed(true);
 	initResources();
 	initPaths();
 	registerPackages();
@@ -48,10 +48,11 @@ BaseRenderer *makeOSystemRenderer(BaseGame *inGame) {
 }
 
 //////////////////////////////////////////////////////////////////////////
-BaseRenderOSystem::BaseRenderOSystem(BaseGame *inGame) : BaseRenderer(inGame) {
+BaseRenderOSystem::BaseRenderOSystem(BaseGame *inGame) : BaseRenderer(inGame), _dirtyTiles(kDirtyTileSize) {
 	_renderSurface = new Graphics::Surface();
 	_blankSurface = new Graphics::Surface();
 	_lastFrameIter = _renderQueue.end();
+	_lastFrameTicketsIndexed = false;
 	_needsFlip = true;
 	_skipThisFrame = false;
 
@@ -137,6 +138,7 @@ bool BaseRenderOSystem::initRenderer(int width, int height, bool windowed) {
 
 	_renderSurface->create(g_system->getWidth(), g_system->getHeight(), g_system->getScreenFormat());
 	_blankSurface->create(g_system->getWidth(), g_system->getHeight(), g_system->getScreenFormat());
+	_dirtyTiles.resize(_renderSurface->w, _renderSurface->h);
 	_blankSurface->fillRect(Common::Rect(0, 0, _blankSurface->h, _blankSurface->w), _blankSurface->format.ARGBToColor(255, 0, 0, 0));
 	_active = true;
 
@@ -156,11 +158,13 @@ bool BaseRenderOSystem::flip() {
 		_skipThisFrame = false;
 		delete _dirtyRect;
 		_dirtyRect = nullptr;
+		_dirtyTiles.clear();
 		g_system->updateScreen();
 		_needsFlip = false;
 
 		// Reset ticketing state
 		_lastFrameIter = _renderQueue.end();
+		resetTicketIndex();
 		RenderQueueIterator it;
 		for (it = _renderQueue.begin(); it != _renderQueue.end(); ++it) {
 			(*it)->_wantsDraw = false;
@@ -197,9 +201,11 @@ bool BaseRenderOSystem::flip() {
 		//  g_system->copyRectToScreen((byte *)_renderSurface->getPixels(), _renderSurface->pitch, _dirtyRect->left, _dirtyRect->top, _dirtyRect->width(), _dirtyRect->height());
 		delete _dirtyRect;
 		_dirtyRect = nullptr;
+		_dirtyTiles.clear();
 		_needsFlip = false;
 	}
 	_lastFrameIter = _renderQueue.end();
+	resetTicketIndex();
 
 	g_system->updateScreen();
 
@@ -285,22 +291,10 @@ void BaseRenderOSystem::drawSurface(BaseSurfaceOSystem *owner, const Graphics::S
 
 	if (owner) { // Fade-tickets are owner-less
 		RenderTicket compare(owner, nullptr, srcRect, dstRect, transform);
-		RenderQueueIterator it = _lastFrameIter;
-		++it;
-		// Avoid calling end() and operator* every time, when potentially going through
-		// LOTS of tickets.
-		RenderQueueIterator endIterator = _renderQueue.end();
-		RenderTicket *compareTicket = nullptr;
-		for (; it != endIterator; ++it) {
-			compareTicket = *it;
-			if (*(compareTicket) == compare && compareTicket->_isValid) {
-				if (_disableDirtyRects) {
-					drawFromSurface(compareTicket);
-				} else {
-					drawFromQueuedTicket(it);
-				}
-				return;
-			}
+		RenderQueueIterator it;
+		if (findLastFrameTicket(compare, it)) {
+			drawFromQueuedTicket(it);
+			return;
 		}
 	}
 	RenderTicket *ticket = new RenderTicket(owner, surf, srcRect, dstRect, transform);
@@ -313,6 +307,56 @@ void BaseRenderOSystem::drawSurface(BaseSurfaceOSystem *owner, const Graphics::S
 	}
 }
 
+bool BaseRenderOSystem::findLastFrameTicket(const RenderTicket &compare, RenderQueueIterator &ticket) {
+	// All tickets after _lastFrameIter are from last frame and have not been
+	// drawn yet. Usually the draw calls come in the same order as last frame,
+	// so try the next one first.
+	ticket = _lastFrameIter;
+	++ticket;
+	if (ticket == _renderQueue.end()) {
+		return false;
+	}
+	if (**ticket == compare && (*ticket)->_isValid) {
+		return true;
+	}
+
+	// Otherwise avoid going through LOTS of tickets for every draw call.
+	if (!_lastFrameTicketsIndexed) {
+		for (RenderQueueIterator it = ticket; it != _renderQueue.end(); ++it) {
+			_lastFrameTickets[(*it)->hash()].push_back(it);
+		}
+		_lastFrameTicketsIndexed = true;
+	}
+
+	TicketIndex::iterator bucket = _lastFrameTickets.find(compare.hash());
+	if (bucket == _lastFrameTickets.end()) {
+		return false;
+	}
+
+	Common::Array<RenderQueueIterator> &candidates = bucket->_value;
+	for (uint i = 0; i < candidates.size(); ) {
+		RenderTicket *candidate = *candidates[i];
+		if (candidate->_wantsDraw) {
+			// Drawn in order since the index was built
+			candidates.remove_at(i);
+		} else if (*candidate == compare && candidate->_isValid) {
+			ticket = candidates[i];
+			candidates.remove_at(i);
+			return true;
+		} else {
+			i++;
+		}
+	}
+	return false;
+}
+
+void BaseRenderOSystem::resetTicketIndex() {
+	if (_lastFrameTicketsIndexed) {
+		_lastFrameTickets.clear();
+		_lastFrameTicketsIndexed = false;
+	}
+}
+
 void BaseRenderOSystem::invalidateTicket(RenderTicket *renderTicket) {
 	addDirtyRect(renderTicket->_dstRect);
 	renderTicket->_isValid = false;
@@ -371,6 +415,10 @@ void BaseRenderOSystem::addDirtyRect(const Common::Rect &rect) {
 		_dirtyRect->extend(rect);
 	}
 	_dirtyRect->clip(_renderRect);
+
+	if (rect.intersects(_renderRect)) {
+		_dirtyTiles.addRect(rect.findIntersectingRect(_renderRect));
+	}
 }
 
 void BaseRenderOSystem::drawTickets() {
@@ -399,43 +447,61 @@ void BaseRenderOSystem::drawTickets() {
 		return;
 	}
 
+	// Split the dirty area into the parts that actually changed. Should there
+	// be too many, simply redraw all of it.
+	if (!_dirtyTiles.getRects(_dirtyRects, DIRTY_RECT_LIMIT, *_dirtyRect) || _dirtyRects.empty()) {
+		_dirtyRects.clear();
+		_dirtyRects.push_back(*_dirtyRect);
+		_dirtyTiles.addRect(*_dirtyRect);
+	}
+
 	it = _renderQueue.begin();
 	_lastFrameIter = _renderQueue.end();
 	// A special case: If the screen has one giant OPAQUE rect to be drawn, then we skip filling
 	// the background color. Typical use-case: Fullscreen FMVs.
 	// Caveat: The FPS-counter will invalidate this.
+	const RenderTicket *opaqueTicket = nullptr;
 	if (it != _lastFrameIter && _renderQueue.front() == _renderQueue.back() && (*it)->_transform._alphaDisable == true) {
+		opaqueTicket = *it;
+	}
+	for (uint i = 0; i < _dirtyRects.size(); i++) {
 		// If our single opaque rect fills the dirty rect, we can skip filling.
-		if (*_dirtyRect != (*it)->_dstRect) {
+		if (!opaqueTicket || !opaqueTicket->_dstRect.contains(_dirtyRects[i])) {
 			// Apply the clear-color to the dirty rect.
-			_renderSurface->fillRect(*_dirtyRect, _clearColor);
+			_renderSurface->fillRect(_dirtyRects[i], _clearColor);
 		}
-		// Otherwise Do NOT fill.
-	} else {
-		// Apply the clear-color to the dirty rect.
-		_renderSurface->fillRect(*_dirtyRect, _clearColor);
 	}
 	for (; it != _renderQueue.end(); ++it) {
 		RenderTicket *ticket = *it;
-		if (ticket->_dstRect.intersects(*_dirtyRect)) {
-			// dstClip is the area we want redrawn.
-			Common::Rect dstClip(ticket->_dstRect);
-			// reduce it to the dirty rect
-			dstClip.clip(*_dirtyRect);
-			// we need to keep track of the position to redraw the dirty rect
-			Common::Rect pos(dstClip);
-			int16 offsetX = ticket->_dstRect.left;
-			int16 offsetY = ticket->_dstRect.top;
-			// convert from screen-coords to surface-coords.
-			dstClip.translate(-offsetX, -offsetY);
-
-			drawFromSurface(ticket, &pos, &dstClip);
-			_needsFlip = true;
+		if (ticket->_dstRect.intersects(*_dirtyRect) && _dirtyTiles.isDirty(ticket->_dstRect)) {
+			for (uint i = 0; i < _dirtyRects.size(); i++) {
+				const Common::Rect &dirtyRect = _dirtyRects[i];
+				if (!ticket->_dstRect.intersects(dirtyRect)) {
+					continue;
+				}
+				// dstClip is the area we want redrawn.
+				Common::Rect dstClip(ticket->_dstRect);
+				// reduce it to the dirty rect
+				dstClip.clip(dirtyRect);
+				// we need to keep track of the position to redraw the dirty rect
+				Common::Rect pos(dstClip);
+				int16 offsetX = ticket->_dstRect.left;
+				int16 offsetY = ticket->_dstRect.top;
+				// convert from screen-coords to surface-coords.
+				dstClip.translate(-offsetX, -offsetY);
+
+				drawFromSurface(ticket, &pos, &dstClip);
+				_needsFlip = true;
+			}
 		}
 		// Some tickets want redraw but don't actually clip the dirty area (typically the ones that shouldnt become clear-color)
 		ticket->_wantsDraw = false;
 	}
-	g_system->copyRectToScreen((byte *)_renderSurface->getBasePtr(_dirtyRect->left, _dirtyRect->top), _renderSurface->pitch, _dirtyRect->left, _dirtyRect->top, _dirtyRect->width(), _dirtyRect->height());
+	for (uint i = 0; i < _dirtyRects.size(); i++) {
+		const Common::Rect &dirtyRect = _dirtyRects[i];
+		g_system->copyRectToScreen((byte *)_renderSurface->getBasePtr(dirtyRect.left, dirtyRect.top), _renderSurface->pitch, dirtyRect.left, dirtyRect.top, dirtyRect.width(), dirtyRect.height());
+	}
+	_dirtyTiles.clear();
 
 	it = _renderQueue.begin();
 	// Clean out the old tickets
@@ -575,6 +641,7 @@ void BaseRenderOSystem::endSaveLoad() {
 	// so just skip this single frame.
 	_skipThisFrame = true;
 	_lastFrameIter = _renderQueue.end();
+	resetTicketIndex();
 
 	_renderSurface->fillRect(Common::Rect(0, 0, _renderSurface->h, _renderSurface->w), _renderSurface->format.ARGBToColor(255, 0, 0, 0));
 	g_system->copyRectToScreen((byte *)_renderSurface->getPixels(), _renderSurface->pitch, 0, 0, _renderSurface->w, _renderSurface->h);
@@ -31,7 +31,9 @@
 
 #include "engines/wintermute/base/gfx/base_renderer.h"
 #include "common/rect.h"
+#include "graphics/dirtytiles.h"
 #include "graphics/surface.h"
+#include "common/hashmap.h"
 #include "common/list.h"
 #include "engines/wintermute/graphics/transform_struct.h"
 
@@ -122,6 +124,17 @@ private:
 	 * Traverse the tickets that are dirty, and draw them
 	 */
 	void drawTickets();
+	/**
+	 * Find the first ticket from last frame that has not been drawn again yet
+	 * and matches the given ticket.
+	 * @param compare the ticket to look for
+	 * @param ticket set to the position of the ticket in the queue, if found
+	 */
+	bool findLastFrameTicket(const RenderTicket &compare, RenderQueueIterator &ticket);
+	/**
+	 * Forget the index of last frame's tickets, called whenever a new frame starts.
+	 */
+	void resetTicketIndex();
 	// Non-dirty-rects:
 	void drawFromSurface(RenderTicket *ticket);
 	// Dirty-rects:
@@ -129,6 +142,25 @@ private:
 	Common::Rect *_dirtyRect;
 	Common::List<RenderTicket *> _renderQueue;
 
+	/**
+	 * The tickets from last frame which had not been drawn again when a draw
+	 * call did not match the next ticket in the queue, grouped by
+	 * RenderTicket::hash() in queue order. Built on demand once per frame.
+	 */
+	typedef Common::HashMap<uint, Common::Array<RenderQueueIterator> > TicketIndex;
+	TicketIndex _lastFrameTickets;
+	bool _lastFrameTicketsIndexed;
+
+	/**
+	 * The parts of the screen covered by _dirtyRect that actually changed,
+	 * so that drawTickets can skip the tickets and areas in between.
+	 */
+	Graphics::DirtyTileMap _dirtyTiles;
+	Common::Array<Common::Rect> _dirtyRects;
+	enum {
+		kDirtyTileSize = 32
+	};
+
 	bool _needsFlip;
 	RenderQueueIterator _lastFrameIter;
 	Common::Rect _renderRect;
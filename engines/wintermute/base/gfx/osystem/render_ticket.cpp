@@ -95,6 +95,19 @@ bool RenderTicket::operator==(const RenderTicket &t) const {
 	return true;
 }
 
+uint RenderTicket::hash() const {
+	const int16 values[] = {
+		_srcRect.left, _srcRect.top, _srcRect.right, _srcRect.bottom,
+		_dstRect.left, _dstRect.top, _dstRect.right, _dstRect.bottom
+	};
+
+	uint hash = (uint)(size_t)_owner;
+	for (int i = 0; i < ARRAYSIZE(values); i++) {
+		hash = hash * 31 + (uint16)values[i];
+	}
+	return hash;
+}
+
 // Replacement for SDL2's SDL_RenderCopy
 void RenderTicket::drawToSurface(Graphics::Surface *_targetSurface) const {
 	TransparentSurface src(*getSurface(), false);
@@ -33,6 +33,7 @@
 #include "common/rect.h"
 #include "common/math.h"
 #include "common/textconsole.h"
+#include "graphics/alpha_blit.h"
 #include "graphics/primitives.h"
 #include "engines/wintermute/graphics/transparent_surface.h"
 #include "engines/wintermute/graphics/transform_tools.h"
@@ -43,6 +44,7 @@ namespace Wintermute {
 
 void doBlitOpaqueFast(byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inStep, int32 inoStep);
 void doBlitBinaryFast(byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inStep, int32 inoStep);
+void doBlitAlphaFast(byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inoStep);
 
 // These gather together various blendPixel functions for use with templates.
 
@@ -313,13 +315,23 @@ void doBlitOpaqueFast(byte *ino, byte *outo, uint32 width, uint32 height, uint32
 	byte *in;
 	byte *out;
 
+	if (inStep == 4) {
+		for (uint32 i = 0; i < height; i++) {
+			Graphics::blitRowOpaque(ino, outo, width);
+			outo += pitch;
+			ino += inoStep;
+		}
+		return;
+	}
+
 	for (uint32 i = 0; i < height; i++) {
 		out = outo;
 		in = ino;
-		memcpy(out, in, width * 4);
 		for (uint32 j = 0; j < width; j++) {
+			*(uint32 *)out = *(uint32 *)in;
 			out[TransparentSurface::kAIndex] = 0xFF;
 			out += 4;
+			in += inStep;
 		}
 		outo += pitch;
 		ino += inoStep;
@@ -334,6 +346,15 @@ void doBlitBinaryFast(byte *ino, byte *outo, uint32 width, uint32 height, uint32
 	byte *in;
 	byte *out;
 
+	if (inStep == 4) {
+		for (uint32 i = 0; i < height; i++) {
+			Graphics::blitRowBinary(ino, outo, width);
+			outo += pitch;
+			ino += inoStep;
+		}
+		return;
+	}
+
 	for (uint32 i = 0; i < height; i++) {
 		out = outo;
 		in = ino;
@@ -354,6 +375,18 @@ void doBlitBinaryFast(byte *ino, byte *outo, uint32 width, uint32 height, uint32
 	}
 }
 
+/**
+ * Optimized version of doBlit<BlenderNormal> to be used w/alpha blending
+ * when there is no colormod and no horizontal flipping.
+ */
+void doBlitAlphaFast(byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inoStep) {
+	for (uint32 i = 0; i < height; i++) {
+		Graphics::blitRowAlpha(ino, outo, width);
+		outo += pitch;
+		ino += inoStep;
+	}
+}
+
 /**
  * What we have here is a template method that calls blendPixel() from a different
  * class - the one we call it with - thus performing a different type of blending.
@@ -538,6 +571,8 @@ Common::Rect TransparentSurface::blit(Graphics::Surface &target, int posX, int p
 			doBlitOpaqueFast(ino, outo, img->w, img->h, target.pitch, inStep, inoStep);
 		} else if (color == 0xFFFFFFFF && blendMode == BLEND_NORMAL && _alphaMode == ALPHA_BINARY) {
 			doBlitBinaryFast(ino, outo, img->w, img->h, target.pitch, inStep, inoStep);
+		} else if (color == 0xFFFFFFFF && blendMode == BLEND_NORMAL && inStep == 4) {
+			doBlitAlphaFast(ino, outo, img->w, img->h, target.pitch, inoStep);
 		} else {
 			if (blendMode == BLEND_ADDITIVE) {
 				doBlit<BlenderAdditive>(ino, outo, img->w, img->h, target.pitch, inStep, inoStep, color);
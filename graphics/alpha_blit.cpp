@@ -0,0 +1,202 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "graphics/alpha_blit.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define ALPHA_BLIT_SSE2
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ALPHA_BLIT_NEON
+#endif
+
+namespace Graphics {
+
+namespace {
+
+const uint32 kAlphaMask = 0xFF;
+
+#if defined(ALPHA_BLIT_SSE2)
+
+inline __m128i selectSSE2(__m128i mask, __m128i a, __m128i b) {
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+inline __m128i alphaSSE2(__m128i pix) {
+	return _mm_and_si128(pix, _mm_set1_epi32(kAlphaMask));
+}
+
+#elif defined(ALPHA_BLIT_NEON)
+
+inline uint32x4_t alphaNEON(uint32x4_t pix) {
+	return vandq_u32(pix, vdupq_n_u32(kAlphaMask));
+}
+
+#endif
+
+inline uint32 blendComponent(uint32 in, uint32 out, uint32 a, int shift) {
+	return ((((in >> shift) & 0xFF) * a + ((out >> shift) & 0xFF) * (255 - a)) >> 8) << shift;
+}
+
+} // End of anonymous namespace
+
+void blitRowOpaque(const byte *in, byte *out, uint32 width) {
+	uint32 j = 0;
+
+#if defined(ALPHA_BLIT_SSE2)
+	const __m128i alphaMaskV = _mm_set1_epi32(kAlphaMask);
+	for (; j + 4 <= width; j += 4) {
+		const __m128i pix = _mm_loadu_si128((const __m128i *)(in + j * 4));
+		_mm_storeu_si128((__m128i *)(out + j * 4), _mm_or_si128(pix, alphaMaskV));
+	}
+#elif defined(ALPHA_BLIT_NEON)
+	const uint32x4_t alphaMaskV = vdupq_n_u32(kAlphaMask);
+	for (; j + 4 <= width; j += 4) {
+		const uint32x4_t pix = vld1q_u32((const uint32 *)(in + j * 4));
+		vst1q_u32((uint32 *)(out + j * 4), vorrq_u32(pix, alphaMaskV));
+	}
+#endif
+
+	for (; j < width; j++)
+		((uint32 *)out)[j] = ((const uint32 *)in)[j] | kAlphaMask;
+}
+
+void blitRowBinary(const byte *in, byte *out, uint32 width) {
+	uint32 j = 0;
+
+#if defined(ALPHA_BLIT_SSE2)
+	const __m128i alphaMaskV = _mm_set1_epi32(kAlphaMask);
+	const __m128i zero = _mm_setzero_si128();
+	for (; j + 4 <= width; j += 4) {
+		const __m128i pix = _mm_loadu_si128((const __m128i *)(in + j * 4));
+		const __m128i clear = _mm_cmpeq_epi32(alphaSSE2(pix), zero);
+		const int clearBits = _mm_movemask_epi8(clear);
+		if (clearBits == 0xFFFF)
+			continue;
+
+		__m128i res = _mm_or_si128(pix, alphaMaskV);
+		if (clearBits != 0)
+			res = selectSSE2(clear, _mm_loadu_si128((const __m128i *)(out + j * 4)), res);
+		_mm_storeu_si128((__m128i *)(out + j * 4), res);
+	}
+#elif defined(ALPHA_BLIT_NEON)
+	const uint32x4_t alphaMaskV = vdupq_n_u32(kAlphaMask);
+	for (; j + 4 <= width; j += 4) {
+		const uint32x4_t pix = vld1q_u32((const uint32 *)(in + j * 4));
+		const uint32x4_t clear = vceqq_u32(alphaNEON(pix), vdupq_n_u32(0));
+		const uint32x4_t dst = vld1q_u32((const uint32 *)(out + j * 4));
+		vst1q_u32((uint32 *)(out + j * 4), vbslq_u32(clear, dst, vorrq_u32(pix, alphaMaskV)));
+	}
+#endif
+
+	for (; j < width; j++) {
+		const uint32 pix = ((const uint32 *)in)[j];
+		if ((pix & kAlphaMask) != 0)
+			((uint32 *)out)[j] = pix | kAlphaMask;
+	}
+}
+
+void blitRowAlpha(const byte *in, byte *out, uint32 width) {
+	uint32 j = 0;
+
+#if defined(ALPHA_BLIT_SSE2)
+	const __m128i alphaMaskV = _mm_set1_epi32(kAlphaMask);
+	const __m128i opaqueV = _mm_set1_epi32(0xFF);
+	const __m128i zero = _mm_setzero_si128();
+	for (; j + 4 <= width; j += 4) {
+		const __m128i pix = _mm_loadu_si128((const __m128i *)(in + j * 4));
+		const __m128i alpha = alphaSSE2(pix);
+		const __m128i clear = _mm_cmpeq_epi32(alpha, zero);
+		const __m128i opaque = _mm_cmpeq_epi32(alpha, opaqueV);
+		const int clearBits = _mm_movemask_epi8(clear);
+		if (clearBits == 0xFFFF)
+			continue;
+		if (_mm_movemask_epi8(opaque) == 0xFFFF) {
+			_mm_storeu_si128((__m128i *)(out + j * 4), pix);
+			continue;
+		}
+
+		const __m128i dst = _mm_loadu_si128((const __m128i *)(out + j * 4));
+
+		// Spread each alpha value over all four bytes of its pixel
+		__m128i a = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 8));
+		a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+		const __m128i invA = _mm_xor_si128(a, _mm_set1_epi8((char)0xFF));
+
+		// (in * a + out * (255 - a)) >> 8 per component
+		const __m128i lo = _mm_srli_epi16(_mm_add_epi16(
+			_mm_mullo_epi16(_mm_unpacklo_epi8(pix, zero), _mm_unpacklo_epi8(a, zero)),
+			_mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero), _mm_unpacklo_epi8(invA, zero))), 8);
+		const __m128i hi = _mm_srli_epi16(_mm_add_epi16(
+			_mm_mullo_epi16(_mm_unpackhi_epi8(pix, zero), _mm_unpackhi_epi8(a, zero)),
+			_mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), _mm_unpackhi_epi8(invA, zero))), 8);
+
+		__m128i res = _mm_or_si128(_mm_packus_epi16(lo, hi), alphaMaskV);
+		res = selectSSE2(opaque, pix, res);
+		res = selectSSE2(clear, dst, res);
+		_mm_storeu_si128((__m128i *)(out + j * 4), res);
+	}
+#elif defined(ALPHA_BLIT_NEON)
+	const uint32x4_t alphaMaskV = vdupq_n_u32(kAlphaMask);
+	for (; j + 4 <= width; j += 4) {
+		const uint32x4_t pix = vld1q_u32((const uint32 *)(in + j * 4));
+		const uint32x4_t dst = vld1q_u32((const uint32 *)(out + j * 4));
+		const uint32x4_t alpha = alphaNEON(pix);
+		const uint32x4_t clear = vceqq_u32(alpha, vdupq_n_u32(0));
+		const uint32x4_t opaque = vceqq_u32(alpha, vdupq_n_u32(0xFF));
+
+		// Spread each alpha value over all four bytes of its pixel
+		const uint8x16_t a = vreinterpretq_u8_u32(vmulq_u32(alpha, vdupq_n_u32(0x01010101)));
+		const uint8x16_t invA = vmvnq_u8(a);
+		const uint8x16_t src8 = vreinterpretq_u8_u32(pix);
+		const uint8x16_t dst8 = vreinterpretq_u8_u32(dst);
+
+		// (in * a + out * (255 - a)) >> 8 per component
+		const uint8x8_t lo = vshrn_n_u16(vmlal_u8(vmull_u8(vget_low_u8(src8), vget_low_u8(a)), vget_low_u8(dst8), vget_low_u8(invA)), 8);
+		const uint8x8_t hi = vshrn_n_u16(vmlal_u8(vmull_u8(vget_high_u8(src8), vget_high_u8(a)), vget_high_u8(dst8), vget_high_u8(invA)), 8);
+
+		uint32x4_t res = vorrq_u32(vreinterpretq_u32_u8(vcombine_u8(lo, hi)), alphaMaskV);
+		res = vbslq_u32(opaque, pix, res);
+		res = vbslq_u32(clear, dst, res);
+		vst1q_u32((uint32 *)(out + j * 4), res);
+	}
+#endif
+
+	for (; j < width; j++) {
+		const uint32 pix = ((const uint32 *)in)[j];
+		const uint32 a = pix & kAlphaMask;
+		if (a == 0)
+			continue;
+		if (a == 0xFF) {
+			((uint32 *)out)[j] = pix;
+			continue;
+		}
+
+		const uint32 dst = ((const uint32 *)out)[j];
+		((uint32 *)out)[j] = blendComponent(pix, dst, a, 8) |
+		                     blendComponent(pix, dst, a, 16) |
+		                     blendComponent(pix, dst, a, 24) | kAlphaMask;
+	}
+}
+
+} // End of namespace Graphics
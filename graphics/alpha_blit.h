@@ -0,0 +1,65 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef GRAPHICS_ALPHA_BLIT_H
+#define GRAPHICS_ALPHA_BLIT_H
+
+#include "common/scummsys.h"
+
+namespace Graphics {
+
+/**
+ * @name Row kernels for blitting 32bpp pixels with an alpha channel
+ *
+ * The pixels are native endian uint32 values with the alpha value in the
+ * lowest byte, which is the layout Wintermute's TransparentSurface uses.
+ * Where SSE2 or NEON is available four pixels are handled at a time. The
+ * output is the same as that of the scalar code, which handles whatever is
+ * left of the row.
+ *
+ * @param in		the source row
+ * @param out		the destination row
+ * @param width		the number of pixels in the row
+ * @{
+ */
+
+/** Copies a row, making every pixel fully opaque. */
+void blitRowOpaque(const byte *in, byte *out, uint32 width);
+
+/**
+ * Copies the pixels of a row which are not fully transparent, making them
+ * fully opaque.
+ */
+void blitRowBinary(const byte *in, byte *out, uint32 width);
+
+/**
+ * Blends a row onto the destination by the alpha value of each source
+ * pixel, computing (in * a + out * (255 - a)) >> 8 per color component.
+ * Fully transparent pixels are skipped and fully opaque ones copied.
+ */
+void blitRowAlpha(const byte *in, byte *out, uint32 width);
+
+/** @} */
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_ALPHA_BLIT_H
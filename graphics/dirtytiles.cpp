@@ -0,0 +1,157 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "graphics/dirtytiles.h"
+
+#include "common/util.h"
+
+namespace Graphics {
+
+DirtyTileMap::DirtyTileMap(int tileSize) : _tileSize(tileSize), _width(0), _height(0), _tilesW(0), _tilesH(0) {
+	resetBounds();
+}
+
+void DirtyTileMap::resize(int width, int height) {
+	_width = width;
+	_height = height;
+	_tilesW = (width + _tileSize - 1) / _tileSize;
+	_tilesH = (height + _tileSize - 1) / _tileSize;
+	_tiles.resize(_tilesW * _tilesH);
+	_merged.resize(_tilesW * _tilesH);
+	for (uint i = 0; i < _tiles.size(); ++i)
+		_tiles[i] = 0;
+	resetBounds();
+}
+
+void DirtyTileMap::clear() {
+	for (int ty = _top; ty <= _bottom; ++ty)
+		memset(&_tiles[ty * _tilesW + _left], 0, _right - _left + 1);
+	resetBounds();
+}
+
+void DirtyTileMap::resetBounds() {
+	_left = _tilesW;
+	_top = _tilesH;
+	_right = _bottom = -1;
+}
+
+bool DirtyTileMap::getTileRange(const Common::Rect &rect, int &x0, int &y0, int &x1, int &y1) const {
+	const int left = MAX<int>(rect.left, 0);
+	const int top = MAX<int>(rect.top, 0);
+	const int right = MIN<int>(rect.right, _width);
+	const int bottom = MIN<int>(rect.bottom, _height);
+	if (left >= right || top >= bottom)
+		return false;
+
+	x0 = left / _tileSize;
+	y0 = top / _tileSize;
+	x1 = (right - 1) / _tileSize;
+	y1 = (bottom - 1) / _tileSize;
+	return true;
+}
+
+void DirtyTileMap::addRect(const Common::Rect &rect) {
+	int x0, y0, x1, y1;
+	if (!getTileRange(rect, x0, y0, x1, y1))
+		return;
+
+	for (int ty = y0; ty <= y1; ++ty)
+		memset(&_tiles[ty * _tilesW + x0], 1, x1 - x0 + 1);
+
+	_left = MIN(_left, x0);
+	_top = MIN(_top, y0);
+	_right = MAX(_right, x1);
+	_bottom = MAX(_bottom, y1);
+}
+
+bool DirtyTileMap::isDirty(const Common::Rect &rect) const {
+	int x0, y0, x1, y1;
+	if (!getTileRange(rect, x0, y0, x1, y1))
+		return false;
+
+	x0 = MAX(x0, _left);
+	y0 = MAX(y0, _top);
+	x1 = MIN(x1, _right);
+	y1 = MIN(y1, _bottom);
+
+	for (int ty = y0; ty <= y1; ++ty) {
+		const byte *row = &_tiles[ty * _tilesW];
+		for (int tx = x0; tx <= x1; ++tx) {
+			if (row[tx])
+				return true;
+		}
+	}
+	return false;
+}
+
+bool DirtyTileMap::getRects(Common::Array<Common::Rect> &rects, uint maxRects, const Common::Rect &clip) {
+	rects.clear();
+
+	// Work on a copy of the dirty part, which is cleared tile by tile as
+	// the tiles are covered by a rectangle.
+	const int width = _right - _left + 1;
+	for (int ty = _top; ty <= _bottom; ++ty)
+		memcpy(&_merged[ty * _tilesW + _left], &_tiles[ty * _tilesW + _left], width);
+
+	// Greedily grow each run of dirty tiles first to the right, then
+	// downwards as long as the complete run below is dirty as well.
+	for (int ty = _top; ty <= _bottom; ++ty) {
+		byte *row = &_merged[ty * _tilesW];
+		for (int tx = _left; tx <= _right; ++tx) {
+			if (!row[tx])
+				continue;
+
+			int tx1 = tx;
+			while (tx1 < _right && row[tx1 + 1])
+				++tx1;
+
+			int ty1 = ty;
+			while (ty1 < _bottom) {
+				const byte *below = &_merged[(ty1 + 1) * _tilesW];
+				int i;
+				for (i = tx; i <= tx1 && below[i]; ++i)
+					;
+				if (i <= tx1)
+					break;
+				++ty1;
+			}
+
+			for (int i = ty; i <= ty1; ++i)
+				memset(&_merged[i * _tilesW + tx], 0, tx1 - tx + 1);
+
+			Common::Rect rect(tx * _tileSize, ty * _tileSize, (tx1 + 1) * _tileSize, (ty1 + 1) * _tileSize);
+			tx = tx1;
+
+			if (!rect.intersects(clip))
+				continue;
+			rect.clip(clip);
+
+			if (rects.size() == maxRects)
+				return false;
+			rects.push_back(rect);
+		}
+	}
+
+	return true;
+}
+
+} // End of namespace Graphics
@@ -0,0 +1,89 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef GRAPHICS_DIRTYTILES_H
+#define GRAPHICS_DIRTYTILES_H
+
+#include "common/array.h"
+#include "common/rect.h"
+
+namespace Graphics {
+
+/**
+ * Records the dirty parts of a screen with the granularity of a tile and
+ * merges them into a few large rectangles when they are redrawn.
+ *
+ * Unlike a plain list of rectangles it never runs out of space, and
+ * overlapping or adjacent updates are only drawn once.
+ */
+class DirtyTileMap {
+public:
+	/** @param tileSize width and height of a tile in pixels */
+	DirtyTileMap(int tileSize);
+
+	/** Make room for a screen of the given size and mark it clean. */
+	void resize(int width, int height);
+
+	int getWidth() const { return _width; }
+	int getHeight() const { return _height; }
+
+	/** Mark everything clean. */
+	void clear();
+
+	bool empty() const { return _top > _bottom; }
+
+	/** Mark a rectangle dirty. Parts outside the screen are ignored. */
+	void addRect(const Common::Rect &rect);
+
+	/** Check whether any tile overlapping the rectangle is dirty. */
+	bool isDirty(const Common::Rect &rect) const;
+
+	/**
+	 * Merge the dirty tiles into non-overlapping rectangles and clip them
+	 * to the given rectangle. The tiles stay dirty until clear() is called.
+	 *
+	 * @param rects    receives the rectangles
+	 * @param maxRects the maximum number of rectangles to return
+	 * @param clip     the area to clip the rectangles to
+	 * @return false if more than maxRects rectangles would be needed
+	 */
+	bool getRects(Common::Array<Common::Rect> &rects, uint maxRects, const Common::Rect &clip);
+
+private:
+	int _tileSize;
+	Common::Array<byte> _tiles;
+	Common::Array<byte> _merged;
+	int _width, _height;
+	int _tilesW, _tilesH;
+
+	// Bounding box of the dirty tiles, in tiles; empty if _top > _bottom
+	int _left, _top, _right, _bottom;
+
+	void resetBounds();
+
+	/** Get the range of tiles covered by rect; returns false if there are none. */
+	bool getTileRange(const Common::Rect &rect, int &x0, int &y0, int &x1, int &y1) const;
+};
+
+} // End of namespace Graphics
+
+#endif
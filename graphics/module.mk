@@ -1,8 +1,10 @@
 MODULE := graphics
 
 MODULE_OBJS := \
+	alpha_blit.o \
 	conversion.o \
 	cursorman.o \
+	dirtytiles.o \
 	font.o \
 	fontman.o \
 	fonts/bdf.o \
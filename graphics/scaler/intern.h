@@ -24,8 +24,16 @@
 #define GRAPHICS_SCALER_INTERN_H
 
 #include "common/scummsys.h"
+#include "common/util.h"
 #include "graphics/colormasks.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SCALER_HQ_SSE2
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SCALER_HQ_NEON
+#endif
 
 /**
  * Interpolate two 16 bit pixel *pairs* at once with equal weights 1.
@@ -218,4 +226,146 @@ static inline bool diffYUV(int yuv1, int yuv2) {
 */
 }
 
+#if defined(SCALER_HQ_SSE2)
+/**
+ * Vector version of diffYUV for a single component: compares the bits
+ * selected by mask in four pairs of YUV values against the threshold.
+ */
+static inline __m128i diffYUVComponentSSE2(__m128i yuv1, __m128i yuv2, __m128i mask, __m128i threshold) {
+	__m128i diff = _mm_sub_epi32(_mm_and_si128(yuv1, mask), _mm_and_si128(yuv2, mask));
+	const __m128i sign = _mm_srai_epi32(diff, 31);
+	diff = _mm_sub_epi32(_mm_xor_si128(diff, sign), sign);
+	return _mm_cmpgt_epi32(diff, threshold);
+}
+#endif
+
+enum {
+	/** Number of pixels computeHQPatterns works on at a time. */
+	kHQPatternChunkSize = 64
+};
+
+/**
+ * Compute the neighbourhood patterns used by the hq scaler family for a run
+ * of width 16 bit pixels starting at src. Bit n of patterns[x] is set when
+ * pixel x differs from its neighbour w(n+1) (w1..w9 in reading order,
+ * skipping the centre w5) both in value and according to diffYUV.
+ *
+ * The pixels left and right of the run, as well as the rows above and below
+ * it, are read too. Each pixel is looked up in yuvTable only once, and with
+ * SSE2 or NEON four patterns are computed at once.
+ */
+static inline void computeHQPatterns(const uint16 *src, uint32 nextlineSrc, int width, const uint32 *yuvTable, uint8 *patterns) {
+	enum {
+		kStride = kHQPatternChunkSize + 2 + 3
+	};
+
+	// Row and column of the neighbours w1..w4 and w6..w9 in the buffers
+	// below, where the centre pixel w5 of pattern x is at [1][x + 1].
+	static const int neighbours[8][2] = {
+		{ 0, 0 }, { 0, 1 }, { 0, 2 },
+		{ 1, 0 },           { 1, 2 },
+		{ 2, 0 }, { 2, 1 }, { 2, 2 }
+	};
+
+	int pix[3][kStride];
+	int yuv[3][kStride];
+	int pat[kHQPatternChunkSize + 3];
+
+	while (width > 0) {
+		const int n = MIN<int>(width, kHQPatternChunkSize);
+
+		for (int r = 0; r < 3; ++r) {
+			const uint16 *row = src - 1 + (r - 1) * (int)nextlineSrc;
+			int x;
+			for (x = 0; x < n + 2; ++x) {
+				pix[r][x] = row[x];
+				yuv[r][x] = yuvTable[row[x]];
+			}
+			// The vector loops may read past the end of a short run
+			for (; x < kStride; ++x)
+				pix[r][x] = yuv[r][x] = 0;
+		}
+
+#if defined(SCALER_HQ_SSE2)
+		const __m128i Ymask = _mm_set1_epi32(0x00FF0000);
+		const __m128i Umask = _mm_set1_epi32(0x0000FF00);
+		const __m128i Vmask = _mm_set1_epi32(0x000000FF);
+		const __m128i trY = _mm_set1_epi32(0x00300000);
+		const __m128i trU = _mm_set1_epi32(0x00000700);
+		const __m128i trV = _mm_set1_epi32(0x00000006);
+
+		for (int x = 0; x < n; x += 4) {
+			const __m128i w5 = _mm_loadu_si128((const __m128i *)&pix[1][x + 1]);
+			const __m128i yuv5 = _mm_loadu_si128((const __m128i *)&yuv[1][x + 1]);
+			__m128i pattern = _mm_setzero_si128();
+
+			for (int i = 0; i < 8; ++i) {
+				const int r = neighbours[i][0];
+				const int c = x + neighbours[i][1];
+				const __m128i w = _mm_loadu_si128((const __m128i *)&pix[r][c]);
+				const __m128i yuvN = _mm_loadu_si128((const __m128i *)&yuv[r][c]);
+
+				__m128i differ = _mm_or_si128(diffYUVComponentSSE2(yuv5, yuvN, Ymask, trY),
+				                 _mm_or_si128(diffYUVComponentSSE2(yuv5, yuvN, Umask, trU),
+				                              diffYUVComponentSSE2(yuv5, yuvN, Vmask, trV)));
+				differ = _mm_andnot_si128(_mm_cmpeq_epi32(w5, w), differ);
+				pattern = _mm_or_si128(pattern, _mm_and_si128(differ, _mm_set1_epi32(1 << i)));
+			}
+
+			_mm_storeu_si128((__m128i *)&pat[x], pattern);
+		}
+#elif defined(SCALER_HQ_NEON)
+		const int32x4_t Ymask = vdupq_n_s32(0x00FF0000);
+		const int32x4_t Umask = vdupq_n_s32(0x0000FF00);
+		const int32x4_t Vmask = vdupq_n_s32(0x000000FF);
+		const int32x4_t trY = vdupq_n_s32(0x00300000);
+		const int32x4_t trU = vdupq_n_s32(0x00000700);
+		const int32x4_t trV = vdupq_n_s32(0x00000006);
+
+		for (int x = 0; x < n; x += 4) {
+			const int32x4_t w5 = vld1q_s32(&pix[1][x + 1]);
+			const int32x4_t yuv5 = vld1q_s32(&yuv[1][x + 1]);
+			uint32x4_t pattern = vdupq_n_u32(0);
+
+			for (int i = 0; i < 8; ++i) {
+				const int r = neighbours[i][0];
+				const int c = x + neighbours[i][1];
+				const int32x4_t w = vld1q_s32(&pix[r][c]);
+				const int32x4_t yuvN = vld1q_s32(&yuv[r][c]);
+
+				uint32x4_t differ = vcgtq_s32(vabdq_s32(vandq_s32(yuv5, Ymask), vandq_s32(yuvN, Ymask)), trY);
+				differ = vorrq_u32(differ, vcgtq_s32(vabdq_s32(vandq_s32(yuv5, Umask), vandq_s32(yuvN, Umask)), trU));
+				differ = vorrq_u32(differ, vcgtq_s32(vabdq_s32(vandq_s32(yuv5, Vmask), vandq_s32(yuvN, Vmask)), trV));
+				differ = vbicq_u32(differ, vceqq_s32(w5, w));
+				pattern = vorrq_u32(pattern, vandq_u32(differ, vdupq_n_u32(1 << i)));
+			}
+
+			vst1q_s32(&pat[x], vreinterpretq_s32_u32(pattern));
+		}
+#else
+		for (int x = 0; x < n; ++x) {
+			const int w5 = pix[1][x + 1];
+			const int yuv5 = yuv[1][x + 1];
+			int pattern = 0;
+
+			for (int i = 0; i < 8; ++i) {
+				const int r = neighbours[i][0];
+				const int c = x + neighbours[i][1];
+				if (w5 != pix[r][c] && diffYUV(yuv5, yuv[r][c]))
+					pattern |= 1 << i;
+			}
+
+			pat[x] = pattern;
+		}
+#endif
+
+		for (int x = 0; x < n; ++x)
+			patterns[x] = pat[x];
+
+		src += n;
+		patterns += n;
+		width -= n;
+	}
+}
+
 #endif
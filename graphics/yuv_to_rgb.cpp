@@ -86,6 +86,11 @@
 #include "graphics/surface.h"
 #include "graphics/yuv_to_rgb.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define YUV_TO_RGB_SSE2
+#endif
+
 namespace Common {
 DECLARE_SINGLETON(Graphics::YUVToRGBManager);
 }
@@ -196,6 +201,147 @@ const YUVToRGBLookup *YUVToRGBManager::getLookup(Graphics::PixelFormat format, Y
 	L = &rgbToPix[(s)]; \
 	*((PixelInt *)(d)) = (L[cr_r] | L[crb_g] | L[cb_b])
 
+#ifdef YUV_TO_RGB_SSE2
+
+/**
+ * Converts eight pixels at a time using SSE2, for any 16 or 32 bit pixel
+ * format. The chroma factors and the ITU luminance scaling are applied in
+ * 16 bit fixed point, which yields exactly the truncated values stored in
+ * the lookup tables.
+ */
+class YUVToRGBSSE2 {
+public:
+	YUVToRGBSSE2(const Graphics::PixelFormat &format, YUVToRGBManager::LuminanceScale scale) {
+		// Same factors as in YUVToRGBManager's tables, minus their integer part
+		_crR = getFraction((0.419 / 0.299) - 1);
+		_crG = getFraction(0.299 / 0.419);
+		_cbG = getFraction(0.114 / 0.331);
+		_cbB = getFraction((0.587 / 0.331) - 1);
+
+		// (x * 255 / 219) == x + x * 36 / 219 for x in [0, 219]
+		_scaleITU = (scale == YUVToRGBManager::kScaleITU);
+		_ituFraction = _mm_set1_epi16((int16)((36 * 65536 + 218) / 219));
+
+		_hasLoss = (format.rLoss != 0 || format.gLoss != 0 || format.bLoss != 0);
+		_rLoss = _mm_cvtsi32_si128(format.rLoss);
+		_gLoss = _mm_cvtsi32_si128(format.gLoss);
+		_bLoss = _mm_cvtsi32_si128(format.bLoss);
+
+		// Pixels are assembled from their lower and upper 16 bits, shifting
+		// the components into place by multiplying them with a power of two.
+		// Components not belonging into the respective half are multiplied
+		// by zero.
+		_rShiftLow = getLowShift(format.rShift);
+		_gShiftLow = getLowShift(format.gShift);
+		_bShiftLow = getLowShift(format.bShift);
+		_rShiftHigh = getHighShift(format.rShift);
+		_gShiftHigh = getHighShift(format.gShift);
+		_bShiftHigh = getHighShift(format.bShift);
+
+		uint32 alpha = (0xFF >> format.aLoss) << format.aShift;
+		_alphaLow = _mm_set1_epi16((int16)(alpha & 0xFFFF));
+		_alphaHigh = _mm_set1_epi16((int16)(alpha >> 16));
+	}
+
+	/**
+	 * Get the red, green and blue offsets to add to the luminance for
+	 * eight u and v values, all given as 16 bit values.
+	 */
+	void getChroma(__m128i u, __m128i v, __m128i &r, __m128i &g, __m128i &b) const {
+		__m128i cb = _mm_sub_epi16(u, _mm_set1_epi16(128));
+		__m128i cr = _mm_sub_epi16(v, _mm_set1_epi16(128));
+
+		r = mulTruncate(cr, _crR, true);
+		g = _mm_sub_epi16(_mm_setzero_si128(), _mm_add_epi16(mulTruncate(cr, _crG, false), mulTruncate(cb, _cbG, false)));
+		b = mulTruncate(cb, _cbB, true);
+	}
+
+	/**
+	 * Convert eight pixels and store them, given the 16 bit luminance and
+	 * chroma offsets of each.
+	 */
+	template<typename PixelInt>
+	void putPixels(byte *dst, __m128i y, __m128i r, __m128i g, __m128i b) const {
+		r = getComponent(y, r);
+		g = getComponent(y, g);
+		b = getComponent(y, b);
+
+		if (_hasLoss) {
+			r = _mm_srl_epi16(r, _rLoss);
+			g = _mm_srl_epi16(g, _gLoss);
+			b = _mm_srl_epi16(b, _bLoss);
+		}
+
+		__m128i low = _alphaLow;
+		low = _mm_or_si128(low, _mm_mullo_epi16(r, _rShiftLow));
+		low = _mm_or_si128(low, _mm_mullo_epi16(g, _gShiftLow));
+		low = _mm_or_si128(low, _mm_mullo_epi16(b, _bShiftLow));
+
+		if (sizeof(PixelInt) == 2) {
+			_mm_storeu_si128((__m128i *)dst, low);
+		} else {
+			__m128i high = _alphaHigh;
+			high = _mm_or_si128(high, _mm_mullo_epi16(r, _rShiftHigh));
+			high = _mm_or_si128(high, _mm_mullo_epi16(g, _gShiftHigh));
+			high = _mm_or_si128(high, _mm_mullo_epi16(b, _bShiftHigh));
+
+			_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(low, high));
+			_mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi16(low, high));
+		}
+	}
+
+private:
+	__m128i _crR, _crG, _cbG, _cbB;
+	bool _scaleITU;
+	__m128i _ituFraction;
+	bool _hasLoss;
+	__m128i _rLoss, _gLoss, _bLoss;
+	__m128i _rShiftLow, _gShiftLow, _bShiftLow;
+	__m128i _rShiftHigh, _gShiftHigh, _bShiftHigh;
+	__m128i _alphaLow, _alphaHigh;
+
+	static __m128i getFraction(double factor) {
+		return _mm_set1_epi16((int16)(uint16)ceil(factor * 65536));
+	}
+
+	static __m128i getLowShift(int shift) {
+		return _mm_set1_epi16(shift < 16 ? (int16)(1 << shift) : 0);
+	}
+
+	static __m128i getHighShift(int shift) {
+		return _mm_set1_epi16(shift >= 16 ? (int16)(1 << (shift - 16)) : 0);
+	}
+
+	/**
+	 * Multiply by (one +) the given fraction, truncating towards zero like
+	 * the int16 casts used for the tables do.
+	 */
+	static __m128i mulTruncate(__m128i x, __m128i fraction, bool addOne) {
+		__m128i sign = _mm_srai_epi16(x, 15);
+		__m128i absX = _mm_sub_epi16(_mm_xor_si128(x, sign), sign);
+		__m128i product = _mm_mulhi_epu16(absX, fraction);
+
+		if (addOne)
+			product = _mm_add_epi16(product, absX);
+
+		return _mm_sub_epi16(_mm_xor_si128(product, sign), sign);
+	}
+
+	__m128i getComponent(__m128i y, __m128i offset) const {
+		__m128i x = _mm_add_epi16(y, offset);
+
+		if (_scaleITU) {
+			x = _mm_min_epi16(_mm_max_epi16(x, _mm_set1_epi16(16)), _mm_set1_epi16(235));
+			x = _mm_sub_epi16(x, _mm_set1_epi16(16));
+			return _mm_add_epi16(x, _mm_mulhi_epu16(x, _ituFraction));
+		}
+
+		return _mm_min_epi16(_mm_max_epi16(x, _mm_setzero_si128()), _mm_set1_epi16(255));
+	}
+};
+
+#endif
+
 template<typename PixelInt>
 void convertYUV444ToRGB(byte *dstPtr, int dstPitch, const YUVToRGBLookup *lookup, int16 *colorTab, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yHeight, int yPitch, int uvPitch) {
 	// Keep the tables in pointers here to avoid a dereference on each pixel
@@ -227,6 +373,33 @@ void convertYUV444ToRGB(byte *dstPtr, int dstPitch, const YUVToRGBLookup *lookup
 	}
 }
 
+#ifdef YUV_TO_RGB_SSE2
+
+template<typename PixelInt>
+void convertYUV444ToRGBSSE2(byte *dstPtr, int dstPitch, const YUVToRGBLookup *lookup, int16 *colorTab, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yHeight, int yPitch, int uvPitch) {
+	const YUVToRGBSSE2 converter(lookup->getFormat(), lookup->getScale());
+	const __m128i zero = _mm_setzero_si128();
+	int simdWidth = yWidth & ~7;
+
+	for (int h = 0; h < yHeight; h++) {
+		for (int w = 0; w < simdWidth; w += 8) {
+			__m128i y = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(ySrc + h * yPitch + w)), zero);
+			__m128i u = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(uSrc + h * uvPitch + w)), zero);
+			__m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(vSrc + h * uvPitch + w)), zero);
+			__m128i r, g, b;
+
+			converter.getChroma(u, v, r, g, b);
+			converter.putPixels<PixelInt>(dstPtr + h * dstPitch + w * sizeof(PixelInt), y, r, g, b);
+		}
+	}
+
+	// Convert the remaining columns using the tables
+	if (simdWidth < yWidth)
+		convertYUV444ToRGB<PixelInt>(dstPtr + simdWidth * sizeof(PixelInt), dstPitch, lookup, colorTab, ySrc + simdWidth, uSrc + simdWidth, vSrc + simdWidth, yWidth - simdWidth, yHeight, yPitch, uvPitch);
+}
+
+#endif
+
 void YUVToRGBManager::convert444(Graphics::Surface *dst, YUVToRGBManager::LuminanceScale scale, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yHeight, int yPitch, int uvPitch) {
 	// Sanity checks
 	assert(dst && dst->getPixels());
@@ -235,11 +408,18 @@ void YUVToRGBManager::convert444(Graphics::Surface *dst, YUVToRGBManager::Lumina
 
 	const YUVToRGBLookup *lookup = getLookup(dst->format, scale);
 
+#ifdef YUV_TO_RGB_SSE2
+	if (dst->format.bytesPerPixel == 2)
+		convertYUV444ToRGBSSE2<uint16>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+	else
+		convertYUV444ToRGBSSE2<uint32>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+#else
 	// Use a templated function to avoid an if check on every pixel
 	if (dst->format.bytesPerPixel == 2)
 		convertYUV444ToRGB<uint16>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
 	else
 		convertYUV444ToRGB<uint32>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+#endif
 }
 
 template<typename PixelInt>
@@ -274,13 +454,55 @@ void convertYUV420ToRGB(byte *dstPtr, int dstPitch, const YUVToRGBLookup *lookup
 			dstPtr += sizeof(PixelInt);
 		}
 
-		dstPtr += dstPitch;
+		dstPtr += (dstPitch << 1) - yWidth * sizeof(PixelInt);
 		ySrc += (yPitch << 1) - yWidth;
 		uSrc += uvPitch - halfWidth;
 		vSrc += uvPitch - halfWidth;
 	}
 }
 
+#ifdef YUV_TO_RGB_SSE2
+
+template<typename PixelInt>
+void convertYUV420ToRGBSSE2(byte *dstPtr, int dstPitch, const YUVToRGBLookup *lookup, int16 *colorTab, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yHeight, int yPitch, int uvPitch) {
+	const YUVToRGBSSE2 converter(lookup->getFormat(), lookup->getScale());
+	const __m128i zero = _mm_setzero_si128();
+	int halfHeight = yHeight >> 1;
+	int simdWidth = yWidth & ~15;
+
+	for (int h = 0; h < halfHeight; h++) {
+		const byte *yRow = ySrc + 2 * h * yPitch;
+		byte *dstRow = dstPtr + 2 * h * dstPitch;
+
+		for (int w = 0; w < simdWidth; w += 16) {
+			// Eight chroma values cover 16 pixels in each of the two rows
+			__m128i u = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(uSrc + h * uvPitch + w / 2)), zero);
+			__m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(vSrc + h * uvPitch + w / 2)), zero);
+			__m128i r, g, b;
+
+			converter.getChroma(u, v, r, g, b);
+
+			__m128i rLo = _mm_unpacklo_epi16(r, r), rHi = _mm_unpackhi_epi16(r, r);
+			__m128i gLo = _mm_unpacklo_epi16(g, g), gHi = _mm_unpackhi_epi16(g, g);
+			__m128i bLo = _mm_unpacklo_epi16(b, b), bHi = _mm_unpackhi_epi16(b, b);
+
+			for (int row = 0; row < 2; row++) {
+				__m128i y = _mm_loadu_si128((const __m128i *)(yRow + row * yPitch + w));
+				byte *dst = dstRow + row * dstPitch + w * sizeof(PixelInt);
+
+				converter.putPixels<PixelInt>(dst, _mm_unpacklo_epi8(y, zero), rLo, gLo, bLo);
+				converter.putPixels<PixelInt>(dst + 8 * sizeof(PixelInt), _mm_unpackhi_epi8(y, zero), rHi, gHi, bHi);
+			}
+		}
+	}
+
+	// Convert the remaining columns using the tables
+	if (simdWidth < yWidth)
+		convertYUV420ToRGB<PixelInt>(dstPtr + simdWidth * sizeof(PixelInt), dstPitch, lookup, colorTab, ySrc + simdWidth, uSrc + simdWidth / 2, vSrc + simdWidth / 2, yWidth - simdWidth, yHeight, yPitch, uvPitch);
+}
+
+#endif
+
 void YUVToRGBManager::convert420(Graphics::Surface *dst, YUVToRGBManager::LuminanceScale scale, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yHeight, int yPitch, int uvPitch) {
 	// Sanity checks
 	assert(dst && dst->getPixels());
@@ -291,11 +513,18 @@ void YUVToRGBManager::convert420(Graphics::Surface *dst, YUVToRGBManager::Lumina
 
 	const YUVToRGBLookup *lookup = getLookup(dst->format, scale);
 
+#ifdef YUV_TO_RGB_SSE2
+	if (dst->format.bytesPerPixel == 2)
+		convertYUV420ToRGBSSE2<uint16>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+	else
+		convertYUV420ToRGBSSE2<uint32>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+#else
 	// Use a templated function to avoid an if check on every pixel
 	if (dst->format.bytesPerPixel == 2)
 		convertYUV420ToRGB<uint16>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
 	else
 		convertYUV420ToRGB<uint32>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+#endif
 }
 
 #define READ_QUAD(ptr, prefix) \
@@ -366,6 +595,63 @@ void convertYUV410ToRGB(byte *dstPtr, int dstPitch, const YUVToRGBLookup *lookup
 #undef DO_INTERPOLATION
 #undef DO_YUV410_PIXEL
 
+#ifdef YUV_TO_RGB_SSE2
+
+/**
+ * Interpolate the chroma values for eight pixels, taken from two
+ * neighbouring 2x2 quads of the chroma plane.
+ */
+static inline __m128i interpolate410SSE2(const byte *src, int uvPitch, const __m128i *weights) {
+	__m128i a = _mm_setr_epi16(src[0], src[0], src[0], src[0], src[1], src[1], src[1], src[1]);
+	__m128i b = _mm_setr_epi16(src[1], src[1], src[1], src[1], src[2], src[2], src[2], src[2]);
+	__m128i c = _mm_setr_epi16(src[uvPitch], src[uvPitch], src[uvPitch], src[uvPitch], src[uvPitch + 1], src[uvPitch + 1], src[uvPitch + 1], src[uvPitch + 1]);
+	__m128i d = _mm_setr_epi16(src[uvPitch + 1], src[uvPitch + 1], src[uvPitch + 1], src[uvPitch + 1], src[uvPitch + 2], src[uvPitch + 2], src[uvPitch + 2], src[uvPitch + 2]);
+
+	__m128i sum = _mm_add_epi16(_mm_mullo_epi16(a, weights[0]), _mm_mullo_epi16(b, weights[1]));
+	sum = _mm_add_epi16(sum, _mm_mullo_epi16(c, weights[2]));
+	sum = _mm_add_epi16(sum, _mm_mullo_epi16(d, weights[3]));
+	return _mm_srli_epi16(sum, 4);
+}
+
+template<typename PixelInt>
+void convertYUV410ToRGBSSE2(byte *dstPtr, int dstPitch, const YUVToRGBLookup *lookup, int16 *colorTab, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yHeight, int yPitch, int uvPitch) {
+	const YUVToRGBSSE2 converter(lookup->getFormat(), lookup->getScale());
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i xDiff = _mm_setr_epi16(0, 1, 2, 3, 0, 1, 2, 3);
+	const __m128i four = _mm_set1_epi16(4);
+
+	// Handle two quads, and thus eight pixels, at a time
+	int simdWidth = yWidth & ~7;
+
+	for (int y = 0; y < yHeight; y++) {
+		// Same weights as DO_INTERPOLATION
+		__m128i yDiff = _mm_set1_epi16(y & 3);
+		__m128i weights[4];
+		weights[0] = _mm_mullo_epi16(_mm_sub_epi16(four, xDiff), _mm_sub_epi16(four, yDiff));
+		weights[1] = _mm_mullo_epi16(xDiff, _mm_sub_epi16(four, yDiff));
+		weights[2] = _mm_mullo_epi16(yDiff, _mm_sub_epi16(four, xDiff));
+		weights[3] = _mm_mullo_epi16(xDiff, yDiff);
+
+		int rowIndex = (y >> 2) * uvPitch;
+
+		for (int w = 0; w < simdWidth; w += 8) {
+			__m128i u = interpolate410SSE2(uSrc + rowIndex + w / 4, uvPitch, weights);
+			__m128i v = interpolate410SSE2(vSrc + rowIndex + w / 4, uvPitch, weights);
+			__m128i luma = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(ySrc + y * yPitch + w)), zero);
+			__m128i r, g, b;
+
+			converter.getChroma(u, v, r, g, b);
+			converter.putPixels<PixelInt>(dstPtr + y * dstPitch + w * sizeof(PixelInt), luma, r, g, b);
+		}
+	}
+
+	// Convert the remaining columns using the tables
+	if (simdWidth < yWidth)
+		convertYUV410ToRGB<PixelInt>(dstPtr + simdWidth * sizeof(PixelInt), dstPitch, lookup, colorTab, ySrc + simdWidth, uSrc + simdWidth / 4, vSrc + simdWidth / 4, yWidth - simdWidth, yHeight, yPitch, uvPitch);
+}
+
+#endif
+
 void YUVToRGBManager::convert410(Graphics::Surface *dst, YUVToRGBManager::LuminanceScale scale, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yHeight, int yPitch, int uvPitch) {
 	// Sanity checks
 	assert(dst && dst->getPixels());
@@ -376,11 +662,18 @@ void YUVToRGBManager::convert410(Graphics::Surface *dst, YUVToRGBManager::Lumina
 
 	const YUVToRGBLookup *lookup = getLookup(dst->format, scale);
 
+#ifdef YUV_TO_RGB_SSE2
+	if (dst->format.bytesPerPixel == 2)
+		convertYUV410ToRGBSSE2<uint16>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+	else
+		convertYUV410ToRGBSSE2<uint32>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+#else
 	// Use a templated function to avoid an if check on every pixel
 	if (dst->format.bytesPerPixel == 2)
 		convertYUV410ToRGB<uint16>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
 	else
 		convertYUV410ToRGB<uint32>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+#endif
 }
 
 } // End of namespace Graphics
@@ -924,6 +924,13 @@ Common::String addGameToConf(const GameDescriptor &result) {
 			ConfMan.set(iter->_key, iter->_value, domain);
 	}
 
+	// Remember which plugin file handles the game, so that launching it
+	// only needs to load that plugin. It is saved with the new domain.
+	const EnginePlugin *plugin = 0;
+	EngineMan.findGame(result.gameid(), &plugin);
+	if (plugin)
+		PluginManager::instance().updateConfigWithPluginFile(plugin, result.gameid());
+
 	// TODO: Setting the description field here has the drawback
 	// that the user does never notice when we upgrade our descriptions.
 	// It might be nice ot leave this field empty, and only set it to
@@ -20,6 +20,7 @@
  *
  */
 
+#include "engines/advancedDetector.h"
 #include "engines/metaengine.h"
 #include "common/algorithm.h"
 #include "common/config-manager.h"
@@ -63,6 +64,8 @@ MassAddDialog::MassAddDialog(const Common::FSNode &startDir)
 	_dirsScanned(0),
 	_oldGamesCount(0),
 	_dirTotal(0),
+	_scanStartTime(0),
+	_detectTime(0),
 	_okButton(0),
 	_dirProgressText(0),
 	_gameProgressText(0) {
@@ -71,6 +74,8 @@ MassAddDialog::MassAddDialog(const Common::FSNode &startDir)
 
 	// The dir we start our scan at
 	_scanStack.push(startDir);
+	_scanStartTime = g_system->getMillis();
+	AdvancedDetector::resetDetectionStats();
 
 	// Removed for now... Why would you put a title on mass add dialog called "Mass Add Dialog"?
 	// new StaticTextWidget(this, "massadddialog_caption", "Mass Add Dialog");
@@ -187,7 +192,9 @@ void MassAddDialog::handleTickle() {
 		}
 
 		// Run the detector on the dir
+		const uint32 detectStart = g_system->getMillis();
 		GameList candidates(EngineMan.detectGames(files));
+		_detectTime += g_system->getMillis() - detectStart;
 
 		// Just add all detected games / game variants. If we get more than one,
 		// that either means the directory contains multiple games, or the detector
@@ -259,6 +266,12 @@ void MassAddDialog::handleTickle() {
 		buf = _("Scan complete!");
 		_dirProgressText->setLabel(buf);
 
+		const AdvancedDetector::DetectionStats &stats = AdvancedDetector::getDetectionStats();
+		debug(1, "Mass add: scanned %d directories in %u ms, %u ms of which in detection",
+			_dirsScanned, g_system->getMillis() - _scanStartTime, _detectTime);
+		debug(1, "Mass add: hashed %u files in %u ms, reused %u cached MD5s",
+			stats.filesHashed, stats.hashTime, stats.cacheHits);
+
 		buf = Common::String::format(_("Discovered %d new games, ignored %d previously added games."), _games.size(), _oldGamesCount);
 		_gameProgressText->setLabel(buf);
 
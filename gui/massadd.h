@@ -63,6 +63,9 @@ private:
 	int _oldGamesCount;
 	int _dirTotal;
 
+	uint32 _scanStartTime;	///< When the scan was started, in milliseconds
+	uint32 _detectTime;	///< Time spent in game detection, in milliseconds
+
 	Widget *_okButton;
 	StaticTextWidget *_dirProgressText;
 	StaticTextWidget *_gameProgressText;
@@ -0,0 +1,170 @@
+#include <cxxtest/TestSuite.h>
+
+#include "audio/audiostream.h"
+#include "audio/mixer_intern.h"
+
+#include "test/null_system.h"
+
+#ifdef POSIX
+#include <pthread.h>
+#include <time.h>
+
+/**
+ * Just enough of an OSystem for running a mixer: recursive mutexes and a
+ * clock.
+ */
+class MixerTestSystem : public NullTestSystem {
+public:
+	void delayMillis(uint msecs) {
+		timespec ts;
+		ts.tv_sec = msecs / 1000;
+		ts.tv_nsec = (msecs % 1000) * 1000000;
+		nanosleep(&ts, 0);
+	}
+
+	uint32 getMillis(bool skipRecord = false) {
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+	}
+
+	MutexRef createMutex() {
+		pthread_mutexattr_t attr;
+		pthread_mutexattr_init(&attr);
+		pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+		pthread_mutex_t *mutex = new pthread_mutex_t;
+		pthread_mutex_init(mutex, &attr);
+		pthread_mutexattr_destroy(&attr);
+		return (MutexRef)mutex;
+	}
+
+	void lockMutex(MutexRef mutex) { pthread_mutex_lock((pthread_mutex_t *)mutex); }
+	void unlockMutex(MutexRef mutex) { pthread_mutex_unlock((pthread_mutex_t *)mutex); }
+
+	void deleteMutex(MutexRef mutex) {
+		pthread_mutex_destroy((pthread_mutex_t *)mutex);
+		delete (pthread_mutex_t *)mutex;
+	}
+};
+
+/**
+ * Silent stream which notes whether it is read after it has been stopped.
+ */
+class StopCheckingStream : public Audio::AudioStream {
+public:
+	volatile bool _stopped;
+	volatile bool _readAfterStop;
+	volatile int _samplesLeft;
+	volatile int _reads;
+
+	StopCheckingStream(int samples) : _stopped(false), _readAfterStop(false), _samplesLeft(samples), _reads(0) {}
+
+	int readBuffer(int16 *buffer, const int numSamples) {
+		if (_stopped)
+			_readAfterStop = true;
+
+		// Take a while, so that stop calls often come in while a read is
+		// in progress
+		const int samples = MIN<int>(numSamples, _samplesLeft);
+		memset(buffer, 0, samples * sizeof(int16));
+		for (volatile int i = 0; i < 5000; ++i)
+			;
+		_samplesLeft -= samples;
+		_reads++;
+
+		if (_stopped)
+			_readAfterStop = true;
+		return samples;
+	}
+
+	bool isStereo() const { return false; }
+	int getRate() const { return 22050; }
+	bool endOfData() const { return _samplesLeft == 0; }
+};
+#endif
+
+class MixerTestSuite : public CxxTest::TestSuite {
+#ifdef POSIX
+	Audio::MixerImpl *_mixer;
+	volatile bool _quitAudio;
+
+	static void *audioThread(void *data) {
+		MixerTestSuite *suite = (MixerTestSuite *)data;
+		byte samples[512 * 4];
+		while (!suite->_quitAudio)
+			suite->_mixer->mixCallback(samples, sizeof(samples));
+		return 0;
+	}
+#endif
+
+public:
+	// Engine side control calls racing with a busy audio thread. Streams
+	// which the mixer does not own are freed right after stopping them,
+	// so the mixer must be done with them once the stop call returns.
+	void test_concurrent_control_calls() {
+#ifdef POSIX
+		MixerTestSystem system;
+		OSystem *oldSystem = g_system;
+		g_system = &system;
+
+		_mixer = new Audio::MixerImpl(&system, 22050);
+		_mixer->setReady(true);
+		_quitAudio = false;
+
+		pthread_t thread;
+		TS_ASSERT_EQUALS(pthread_create(&thread, 0, audioThread, this), 0);
+
+		uint32 seed = 0x2468ACE;
+		bool readAfterStop = false;
+
+		for (int i = 0; i < 1000; ++i) {
+			seed = seed * 1103515245 + 12345;
+
+			// Some streams end on their own while they are being controlled
+			StopCheckingStream *stream = new StopCheckingStream(((seed >> 8) & 1) ? 0x7FFFFFFF : (seed >> 16) % 2000);
+			Audio::SoundHandle handle;
+			_mixer->playStream(Audio::Mixer::kSFXSoundType, &handle, stream, i & 3, 255, 0, DisposeAfterUse::NO, false, false);
+
+			for (int j = 0; j < (int)((seed >> 12) & 15); ++j) {
+				_mixer->setChannelVolume(handle, (byte)(j * 16));
+				_mixer->setChannelBalance(handle, (int8)(j * 8 - 64));
+				_mixer->pauseHandle(handle, (j & 1) != 0);
+				_mixer->getElapsedTime(handle);
+				_mixer->isSoundHandleActive(handle);
+			}
+
+			// Often wait for the audio thread to be busy with the stream
+			_mixer->pauseHandle(handle, false);
+			const uint32 start = system.getMillis();
+			while ((seed & 0x10) && !stream->_reads && _mixer->isSoundHandleActive(handle) && system.getMillis() - start < 100)
+				;
+
+			switch ((seed >> 20) & 3) {
+			case 0:
+				_mixer->stopAll();
+				break;
+			case 1:
+				_mixer->stopID(i & 3);
+				break;
+			default:
+				_mixer->stopHandle(handle);
+				break;
+			}
+
+			TS_ASSERT(!_mixer->isSoundHandleActive(handle));
+			stream->_stopped = true;
+
+			readAfterStop |= stream->_readAfterStop;
+			delete stream;
+		}
+
+		_quitAudio = true;
+		pthread_join(thread, 0);
+		delete _mixer;
+
+		TS_ASSERT(!readAfterStop);
+
+		g_system = oldSystem;
+#endif
+	}
+};
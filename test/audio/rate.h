@@ -0,0 +1,177 @@
+#include <cxxtest/TestSuite.h>
+
+#include "audio/audiostream.h"
+#include "audio/mixer.h"
+#include "audio/rate.h"
+
+#include "audio/decoders/raw.h"
+
+#include "helper.h"
+
+class RateConverterTestSuite : public CxxTest::TestSuite
+{
+private:
+	// Fill the output buffer with values which make the mixing saturate
+	// for some samples
+	static void fillOutput(int16 *buffer, int samples) {
+		for (int i = 0; i < samples; ++i)
+			buffer[i] = (int16)((i * 7919) % 65536 - 32768);
+	}
+
+	// The behaviour of the original per sample mixing code
+	static void referenceMix(int16 *out, int16 left, int16 right, Audio::st_volume_t volL, Audio::st_volume_t volR, bool reverseStereo) {
+		Audio::clampedAdd(out[reverseStereo ? 1 : 0], (left * (int)volL) / Audio::Mixer::kMaxMixerVolume);
+		Audio::clampedAdd(out[reverseStereo ? 0 : 1], (right * (int)volR) / Audio::Mixer::kMaxMixerVolume);
+	}
+
+	void copyTestTemplate(const bool isStereo, const bool reverseStereo, const int pairs, const Audio::st_volume_t volL, const Audio::st_volume_t volR) {
+		const int sampleRate = 11025;
+		int16 *sine;
+		Audio::SeekableAudioStream *s = createSineStream<int16>(sampleRate, 1, &sine, false, isStereo);
+
+		int16 *expected = new int16[pairs * 2];
+		int16 *output = new int16[pairs * 2];
+		fillOutput(expected, pairs * 2);
+		fillOutput(output, pairs * 2);
+
+		for (int i = 0; i < pairs; ++i) {
+			const int16 left = isStereo ? sine[i * 2] : sine[i];
+			const int16 right = isStereo ? sine[i * 2 + 1] : sine[i];
+			referenceMix(expected + i * 2, left, right, volL, volR, reverseStereo);
+		}
+
+		Audio::RateConverter *converter = Audio::makeRateConverter(sampleRate, sampleRate, isStereo, reverseStereo);
+		TS_ASSERT_EQUALS(converter->flow(*s, output, pairs, volL, volR), pairs);
+		TS_ASSERT_EQUALS(memcmp(expected, output, sizeof(int16) * pairs * 2), 0);
+
+		delete converter;
+		delete[] output;
+		delete[] expected;
+		delete[] sine;
+		delete s;
+	}
+
+public:
+	void test_copy_mono() {
+		copyTestTemplate(false, false, 1000, 256, 256);
+		copyTestTemplate(false, false, 1023, 37, 255);
+	}
+
+	void test_copy_stereo() {
+		copyTestTemplate(true, false, 1000, 256, 100);
+		copyTestTemplate(true, false, 999, 3, 0);
+	}
+
+	void test_copy_reverse_stereo() {
+		copyTestTemplate(true, true, 1000, 256, 100);
+		copyTestTemplate(true, true, 1001, 11, 200);
+	}
+
+	void test_simple_downsample() {
+		// Halving the rate picks every second input sample, starting with
+		// the second one
+		const int pairs = 777;
+		const Audio::st_volume_t volL = 200, volR = 60;
+		int16 *sine;
+		Audio::SeekableAudioStream *s = createSineStream<int16>(22050, 1, &sine, true, true);
+
+		int16 *expected = new int16[pairs * 2];
+		int16 *output = new int16[pairs * 2];
+		fillOutput(expected, pairs * 2);
+		fillOutput(output, pairs * 2);
+
+		for (int i = 0; i < pairs; ++i)
+			referenceMix(expected + i * 2, sine[(i * 2 + 1) * 2], sine[(i * 2 + 1) * 2 + 1], volL, volR, false);
+
+		Audio::RateConverter *converter = Audio::makeRateConverter(22050, 11025, true, false);
+		TS_ASSERT_EQUALS(converter->flow(*s, output, pairs, volL, volR), pairs);
+		TS_ASSERT_EQUALS(memcmp(expected, output, sizeof(int16) * pairs * 2), 0);
+
+		delete converter;
+		delete[] output;
+		delete[] expected;
+		delete[] sine;
+		delete s;
+	}
+
+	void test_end_of_stream() {
+		// A stream running dry reports how many pairs it really produced,
+		// here one second's worth plus the interpolation start up
+		Audio::SeekableAudioStream *s = createSineStream<int16>(8000, 1, 0, true, false);
+		int16 *output = new int16[20000 * 2];
+		memset(output, 0, sizeof(int16) * 20000 * 2);
+
+		Audio::RateConverter *converter = Audio::makeRateConverter(8000, 11025, false, false);
+		const int produced = converter->flow(*s, output, 20000, 256, 256);
+		TS_ASSERT_EQUALS(produced, 11026);
+
+		delete converter;
+		delete[] output;
+		delete s;
+	}
+
+	// Mono 16 bit stream of a sine wave with the given frequency and
+	// amplitude, or of a constant if the frequency is 0
+	static Audio::AudioStream *createToneStream(const int sampleRate, const int samples, const double frequency, const int amplitude) {
+		int16 *data = (int16 *)malloc(samples * sizeof(int16));
+		for (int i = 0; i < samples; ++i) {
+			if (frequency == 0)
+				data[i] = amplitude;
+			else
+				data[i] = (int16)(sin(2 * M_PI * frequency * i / sampleRate) * amplitude);
+		}
+
+#ifdef SCUMM_LITTLE_ENDIAN
+		const byte flags = Audio::FLAG_16BITS | Audio::FLAG_LITTLE_ENDIAN;
+#else
+		const byte flags = Audio::FLAG_16BITS;
+#endif
+		return Audio::makeRawStream((const byte *)data, samples * sizeof(int16), sampleRate, flags);
+	}
+
+	void test_sinc_constant() {
+		// A constant signal has to stay constant, whatever the phase
+		const int pairs = 4000;
+		Audio::AudioStream *s = createToneStream(11025, 2000, 0, 10000);
+
+		int16 *output = new int16[pairs * 2];
+		memset(output, 0, sizeof(int16) * pairs * 2);
+
+		Audio::RateConverter *converter = Audio::makeRateConverter(11025, 48000, false, false, Audio::kRateConverterSinc);
+		TS_ASSERT_EQUALS(converter->flow(*s, output, pairs, 256, 256), pairs);
+
+		// Skip the filter's start up
+		for (int i = 200; i < pairs * 2; ++i) {
+			TS_ASSERT_LESS_THAN_EQUALS(output[i], 10002);
+			TS_ASSERT_LESS_THAN_EQUALS(9998, output[i]);
+		}
+
+		delete converter;
+		delete[] output;
+		delete s;
+	}
+
+	void test_sinc_anti_aliasing() {
+		// A tone above the output Nyquist frequency would alias back at
+		// full strength with plain decimation. The filter has to remove it.
+		const int pairs = 4000;
+		const int amplitude = 16000;
+		Audio::AudioStream *s = createToneStream(44100, 10000, 18000, amplitude);
+
+		int16 *output = new int16[pairs * 2];
+		memset(output, 0, sizeof(int16) * pairs * 2);
+
+		Audio::RateConverter *converter = Audio::makeRateConverter(44100, 22050, false, false, Audio::kRateConverterSinc);
+		TS_ASSERT_EQUALS(converter->flow(*s, output, pairs, 256, 256), pairs);
+
+		double energy = 0;
+		for (int i = 200; i < pairs; ++i)
+			energy += (double)output[i * 2] * output[i * 2];
+		const double rms = sqrt(energy / (pairs - 200));
+		TS_ASSERT_LESS_THAN(rms, amplitude * 0.05);
+
+		delete converter;
+		delete[] output;
+		delete s;
+	}
+};
@@ -149,4 +149,54 @@ class BitStreamTestSuite : public CxxTest::TestSuite
 		TS_ASSERT_EQUALS(bs.peekBits(5), 12u);
 		TS_ASSERT(!bs.eos());
 	}
+
+	void test_skip_values() {
+		byte contents[] = { 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC };
+
+		Common::MemoryReadStream ms(contents, sizeof(contents));
+
+		Common::BitStream16BEMSB bs(ms);
+		bs.skip(4);
+		TS_ASSERT_EQUALS(bs.pos(), 4u);
+		bs.skip(28);
+		TS_ASSERT_EQUALS(bs.pos(), 32u);
+		TS_ASSERT_EQUALS(bs.getBits(4), 0x9u);
+		bs.rewind();
+		bs.skip(20);
+		TS_ASSERT_EQUALS(bs.pos(), 20u);
+		TS_ASSERT_EQUALS(bs.getBits(8), 0x67u);
+		bs.skip(20);
+		TS_ASSERT(bs.eos());
+	}
+
+	void test_peek_bits_padded() {
+		byte contents[] = { 'a', 'b' };
+		uint8 available;
+
+		Common::MemoryReadStream ms(contents, sizeof(contents));
+
+		Common::BitStream8MSB bs(ms);
+		TS_ASSERT_EQUALS(bs.peekBitsPadded(3, available), 3u);
+		TS_ASSERT_EQUALS(available, 3u);
+		bs.skip(11);
+		TS_ASSERT_EQUALS(bs.peekBitsPadded(8, available), 16u);
+		TS_ASSERT_EQUALS(available, 5u);
+		TS_ASSERT_EQUALS(bs.pos(), 11u);
+		bs.skip(5);
+		TS_ASSERT_EQUALS(bs.peekBitsPadded(8, available), 0u);
+		TS_ASSERT_EQUALS(available, 0u);
+	}
+
+	void test_peek_bits_padded_lsb() {
+		byte contents[] = { 'a', 'b' };
+		uint8 available;
+
+		Common::MemoryReadStream ms(contents, sizeof(contents));
+
+		Common::BitStream8LSB bs(ms);
+		bs.skip(11);
+		TS_ASSERT_EQUALS(bs.peekBitsPadded(8, available), 12u);
+		TS_ASSERT_EQUALS(available, 5u);
+		TS_ASSERT_EQUALS(bs.pos(), 11u);
+	}
 };
@@ -141,4 +141,91 @@ class HuffmanTestSuite : public CxxTest::TestSuite {
 		TS_ASSERT_EQUALS(h.getSymbol(bs), expected[5]);
 		TS_ASSERT_EQUALS(h.getSymbol(bs), expected[6]);
 	}
+
+	void test_get_lsb() {
+
+		/*
+		 * The encoding of test_get_with_full_symbols, read from an
+		 * LSB to MSB bit stream. The codes are stored with their
+		 * first bit in bit 0.
+		 *
+		 * 0xA=010
+		 * 0xB=011
+		 * 0xC=11
+		 * 0xD=00
+		 * 0xE=10
+		 */
+
+		uint32 codeCount = 5;
+		const uint8 lengths[] = {3,3,2,2,2};
+		const uint32 codes[]  = {0x2, 0x6, 0x3, 0x0, 0x1};
+		const uint32 symbols[]  = {0xA, 0xB, 0xC, 0xD, 0xE};
+
+		Common::Huffman h(0, codeCount, codes, lengths, symbols);
+
+		/*
+		 * 010 011 11 00 10 00 00 = A B C D E D D
+		 * = 01001111 00100000, with the first bit of each byte in bit 0
+		 * = 0xF2 0x04
+		 */
+		byte input[] = {0xF2, 0x04};
+		uint32 expected[] = {0xA, 0xB, 0xC, 0xD, 0xE, 0xD, 0xD};
+
+		Common::MemoryReadStream ms(input, sizeof(input));
+		Common::BitStream8LSB bs(ms);
+
+		for (int i = 0; i < ARRAYSIZE(expected); i++)
+			TS_ASSERT_EQUALS(h.getSymbol(bs), expected[i]);
+	}
+
+	void test_get_long_codes() {
+
+		/*
+		 * Codes that are too long for a single table lookup:
+		 * symbol i < 12 has the code of i ones followed by a zero,
+		 * symbol 12 is twelve ones.
+		 */
+
+		uint32 codes[13], codesLSB[13];
+		uint8 lengths[13];
+
+		for (int i = 0; i < 13; i++) {
+			lengths[i] = (i < 12) ? i + 1 : 12;
+			codes[i] = (i < 12) ? ((1 << (i + 1)) - 2) : 0xFFF;
+			codesLSB[i] = (i < 12) ? ((1 << i) - 1) : 0xFFF;
+		}
+
+		Common::Huffman h(0, 13, codes, lengths);
+		Common::Huffman hLSB(0, 13, codesLSB, lengths);
+
+		const uint32 expected[] = {12, 0, 11, 3, 10, 12, 9, 1};
+
+		// Write the codes, first bit first
+		byte inputMSB[16], inputLSB[16];
+		memset(inputMSB, 0, sizeof(inputMSB));
+		memset(inputLSB, 0, sizeof(inputLSB));
+
+		uint32 pos = 0;
+		for (int i = 0; i < ARRAYSIZE(expected); i++) {
+			for (int j = 0; j < lengths[expected[i]]; j++, pos++) {
+				if ((codes[expected[i]] >> (lengths[expected[i]] - 1 - j)) & 1) {
+					inputMSB[pos / 8] |= 0x80 >> (pos % 8);
+					inputLSB[pos / 8] |= 1 << (pos % 8);
+				}
+			}
+		}
+
+		Common::MemoryReadStream msMSB(inputMSB, sizeof(inputMSB));
+		Common::BitStream8MSB bsMSB(msMSB);
+		Common::MemoryReadStream msLSB(inputLSB, sizeof(inputLSB));
+		Common::BitStream8LSB bsLSB(msLSB);
+
+		for (int i = 0; i < ARRAYSIZE(expected); i++) {
+			TS_ASSERT_EQUALS(h.getSymbol(bsMSB), expected[i]);
+			TS_ASSERT_EQUALS(hLSB.getSymbol(bsLSB), expected[i]);
+		}
+
+		TS_ASSERT_EQUALS(bsMSB.pos(), pos);
+		TS_ASSERT_EQUALS(bsLSB.pos(), pos);
+	}
 };
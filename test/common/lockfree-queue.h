@@ -0,0 +1,102 @@
+#include <cxxtest/TestSuite.h>
+
+#include "common/lockfree-queue.h"
+
+class LockFreeQueueTestSuite : public CxxTest::TestSuite {
+public:
+	void test_empty_full() {
+		Common::LockFreeQueue<int, 4> queue;
+		TS_ASSERT(queue.empty());
+		TS_ASSERT(!queue.full());
+		TS_ASSERT_EQUALS(queue.capacity(), 4u);
+
+		TS_ASSERT(queue.push(1));
+		TS_ASSERT(queue.push(2));
+		TS_ASSERT(queue.push(3));
+		TS_ASSERT(queue.push(4));
+		TS_ASSERT(queue.full());
+		TS_ASSERT_EQUALS(queue.size(), 4u);
+
+		// A full queue refuses new elements and keeps the old ones
+		TS_ASSERT(!queue.push(5));
+		TS_ASSERT_EQUALS(queue.size(), 4u);
+	}
+
+	void test_fifo_order() {
+		Common::LockFreeQueue<int, 8> queue;
+		int value = 0;
+
+		TS_ASSERT(!queue.pop(value));
+		TS_ASSERT_EQUALS(value, 0);
+
+		queue.push(42);
+		queue.push(-23);
+		queue.push(7);
+
+		TS_ASSERT(queue.pop(value));
+		TS_ASSERT_EQUALS(value, 42);
+		TS_ASSERT(queue.pop(value));
+		TS_ASSERT_EQUALS(value, -23);
+		TS_ASSERT(queue.pop(value));
+		TS_ASSERT_EQUALS(value, 7);
+		TS_ASSERT(queue.empty());
+	}
+
+	struct Command {
+		int slot;
+		int value;
+	};
+
+	// Replays the usage pattern of the mixer: bursts of control calls from
+	// the engine side, drained in chunks of varying size by the consumer.
+	// After each drain the consumer's state must match what the producer
+	// intended up to that point.
+	void test_interleaved_producer_consumer() {
+		enum { kSlots = 16 };
+		Common::LockFreeQueue<Command, 32> queue;
+		int intended[kSlots];
+		int applied[kSlots];
+		for (int i = 0; i < kSlots; ++i)
+			intended[i] = applied[i] = 0;
+
+		uint32 seed = 0x1234567;
+		int posted = 0, executed = 0;
+
+		for (int round = 0; round < 20000; ++round) {
+			seed = seed * 1103515245 + 12345;
+			const int burst = (seed >> 16) % 40;
+
+			for (int i = 0; i < burst; ++i) {
+				Command cmd;
+				cmd.slot = (posted * 7) % kSlots;
+				cmd.value = posted;
+				if (!queue.push(cmd))
+					break;
+				intended[cmd.slot] = cmd.value;
+				++posted;
+			}
+
+			// The consumer sometimes only gets part of the backlog done
+			seed = seed * 1103515245 + 12345;
+			const bool partial = ((seed >> 16) & 3) == 0;
+			int budget = partial ? (int)queue.size() / 2 : (int)queue.size();
+
+			Command cmd;
+			while (budget-- > 0 && queue.pop(cmd)) {
+				TS_ASSERT_EQUALS(cmd.value, executed);
+				applied[cmd.slot] = cmd.value;
+				++executed;
+			}
+
+			if (queue.empty()) {
+				for (int i = 0; i < kSlots; ++i)
+					TS_ASSERT_EQUALS(applied[i], intended[i]);
+			}
+		}
+
+		Command cmd;
+		while (queue.pop(cmd))
+			++executed;
+		TS_ASSERT_EQUALS(executed, posted);
+	}
+};
@@ -27,7 +27,43 @@ static const char *md5_test_digest[] = {
 	"57edf4a22be3c955ac49da2e2107b67a"
 };
 
+/*
+ * Digests of the first n bytes of the pattern generated by makePattern(),
+ * with lengths around the MD5 block size and the read size of
+ * computeStreamMD5()
+ */
+static const struct {
+	uint32 length;
+	const char *digest;
+} md5_pattern_test[] = {
+	{     55, "8d24280288a696559fd8d5aa1b6d8c6e" },
+	{     56, "ef2c72b7254c92459e498eddd4ace573" },
+	{     63, "c4c8c6d513f4e1604eb18508a1769364" },
+	{     64, "a2fcb39a253b9b785b1f97518fa37683" },
+	{     65, "e49fe82d0bb12967a196c85de313e446" },
+	{    127, "c774d99f2281f28edc4257944c8871d1" },
+	{    128, "fe942895e9aae953f3e246e5fd00739d" },
+	{   1000, "bd8c10439abeb42fb5c19745991e360e" },
+	{   8191, "12d9e481a52dc21d09f9c6f1a1fd7d88" },
+	{   8192, "4e9eeff66b7aa877bffa8d48cda2ad56" },
+	{   8193, "4646fe13ba20c1b3c08e11a67c7c227c" },
+	{  20000, "a6a4186232db0d067e5b36ea78862c9d" },
+	{  65535, "e89ffbd49ae0f47fb5946d71e97626f6" },
+	{  65536, "901a699cb338da7d4eb4a204e265dcf4" },
+	{  65537, "d2c78c280530d0f49800b4b7218ea5b5" },
+	{ 132306, "0ab34ee1a0e5f4e5e966ec6860885c41" }
+};
+
 class MD5TestSuite : public CxxTest::TestSuite {
+	enum {
+		kPatternSize = 140000
+	};
+
+	static void makePattern(byte *buffer) {
+		for (uint32 i = 0; i < kPatternSize; i++)
+			buffer[i] = (byte)(i * 7 + (i >> 8));
+	}
+
 	public:
 	void test_computeStreamMD5() {
 		int i, j;
@@ -47,4 +83,35 @@ class MD5TestSuite : public CxxTest::TestSuite {
 		}
 	}
 
+	void test_computeStreamMD5_million() {
+		const uint32 size = 1000000;
+		byte *buffer = new byte[size];
+		memset(buffer, 'a', size);
+
+		Common::MemoryReadStream stream(buffer, size);
+		TS_ASSERT_EQUALS(Common::computeStreamMD5AsString(stream), "7707d6ae4e027c70eea2a935c2296f21");
+
+		delete[] buffer;
+	}
+
+	void test_computeStreamMD5_lengths() {
+		byte *buffer = new byte[kPatternSize];
+		makePattern(buffer);
+
+		for (uint i = 0; i < ARRAYSIZE(md5_pattern_test); i++) {
+			const uint32 length = md5_pattern_test[i].length;
+
+			// The whole stream
+			Common::MemoryReadStream stream(buffer, length);
+			TS_ASSERT_EQUALS(Common::computeStreamMD5AsString(stream), md5_pattern_test[i].digest);
+
+			// Only the beginning of a longer stream
+			Common::MemoryReadStream longStream(buffer, kPatternSize);
+			TS_ASSERT_EQUALS(Common::computeStreamMD5AsString(longStream, length), md5_pattern_test[i].digest);
+			TS_ASSERT_EQUALS(longStream.pos(), (int32)length);
+		}
+
+		delete[] buffer;
+	}
+
 };
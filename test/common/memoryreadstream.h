@@ -100,4 +100,19 @@ class MemoryReadStreamTestSuite : public CxxTest::TestSuite {
 		ms.seek(0, SEEK_SET);
 		TS_ASSERT(!ms.eos());
 	}
+
+	void test_direct_pointer() {
+		byte contents[] = { 1, 2, 3, 4, 5, 6, 7 };
+		Common::MemoryReadStream ms(contents, sizeof(contents));
+
+		ms.seek(3, SEEK_SET);
+		TS_ASSERT_EQUALS(ms.getDirectPointer(0, 7), contents);
+		TS_ASSERT_EQUALS(ms.getDirectPointer(2, 5), contents + 2);
+		TS_ASSERT_EQUALS(ms.getDirectPointer(7, 0), contents + 7);
+		TS_ASSERT(!ms.getDirectPointer(2, 6));
+		TS_ASSERT(!ms.getDirectPointer(8, 0));
+
+		// The position is not changed
+		TS_ASSERT_EQUALS(ms.pos(), 3);
+	}
 };
@@ -0,0 +1,179 @@
+#include <cxxtest/TestSuite.h>
+
+#include "common/archive.h"
+#include "common/memstream.h"
+#include "common/str-array.h"
+
+/**
+ * Archive with a fixed list of empty files, which counts how often it is
+ * asked for files.
+ */
+class CountingArchive : public Common::Archive {
+	Common::StringArray _files;
+
+public:
+	mutable int _lookups;
+
+	CountingArchive(const char *file1, const char *file2 = 0) : _lookups(0) {
+		_files.push_back(file1);
+		if (file2)
+			_files.push_back(file2);
+	}
+
+	bool hasFile(const Common::String &name) const {
+		_lookups++;
+		for (uint i = 0; i < _files.size(); i++)
+			if (_files[i].equalsIgnoreCase(name))
+				return true;
+		return false;
+	}
+
+	int listMembers(Common::ArchiveMemberList &list) const {
+		for (uint i = 0; i < _files.size(); i++)
+			list.push_back(Common::ArchiveMemberPtr(new Common::GenericArchiveMember(_files[i], this)));
+		return _files.size();
+	}
+
+	const Common::ArchiveMemberPtr getMember(const Common::String &name) const {
+		return Common::ArchiveMemberPtr(new Common::GenericArchiveMember(name, this));
+	}
+
+	Common::SeekableReadStream *createReadStreamForMember(const Common::String &name) const {
+		if (!hasFile(name))
+			return 0;
+		return new Common::MemoryReadStream((const byte *)"", 0);
+	}
+};
+
+/**
+ * Archive whose files are always in memory.
+ */
+class HotArchive : public CountingArchive {
+public:
+	HotArchive(const char *file1, const char *file2) : CountingArchive(file1, file2) {}
+
+	bool prefetchMember(const Common::String &name) const {
+		return hasFile(name);
+	}
+};
+
+/**
+ * Archive which lists its file but fails to open it.
+ */
+class BrokenArchive : public CountingArchive {
+public:
+	BrokenArchive(const char *file) : CountingArchive(file) {}
+
+	Common::SeekableReadStream *createReadStreamForMember(const Common::String &name) const {
+		return 0;
+	}
+};
+
+class SearchSetTestSuite : public CxxTest::TestSuite {
+public:
+	void test_priority() {
+		Common::SearchSet set;
+		CountingArchive *low = new CountingArchive("a.dat", "b.dat");
+		CountingArchive *high = new CountingArchive("A.DAT");
+
+		set.add("low", low, 0);
+		set.add("high", high, 1);
+
+		TS_ASSERT(set.hasFile("a.dat"));
+		TS_ASSERT(set.hasFile("b.dat"));
+		TS_ASSERT(!set.hasFile("c.dat"));
+
+		// The archive with the higher priority is asked first
+		TS_ASSERT_EQUALS(high->_lookups, 3);
+		TS_ASSERT_EQUALS(low->_lookups, 2);
+	}
+
+	void test_indexed() {
+		Common::SearchSet set;
+		CountingArchive *low = new CountingArchive("a.dat", "b.dat");
+		CountingArchive *high = new CountingArchive("b.dat");
+
+		set.setIndexed(true);
+		set.add("low", low, 0);
+		set.add("high", high, 1);
+
+		for (int i = 0; i < 3; i++) {
+			TS_ASSERT(set.hasFile("a.dat"));
+			TS_ASSERT(set.hasFile("A.dat"));
+			TS_ASSERT(!set.hasFile("c.dat"));
+		}
+
+		// Each name, found or not, has only been looked up once
+		TS_ASSERT_EQUALS(high->_lookups, 2);
+		TS_ASSERT_EQUALS(low->_lookups, 2);
+
+		// Opening a file only asks the archive which provides it
+		high->_lookups = low->_lookups = 0;
+		Common::SeekableReadStream *stream = set.createReadStreamForMember("b.dat");
+		TS_ASSERT(stream);
+		delete stream;
+		TS_ASSERT_EQUALS(high->_lookups, 2);
+		TS_ASSERT_EQUALS(low->_lookups, 0);
+
+		// Changing the priorities drops the index
+		set.setPriority("low", 2);
+		high->_lookups = low->_lookups = 0;
+		TS_ASSERT(set.hasFile("b.dat"));
+		TS_ASSERT_EQUALS(high->_lookups, 0);
+		TS_ASSERT_EQUALS(low->_lookups, 1);
+
+		// So do adding and removing archives
+		set.add("new", new CountingArchive("c.dat"));
+		TS_ASSERT(set.hasFile("c.dat"));
+		set.remove("new");
+		TS_ASSERT(!set.hasFile("c.dat"));
+	}
+
+	void test_indexed_fallback() {
+		Common::SearchSet set;
+		CountingArchive *low = new CountingArchive("a.dat");
+		BrokenArchive *high = new BrokenArchive("a.dat");
+
+		set.setIndexed(true);
+		set.add("low", low, 0);
+		set.add("high", high, 1);
+
+		// The member is indexed in the broken archive, but opening it falls
+		// back to the other archives
+		for (int i = 0; i < 2; i++) {
+			Common::SeekableReadStream *stream = set.createReadStreamForMember("a.dat");
+			TS_ASSERT(stream);
+			delete stream;
+		}
+
+		TS_ASSERT(!set.createReadStreamForMember("b.dat"));
+	}
+
+	void test_prefetch() {
+		Common::SearchSet set;
+		set.add("hot", new HotArchive("a.dat", "b.dat"));
+		set.add("cold", new CountingArchive("c.dat"));
+
+		// Archives do not prefetch unless they override prefetchMember()
+		TS_ASSERT(set.prefetchMember("a.dat"));
+		TS_ASSERT(!set.prefetchMember("c.dat"));
+
+		// Files which do not exist are not counted
+		TS_ASSERT(!set.prefetchMember("d.dat"));
+
+		uint32 hits, misses;
+		set.getPrefetchStats(hits, misses);
+		TS_ASSERT_EQUALS(hits, 1U);
+		TS_ASSERT_EQUALS(misses, 1U);
+
+		TS_ASSERT_EQUALS(set.prefetchMatchingMembers("*.dat"), 1);
+		set.getPrefetchStats(hits, misses);
+		TS_ASSERT_EQUALS(hits, 3U);
+		TS_ASSERT_EQUALS(misses, 2U);
+
+		set.resetPrefetchStats();
+		set.getPrefetchStats(hits, misses);
+		TS_ASSERT_EQUALS(hits, 0U);
+		TS_ASSERT_EQUALS(misses, 0U);
+	}
+};
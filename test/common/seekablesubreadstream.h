@@ -70,4 +70,18 @@ class SeekableSubReadStreamTestSuite : public CxxTest::TestSuite {
 		b = ssrs.readByte();
 		TS_ASSERT_EQUALS(b, 1);
 	}
+
+	void test_direct_pointer() {
+		byte contents[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+		Common::MemoryReadStream ms(contents, 10);
+
+		Common::SeekableSubReadStream ssrs(&ms, 1, 9);
+		TS_ASSERT_EQUALS(ssrs.getDirectPointer(0, 8), contents + 1);
+		TS_ASSERT_EQUALS(ssrs.getDirectPointer(3, 2), contents + 4);
+		TS_ASSERT(!ssrs.getDirectPointer(3, 6));
+		TS_ASSERT(!ssrs.getDirectPointer(9, 0));
+
+		// Memory is always resident
+		TS_ASSERT(ssrs.prefetch(2, 100));
+	}
 };
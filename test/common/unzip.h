@@ -0,0 +1,256 @@
+#include <cxxtest/TestSuite.h>
+
+#include "common/archive.h"
+#include "common/array.h"
+#include "common/memstream.h"
+#include "common/ptr.h"
+#include "common/unzip.h"
+#include "common/zlib.h"
+
+#include "test/null_system.h"
+
+class UnzipTestSuite : public CxxTest::TestSuite {
+#ifdef USE_ZLIB
+	enum {
+		kStoredSize = 100 * 1000,
+		// Larger than kMaxInflatedMemberSize of ZipArchive, and spanning
+		// several of the seek checkpoints of its member streams
+		kDeflatedSize = 2500 * 1000,
+		kCheckpointInterval = 1024 * 1024,
+
+		kMethodStored = 0,
+		kMethodDeflated = 8
+	};
+
+	struct Member {
+		Common::String name;
+		uint16 method;
+		uint32 crc;
+		uint32 compressedSize;
+		uint32 size;
+		uint32 offset;
+	};
+
+	NullTestSystem _system;
+	OSystem *_oldSystem;
+	byte *_data;
+
+	// Compressible, but not trivially so
+	void makeData() {
+		uint32 seed = 7;
+		for (uint32 i = 0; i < kDeflatedSize; i++) {
+			seed = seed * 1103515245 + 12345;
+			_data[i] = (byte)((seed >> 16) % 40 + (i >> 12));
+		}
+	}
+
+	/**
+	 * Deflate data. A gzip stream holds just what a zipfile needs: the
+	 * raw deflate data, framed by a 10 byte header and a trailer starting
+	 * with the checksum.
+	 * @return the deflate data, to be freed with delete[]
+	 */
+	static byte *deflateData(const byte *data, uint32 size, uint32 &compressedSize, uint32 &crc) {
+		// The compressing stream deletes the write stream, but not its data
+		Common::MemoryWriteStreamDynamic *gzip = new Common::MemoryWriteStreamDynamic(DisposeAfterUse::NO);
+		Common::WriteStream *stream = Common::wrapCompressedWriteStream(gzip);
+		stream->write(data, size);
+		stream->finalize();
+
+		const byte *gzipData = gzip->getData();
+		const uint32 gzipSize = gzip->size();
+		compressedSize = gzipSize - 18;
+		crc = READ_LE_UINT32(gzipData + gzipSize - 8);
+
+		byte *compressed = new byte[compressedSize];
+		memcpy(compressed, gzipData + 10, compressedSize);
+		free(gzip->getData());
+		delete stream;
+		return compressed;
+	}
+
+	static void writeHeader(Common::WriteStream &zip, const Member &member, bool central) {
+		zip.writeUint32LE(central ? 0x02014b50 : 0x04034b50);
+		if (central)
+			zip.writeUint16LE(20); // Version made by
+		zip.writeUint16LE(20); // Version needed to extract
+		zip.writeUint16LE(0); // Flags
+		zip.writeUint16LE(member.method);
+		zip.writeUint16LE(0); // Time
+		zip.writeUint16LE(0x21); // Date, 1980-01-01
+		zip.writeUint32LE(member.crc);
+		zip.writeUint32LE(member.compressedSize);
+		zip.writeUint32LE(member.size);
+		zip.writeUint16LE(member.name.size());
+		zip.writeUint16LE(0); // Extra field length
+		if (central) {
+			zip.writeUint16LE(0); // Comment length
+			zip.writeUint16LE(0); // Disk number
+			zip.writeUint16LE(0); // Internal attributes
+			zip.writeUint32LE(0); // External attributes
+			zip.writeUint32LE(member.offset);
+		}
+		zip.write(member.name.c_str(), member.name.size());
+	}
+
+	/**
+	 * Build a zipfile holding the first kStoredSize bytes of the data in
+	 * a stored member and all of it in a deflated one.
+	 * @param badCrc	store a wrong checksum for both members
+	 */
+	Common::Archive *createArchive(bool badCrc = false) {
+		Common::MemoryWriteStreamDynamic zip(DisposeAfterUse::NO);
+		Common::Array<Member> members;
+
+		for (int i = 0; i < 2; i++) {
+			const bool deflated = (i == 1);
+			Member member;
+			member.name = deflated ? "deflated.bin" : "stored.bin";
+			member.method = deflated ? kMethodDeflated : kMethodStored;
+			member.size = deflated ? kDeflatedSize : kStoredSize;
+			member.offset = zip.pos();
+
+			byte *compressed = deflateData(_data, member.size, member.compressedSize, member.crc);
+			if (badCrc)
+				member.crc ^= 1;
+			if (!deflated)
+				member.compressedSize = member.size;
+
+			writeHeader(zip, member, false);
+			zip.write(deflated ? compressed : _data, member.compressedSize);
+			delete[] compressed;
+
+			members.push_back(member);
+		}
+
+		const uint32 directoryStart = zip.pos();
+		for (uint i = 0; i < members.size(); i++)
+			writeHeader(zip, members[i], true);
+		const uint32 directorySize = zip.pos() - directoryStart;
+
+		zip.writeUint32LE(0x06054b50);
+		zip.writeUint16LE(0); // Disk number
+		zip.writeUint16LE(0); // Disk with the central directory
+		zip.writeUint16LE(members.size());
+		zip.writeUint16LE(members.size());
+		zip.writeUint32LE(directorySize);
+		zip.writeUint32LE(directoryStart);
+		zip.writeUint16LE(0); // Comment length
+
+		return Common::makeZipArchive(new Common::MemoryReadStream(zip.getData(), zip.size(), DisposeAfterUse::YES));
+	}
+
+	void checkRead(Common::SeekableReadStream *stream, uint32 pos, uint32 size) {
+		byte buffer[1000];
+		TS_ASSERT(stream->seek(pos));
+		TS_ASSERT_EQUALS(stream->pos(), (int32)pos);
+		TS_ASSERT_EQUALS(stream->read(buffer, size), size);
+		TS_ASSERT(memcmp(buffer, _data + pos, size) == 0);
+		TS_ASSERT(!stream->err());
+	}
+
+	// Read a member in chunks which do not line up with anything
+	void checkSequentialRead(Common::SeekableReadStream *stream, uint32 size) {
+		TS_ASSERT_EQUALS(stream->size(), (int32)size);
+
+		byte *buffer = new byte[size];
+		uint32 total = 0;
+		while (!stream->eos() && !stream->err())
+			total += stream->read(buffer + total, MIN<uint32>(77777, size - total + 1));
+		TS_ASSERT_EQUALS(total, size);
+		TS_ASSERT(memcmp(buffer, _data, size) == 0);
+		delete[] buffer;
+	}
+#endif
+
+public:
+#ifdef USE_ZLIB
+	void setUp() {
+		_oldSystem = g_system;
+		g_system = &_system;
+		_data = new byte[kDeflatedSize];
+		makeData();
+	}
+
+	void tearDown() {
+		delete[] _data;
+		g_system = _oldSystem;
+	}
+#endif
+
+	void test_stored_member() {
+#ifdef USE_ZLIB
+		Common::ScopedPtr<Common::Archive> archive(createArchive());
+		TS_ASSERT(archive);
+		Common::ScopedPtr<Common::SeekableReadStream> stream(archive->createReadStreamForMember("stored.bin"));
+		TS_ASSERT(stream);
+
+		checkSequentialRead(stream.get(), kStoredSize);
+		TS_ASSERT(!stream->err());
+
+		checkRead(stream.get(), kStoredSize - 1000, 1000);
+		checkRead(stream.get(), 12345, 1000);
+		checkRead(stream.get(), 0, 1000);
+#endif
+	}
+
+	void test_deflated_member() {
+#ifdef USE_ZLIB
+		Common::ScopedPtr<Common::Archive> archive(createArchive());
+		TS_ASSERT(archive);
+		Common::ScopedPtr<Common::SeekableReadStream> stream(archive->createReadStreamForMember("deflated.bin"));
+		TS_ASSERT(stream);
+
+		checkSequentialRead(stream.get(), kDeflatedSize);
+		TS_ASSERT(!stream->err());
+#endif
+	}
+
+	void test_deflated_member_seek() {
+#ifdef USE_ZLIB
+		Common::ScopedPtr<Common::Archive> archive(createArchive());
+		TS_ASSERT(archive);
+		Common::ScopedPtr<Common::SeekableReadStream> stream(archive->createReadStreamForMember("deflated.bin"));
+		TS_ASSERT(stream);
+
+		// Reads across checkpoints, forwards and backwards past them, and
+		// from checkpoints which are saved on the way to a later position
+		checkRead(stream.get(), kCheckpointInterval - 500, 1000);
+		checkRead(stream.get(), 2 * kCheckpointInterval + 10, 1000);
+		checkRead(stream.get(), 100, 1000);
+		checkRead(stream.get(), kCheckpointInterval, 1000);
+		checkRead(stream.get(), 2 * kCheckpointInterval - 1, 1000);
+		checkRead(stream.get(), kCheckpointInterval + 300000, 1000);
+		checkRead(stream.get(), kDeflatedSize - 1000, 1000);
+		checkRead(stream.get(), 0, 1000);
+
+		uint32 seed = 3;
+		for (int i = 0; i < 20; i++) {
+			seed = seed * 1103515245 + 12345;
+			checkRead(stream.get(), (seed >> 8) % (kDeflatedSize - 1000), 1000);
+		}
+#endif
+	}
+
+	void test_crc_mismatch() {
+#ifdef USE_ZLIB
+		Common::ScopedPtr<Common::Archive> archive(createArchive(true));
+		TS_ASSERT(archive);
+
+		const char *const names[] = { "stored.bin", "deflated.bin" };
+		const uint32 sizes[] = { kStoredSize, kDeflatedSize };
+		for (int i = 0; i < 2; i++) {
+			Common::ScopedPtr<Common::SeekableReadStream> stream(archive->createReadStreamForMember(names[i]));
+			TS_ASSERT(stream);
+
+			// The data itself reads fine, the error shows up at its end
+			byte *buffer = new byte[sizes[i]];
+			TS_ASSERT_EQUALS(stream->read(buffer, sizes[i] - 1), sizes[i] - 1);
+			TS_ASSERT(!stream->err());
+			stream->read(buffer + sizes[i] - 1, 1);
+			TS_ASSERT(stream->err());
+			delete[] buffer;
+		}
+#endif
+	}
+};
@@ -0,0 +1,97 @@
+#include <cxxtest/TestSuite.h>
+
+#include "common/memstream.h"
+#include "common/zlib.h"
+
+class ZlibTestSuite : public CxxTest::TestSuite {
+	enum {
+		// Spans several of the seek checkpoints of GZipReadStream
+		kDataSize = 1500 * 1000
+	};
+
+	byte *_data;
+
+	// Compressible, but not trivially so
+	void makeData() {
+		uint32 seed = 1;
+		for (uint32 i = 0; i < kDataSize; i++) {
+			seed = seed * 1103515245 + 12345;
+			_data[i] = (byte)((seed >> 16) % 40 + (i >> 12));
+		}
+	}
+
+	Common::SeekableReadStream *createCompressedStream() {
+		// The compressing stream deletes the write stream, but not its data
+		Common::MemoryWriteStreamDynamic *compressed = new Common::MemoryWriteStreamDynamic(DisposeAfterUse::NO);
+		Common::WriteStream *stream = Common::wrapCompressedWriteStream(compressed);
+		stream->write(_data, kDataSize);
+		stream->finalize();
+
+		byte *buffer = compressed->getData();
+		const uint32 size = compressed->size();
+		delete stream;
+
+		return Common::wrapCompressedReadStream(new Common::MemoryReadStream(buffer, size, DisposeAfterUse::YES));
+	}
+
+	void checkRead(Common::SeekableReadStream *stream, uint32 pos, uint32 size) {
+		byte buffer[1000];
+		TS_ASSERT(stream->seek(pos));
+		TS_ASSERT_EQUALS(stream->pos(), (int32)pos);
+		TS_ASSERT_EQUALS(stream->read(buffer, size), size);
+		TS_ASSERT(memcmp(buffer, _data + pos, size) == 0);
+	}
+
+public:
+	void setUp() {
+		_data = new byte[kDataSize];
+		makeData();
+	}
+
+	void tearDown() {
+		delete[] _data;
+	}
+
+	void test_sequential_read() {
+#ifdef USE_ZLIB
+		Common::SeekableReadStream *stream = createCompressedStream();
+		TS_ASSERT_EQUALS(stream->size(), (int32)kDataSize);
+
+		byte *buffer = new byte[kDataSize];
+		TS_ASSERT_EQUALS(stream->read(buffer, kDataSize), (uint32)kDataSize);
+		TS_ASSERT(memcmp(buffer, _data, kDataSize) == 0);
+		TS_ASSERT(!stream->eos());
+
+		TS_ASSERT_EQUALS(stream->read(buffer, 1), 0u);
+		TS_ASSERT(stream->eos());
+		TS_ASSERT(!stream->err());
+
+		delete[] buffer;
+		delete stream;
+#endif
+	}
+
+	void test_random_seek() {
+#ifdef USE_ZLIB
+		Common::SeekableReadStream *stream = createCompressedStream();
+
+		// Backwards and forwards, before and after the data has been
+		// decompressed for the first time
+		checkRead(stream, kDataSize - 1000, 1000);
+		checkRead(stream, 0, 1000);
+		checkRead(stream, 600 * 1000, 1000);
+		checkRead(stream, 300 * 1000, 1000);
+
+		uint32 seed = 7;
+		for (int i = 0; i < 50; i++) {
+			seed = seed * 1103515245 + 12345;
+			checkRead(stream, (seed >> 8) % (kDataSize - 1000), 1000);
+		}
+
+		checkRead(stream, 0, 1000);
+		TS_ASSERT(!stream->err());
+
+		delete stream;
+#endif
+	}
+};
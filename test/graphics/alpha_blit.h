@@ -0,0 +1,137 @@
+#include <cxxtest/TestSuite.h>
+
+#include "common/util.h"
+#include "graphics/alpha_blit.h"
+
+class AlphaBlitTestSuite : public CxxTest::TestSuite {
+	enum {
+		// Enough for several vectors plus every possible leftover
+		kMaxWidth = 19
+	};
+
+	// Byte order of the pixels, as in TransparentSurface
+#ifdef SCUMM_LITTLE_ENDIAN
+	enum { kAIndex = 0, kBIndex = 1, kGIndex = 2, kRIndex = 3 };
+#else
+	enum { kAIndex = 3, kBIndex = 2, kGIndex = 1, kRIndex = 0 };
+#endif
+
+	enum Kernel {
+		kOpaque,
+		kBinary,
+		kAlpha
+	};
+
+	uint32 _seed;
+	byte _src[kMaxWidth * 4];
+	byte _dst[kMaxWidth * 4];
+
+	uint32 nextRandom() {
+		_seed = _seed * 1103515245 + 12345;
+		return _seed >> 8;
+	}
+
+	// Scalar versions of the blits, as Wintermute's BlenderNormal and
+	// doBlit*Fast() do them for each pixel
+	static void referencePixel(Kernel kernel, const byte *in, byte *out) {
+		const byte ina = in[kAIndex];
+
+		if (kernel == kOpaque || (kernel == kBinary && ina != 0)) {
+			memcpy(out, in, 4);
+			out[kAIndex] = 0xFF;
+		} else if (kernel == kAlpha && ina == 255) {
+			memcpy(out, in, 4);
+		} else if (kernel == kAlpha && ina != 0) {
+			out[kAIndex] = 255;
+			out[kBIndex] = ((in[kBIndex] * ina) + out[kBIndex] * (255 - ina)) >> 8;
+			out[kGIndex] = ((in[kGIndex] * ina) + out[kGIndex] * (255 - ina)) >> 8;
+			out[kRIndex] = ((in[kRIndex] * ina) + out[kRIndex] * (255 - ina)) >> 8;
+		}
+	}
+
+	// Fill the source row with the given alpha value, or with random ones
+	// if it is negative. Random rows also get whole vectors of fully
+	// transparent and fully opaque pixels now and then, which the vector
+	// loops handle separately.
+	void setupRows(uint32 seed, int alpha) {
+		_seed = seed;
+		for (int i = 0; i < ARRAYSIZE(_src); ++i) {
+			_src[i] = nextRandom() & 0xFF;
+			_dst[i] = nextRandom() & 0xFF;
+		}
+
+		for (int i = 0; i < kMaxWidth; ++i) {
+			if (alpha >= 0) {
+				_src[i * 4 + kAIndex] = alpha;
+				continue;
+			}
+
+			switch ((nextRandom() >> 4) % 4) {
+			case 0:
+				_src[i * 4 + kAIndex] = 0;
+				break;
+			case 1:
+				_src[i * 4 + kAIndex] = 255;
+				break;
+			default:
+				break;
+			}
+		}
+
+		if (alpha < 0 && (seed & 1)) {
+			const int block = (nextRandom() >> 4) % (kMaxWidth / 4) * 4;
+			const byte value = (seed & 2) ? 255 : 0;
+			for (int i = block; i < block + 4; ++i)
+				_src[i * 4 + kAIndex] = value;
+		}
+	}
+
+	void checkKernel(Kernel kernel, uint32 seed, int alpha) {
+		for (uint32 width = 1; width <= kMaxWidth; ++width) {
+			setupRows(seed + width, alpha);
+
+			byte expected[kMaxWidth * 4];
+			memcpy(expected, _dst, sizeof(expected));
+			for (uint32 i = 0; i < width; ++i)
+				referencePixel(kernel, &_src[i * 4], &expected[i * 4]);
+
+			switch (kernel) {
+			case kOpaque:
+				Graphics::blitRowOpaque(_src, _dst, width);
+				break;
+			case kBinary:
+				Graphics::blitRowBinary(_src, _dst, width);
+				break;
+			case kAlpha:
+				Graphics::blitRowAlpha(_src, _dst, width);
+				break;
+			}
+
+			// Also checks that nothing past the row is touched
+			TS_ASSERT_EQUALS(memcmp(_dst, expected, sizeof(expected)), 0);
+		}
+	}
+
+	void checkAllAlphas(Kernel kernel) {
+		checkKernel(kernel, 1, 0);
+		checkKernel(kernel, 2, 255);
+		checkKernel(kernel, 3, 1);
+		checkKernel(kernel, 4, 128);
+		checkKernel(kernel, 5, 254);
+		for (uint32 seed = 0; seed < 64; ++seed)
+			checkKernel(kernel, seed * 97, -1);
+	}
+
+public:
+	void test_blit_row_opaque() {
+		checkAllAlphas(kOpaque);
+	}
+
+	void test_blit_row_binary() {
+		checkAllAlphas(kBinary);
+	}
+
+	void test_blit_row_alpha() {
+		checkAllAlphas(kAlpha);
+	}
+};
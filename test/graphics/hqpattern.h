@@ -0,0 +1,116 @@
+#include <cxxtest/TestSuite.h>
+
+#include "graphics/scaler/intern.h"
+
+class HQPatternTestSuite : public CxxTest::TestSuite {
+	enum {
+		kWidth = 2 * kHQPatternChunkSize + 7,
+		kHeight = 6,
+		kPitch = kWidth + 2
+	};
+
+	uint32 _seed;
+	uint32 _yuvTable[65536];
+	uint16 _image[(kHeight + 2) * kPitch];
+
+	uint32 nextRandom() {
+		_seed = _seed * 1103515245 + 12345;
+		return _seed >> 8;
+	}
+
+	// Same conversion as InitLUT() for RGB565
+	void setupTable() {
+		for (int color = 0; color < 65536; ++color) {
+			const int r = ((color >> 11) & 0x1F) << 3;
+			const int g = ((color >> 5) & 0x3F) << 2;
+			const int b = (color & 0x1F) << 3;
+			const int Y = (r + g + b) >> 2;
+			const int u = 128 + ((r - b) >> 2);
+			const int v = 128 + ((-r + 2 * g - b) >> 3);
+			_yuvTable[color] = (Y << 16) | (u << 8) | v;
+		}
+	}
+
+	// Mix flat areas, small gradients and hard edges, so that every
+	// comparison in the pattern goes both ways somewhere in the image.
+	void setupImage() {
+		for (int i = 0; i < (kHeight + 2) * kPitch; ++i) {
+			const uint32 choice = nextRandom() % 4;
+			if (i > 0 && choice == 0)
+				_image[i] = _image[i - 1];
+			else if (i >= kPitch && choice == 1)
+				_image[i] = _image[i - kPitch];
+			else if (i > 0 && choice == 2)
+				_image[i] = _image[i - 1] ^ (nextRandom() & 0x0841);
+			else
+				_image[i] = nextRandom();
+		}
+	}
+
+	int referencePattern(const uint16 *p) {
+		static const int offsets[8][2] = {
+			{ -1, -1 }, { 0, -1 }, { 1, -1 },
+			{ -1,  0 },            { 1,  0 },
+			{ -1,  1 }, { 0,  1 }, { 1,  1 }
+		};
+
+		const int w5 = *p;
+		int pattern = 0;
+		for (int i = 0; i < 8; ++i) {
+			const int w = *(p + offsets[i][0] + offsets[i][1] * kPitch);
+			if (w5 != w && diffYUV(_yuvTable[w5], _yuvTable[w]))
+				pattern |= 1 << i;
+		}
+		return pattern;
+	}
+
+	void checkImage() {
+		uint8 patterns[kWidth];
+		bool seen[256];
+		int distinct = 0;
+
+		for (int i = 0; i < 256; ++i)
+			seen[i] = false;
+
+		for (int y = 1; y <= kHeight; ++y) {
+			const uint16 *row = _image + y * kPitch + 1;
+			computeHQPatterns(row, kPitch, kWidth, _yuvTable, patterns);
+
+			for (int x = 0; x < kWidth; ++x) {
+				const int expected = referencePattern(row + x);
+				TS_ASSERT_EQUALS(patterns[x], expected);
+				if (!seen[expected]) {
+					seen[expected] = true;
+					++distinct;
+				}
+			}
+		}
+
+		// Make sure the image actually exercised the pattern computation
+		TS_ASSERT_LESS_THAN(32, distinct);
+	}
+
+public:
+	void test_patterns_match_reference() {
+		setupTable();
+		for (_seed = 1; _seed < 9; ++_seed) {
+			setupImage();
+			checkImage();
+		}
+	}
+
+	void test_short_runs() {
+		setupTable();
+		_seed = 42;
+		setupImage();
+
+		uint8 patterns[kHQPatternChunkSize + 1];
+		const uint16 *row = _image + kPitch + 1;
+		for (int width = 1; width <= kHQPatternChunkSize + 1; ++width) {
+			patterns[width - 1] = 0xAA;
+			computeHQPatterns(row, kPitch, width, _yuvTable, patterns);
+			for (int x = 0; x < width; ++x)
+				TS_ASSERT_EQUALS(patterns[x], referencePattern(row + x));
+		}
+	}
+};
@@ -0,0 +1,176 @@
+#include <cxxtest/TestSuite.h>
+
+#include "common/util.h"
+#include "graphics/pixelformat.h"
+#include "graphics/surface.h"
+#include "graphics/yuv_to_rgb.h"
+
+class YUVToRGBTestSuite : public CxxTest::TestSuite {
+	enum {
+		// Not a multiple of the vector width, so that the leftover columns
+		// are converted as well
+		kWidth = 44,
+		kHeight = 12,
+		kYPitch = kWidth + 5,
+		kUVPitch = kWidth + 3
+	};
+
+	uint32 _seed;
+	byte _y[kHeight * kYPitch];
+	byte _u[(kHeight + 1) * kUVPitch];
+	byte _v[(kHeight + 1) * kUVPitch];
+
+	uint32 nextRandom() {
+		_seed = _seed * 1103515245 + 12345;
+		return _seed >> 8;
+	}
+
+	// Use extreme values now and then, so that all components get clipped
+	byte randomSample() {
+		const uint32 value = nextRandom();
+		switch (value & 7) {
+		case 0:
+			return 0;
+		case 1:
+			return 255;
+		default:
+			return (value >> 3) & 0xFF;
+		}
+	}
+
+	void setupPlanes(uint32 seed) {
+		_seed = seed;
+		for (int i = 0; i < ARRAYSIZE(_y); ++i)
+			_y[i] = randomSample();
+		for (int i = 0; i < ARRAYSIZE(_u); ++i) {
+			_u[i] = randomSample();
+			_v[i] = randomSample();
+		}
+	}
+
+	static int scaleComponent(int x, Graphics::YUVToRGBManager::LuminanceScale scale) {
+		if (scale == Graphics::YUVToRGBManager::kScaleFull)
+			return CLIP(x, 0, 255);
+
+		return (CLIP(x, 16, 235) - 16) * 255 / 219;
+	}
+
+	// Same values as the lookup tables of YUVToRGBManager
+	static uint32 referencePixel(const Graphics::PixelFormat &format, Graphics::YUVToRGBManager::LuminanceScale scale, int y, int u, int v) {
+		const int16 cr = v - 128, cb = u - 128;
+		const int r = y + (int16)((0.419 / 0.299) * cr);
+		const int g = y + (int16)(-(0.299 / 0.419) * cr) + (int16)(-(0.114 / 0.331) * cb);
+		const int b = y + (int16)((0.587 / 0.331) * cb);
+		return format.RGBToColor(scaleComponent(r, scale), scaleComponent(g, scale), scaleComponent(b, scale));
+	}
+
+	static int getField(uint32 color, int loss, int shift) {
+		return (color >> shift) & (0xFF >> loss);
+	}
+
+	static void checkPixel(const Graphics::PixelFormat &format, uint32 expected, uint32 actual) {
+		TS_ASSERT_LESS_THAN_EQUALS(ABS(getField(expected, format.rLoss, format.rShift) - getField(actual, format.rLoss, format.rShift)), 1);
+		TS_ASSERT_LESS_THAN_EQUALS(ABS(getField(expected, format.gLoss, format.gShift) - getField(actual, format.gLoss, format.gShift)), 1);
+		TS_ASSERT_LESS_THAN_EQUALS(ABS(getField(expected, format.bLoss, format.bShift) - getField(actual, format.bLoss, format.bShift)), 1);
+		TS_ASSERT_EQUALS(getField(expected, format.aLoss, format.aShift), getField(actual, format.aLoss, format.aShift));
+	}
+
+	static uint32 getPixel(const Graphics::Surface &surface, int x, int y) {
+		if (surface.format.bytesPerPixel == 2)
+			return *(const uint16 *)surface.getBasePtr(x, y);
+
+		return *(const uint32 *)surface.getBasePtr(x, y);
+	}
+
+	// Interpolation of the chroma planes, as done by convert410()
+	int interpolate410(const byte *plane, int x, int y) {
+		const byte *quad = plane + (y >> 2) * kUVPitch + (x >> 2);
+		const int xDiff = x & 3, yDiff = y & 3;
+		return (quad[0] * (4 - xDiff) * (4 - yDiff) + quad[1] * xDiff * (4 - yDiff) +
+				quad[kUVPitch] * yDiff * (4 - xDiff) + quad[kUVPitch + 1] * xDiff * yDiff) >> 4;
+	}
+
+	// Convert into a surface wider than the image, so that its pitch
+	// differs from the width of the converted image
+	void checkConversion(const Graphics::PixelFormat &format, Graphics::YUVToRGBManager::LuminanceScale scale, int mode) {
+		// Set up by hand, so that the test only needs yuv_to_rgb.o
+		byte *pixels = new byte[(kWidth + 3) * kHeight * format.bytesPerPixel];
+		Graphics::Surface surface;
+		surface.w = kWidth + 3;
+		surface.h = kHeight;
+		surface.pitch = (kWidth + 3) * format.bytesPerPixel;
+		surface.format = format;
+		surface.setPixels(pixels);
+
+		switch (mode) {
+		case 444:
+			YUVToRGBMan.convert444(&surface, scale, _y, _u, _v, kWidth, kHeight, kYPitch, kUVPitch);
+			break;
+		case 420:
+			YUVToRGBMan.convert420(&surface, scale, _y, _u, _v, kWidth, kHeight, kYPitch, kUVPitch);
+			break;
+		default:
+			YUVToRGBMan.convert410(&surface, scale, _y, _u, _v, kWidth, kHeight, kYPitch, kUVPitch);
+			break;
+		}
+
+		for (int y = 0; y < kHeight; ++y) {
+			for (int x = 0; x < kWidth; ++x) {
+				int u, v;
+
+				switch (mode) {
+				case 444:
+					u = _u[y * kUVPitch + x];
+					v = _v[y * kUVPitch + x];
+					break;
+				case 420:
+					u = _u[(y >> 1) * kUVPitch + (x >> 1)];
+					v = _v[(y >> 1) * kUVPitch + (x >> 1)];
+					break;
+				default:
+					u = interpolate410(_u, x, y);
+					v = interpolate410(_v, x, y);
+					break;
+				}
+
+				checkPixel(format, referencePixel(format, scale, _y[y * kYPitch + x], u, v), getPixel(surface, x, y));
+			}
+		}
+
+		delete[] pixels;
+	}
+
+	void checkFormat(const Graphics::PixelFormat &format) {
+		for (uint32 seed = 1; seed < 4; ++seed) {
+			setupPlanes(seed);
+
+			checkConversion(format, Graphics::YUVToRGBManager::kScaleFull, 444);
+			checkConversion(format, Graphics::YUVToRGBManager::kScaleITU, 444);
+			checkConversion(format, Graphics::YUVToRGBManager::kScaleFull, 420);
+			checkConversion(format, Graphics::YUVToRGBManager::kScaleITU, 420);
+			checkConversion(format, Graphics::YUVToRGBManager::kScaleFull, 410);
+			checkConversion(format, Graphics::YUVToRGBManager::kScaleITU, 410);
+		}
+	}
+
+public:
+	void test_rgb565() {
+		checkFormat(Graphics::PixelFormat(2, 5, 6, 5, 0, 11, 5, 0, 0));
+	}
+
+	void test_argb1555() {
+		checkFormat(Graphics::PixelFormat(2, 5, 5, 5, 1, 10, 5, 0, 15));
+	}
+
+	void test_rgba8888() {
+		checkFormat(Graphics::PixelFormat(4, 8, 8, 8, 8, 24, 16, 8, 0));
+	}
+
+	void test_argb8888() {
+		checkFormat(Graphics::PixelFormat(4, 8, 8, 8, 8, 16, 8, 0, 24));
+	}
+
+	void test_xrgb8888() {
+		checkFormat(Graphics::PixelFormat(4, 8, 8, 8, 0, 16, 8, 0, 0));
+	}
+};
@@ -5,8 +5,10 @@
 #
 ######################################################################
 
-TESTS        := $(srcdir)/test/common/*.h $(srcdir)/test/audio/*.h
-TEST_LIBS    := audio/libaudio.a common/libcommon.a
+TESTS        := $(srcdir)/test/common/*.h $(srcdir)/test/audio/*.h $(srcdir)/test/graphics/*.h
+# Only the graphics objects the tests need, as not all of libgraphics.a
+# builds on every platform the tests run on
+TEST_LIBS    := audio/libaudio.a graphics/alpha_blit.o graphics/yuv_to_rgb.o common/libcommon.a
 
 #
 TEST_FLAGS   := --runner=StdioPrinter --no-std --no-eh --include=$(srcdir)/test/cxxtest_mingw.h
@@ -14,6 +16,11 @@ TEST_CFLAGS  := -I$(srcdir)/test/cxxtest
 TEST_LDFLAGS := $(LIBS)
 TEST_CXXFLAGS := $(filter-out -Wglobal-constructors,$(CXXFLAGS))
 
+ifdef POSIX
+# The mixer test runs an audio thread
+TEST_LDFLAGS += -lpthread
+endif
+
 ifdef HAVE_GCC3
 # In test/common/str.h, we test a zero length format string. This causes GCC
 # to generate a warning which in turn poses a problem when building with -Werror.
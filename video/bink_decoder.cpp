@@ -46,6 +46,11 @@
 #include "video/binkdata.h"
 #include "video/bink_decoder.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define BINK_SSE2
+#endif
+
 static const uint32 kBIKfID = MKTAG('B', 'I', 'K', 'f');
 static const uint32 kBIKgID = MKTAG('B', 'I', 'K', 'g');
 static const uint32 kBIKhID = MKTAG('B', 'I', 'K', 'h');
@@ -815,11 +820,7 @@ void BinkDecoder::BinkVideoTrack::blockResidue(DecodeContext &ctx) {
 
 	readResidue(*ctx.video, block, v);
 
-	byte  *dst = ctx.dest;
-	int16 *src = block;
-	for (int i = 0; i < 8; i++, dst += ctx.pitch, src += 8)
-		for (int j = 0; j < 8; j++)
-			dst[j] += src[j];
+	addBlock(ctx.dest, ctx.pitch, block);
 }
 
 void BinkDecoder::BinkVideoTrack::blockIntra(DecodeContext &ctx) {
@@ -1305,6 +1306,133 @@ void BinkDecoder::BinkVideoTrack::readResidue(VideoFrame &video, int16 *block, i
 #define MUNGE_ROW(x) (((x) + 0x7F)>>8)
 #define IDCT_ROW(dest,src) IDCT_TRANSFORM(dest,0,1,2,3,4,5,6,7,0,1,2,3,4,5,6,7,MUNGE_ROW,src)
 
+#ifdef BINK_SSE2
+
+/** Multiply four 32-bit values by a constant, keeping the low 32 bits of the products. */
+static inline __m128i mulConstSSE2(__m128i a, int c) {
+	const __m128i k = _mm_set1_epi32(c);
+	const __m128i even = _mm_mul_epu32(a, k);
+	const __m128i odd  = _mm_mul_epu32(_mm_srli_epi64(a, 32), k);
+
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+	                          _mm_shuffle_epi32(odd,  _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+/** Truncate four 32-bit values to 16 bits, sign-extended again. */
+static inline __m128i truncate16SSE2(__m128i a) {
+	return _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+}
+
+/**
+ * IDCT_TRANSFORM on four columns at once. s[i] holds the i-th input of each
+ * column, d[i] receives the i-th output.
+ */
+static inline void IDCTTransformSSE2(const __m128i *s, __m128i *d, bool munge) {
+	const __m128i a0 = _mm_add_epi32(s[0], s[4]);
+	const __m128i a1 = _mm_sub_epi32(s[0], s[4]);
+	const __m128i a2 = _mm_add_epi32(s[2], s[6]);
+	const __m128i a3 = _mm_srai_epi32(mulConstSSE2(_mm_sub_epi32(s[2], s[6]), A1), 11);
+	const __m128i a4 = _mm_add_epi32(s[5], s[3]);
+	const __m128i a5 = _mm_sub_epi32(s[5], s[3]);
+	const __m128i a6 = _mm_add_epi32(s[1], s[7]);
+	const __m128i a7 = _mm_sub_epi32(s[1], s[7]);
+	const __m128i b0 = _mm_add_epi32(a4, a6);
+	const __m128i b1 = _mm_srai_epi32(mulConstSSE2(_mm_add_epi32(a5, a7), A3), 11);
+	const __m128i b2 = _mm_add_epi32(_mm_sub_epi32(_mm_srai_epi32(mulConstSSE2(a5, A4), 11), b0), b1);
+	const __m128i b3 = _mm_sub_epi32(_mm_srai_epi32(mulConstSSE2(_mm_sub_epi32(a6, a4), A1), 11), b2);
+	const __m128i b4 = _mm_sub_epi32(_mm_add_epi32(_mm_srai_epi32(mulConstSSE2(a7, A2), 11), b3), b1);
+
+	const __m128i a0a2 = _mm_add_epi32(a0, a2);
+	const __m128i a0s2 = _mm_sub_epi32(a0, a2);
+	const __m128i a1a3 = _mm_sub_epi32(_mm_add_epi32(a1, a3), a2);
+	const __m128i a1s3 = _mm_add_epi32(_mm_sub_epi32(a1, a3), a2);
+
+	d[0] = _mm_add_epi32(a0a2, b0);
+	d[1] = _mm_add_epi32(a1a3, b2);
+	d[2] = _mm_add_epi32(a1s3, b3);
+	d[3] = _mm_sub_epi32(a0s2, b4);
+	d[4] = _mm_add_epi32(a0s2, b4);
+	d[5] = _mm_sub_epi32(a1s3, b3);
+	d[6] = _mm_sub_epi32(a1a3, b2);
+	d[7] = _mm_sub_epi32(a0a2, b0);
+
+	if (munge) {
+		const __m128i round = _mm_set1_epi32(0x7F);
+		for (int i = 0; i < 8; i++)
+			d[i] = _mm_srai_epi32(_mm_add_epi32(d[i], round), 8);
+	}
+}
+
+/** Transpose an 8x8 matrix of 16-bit values. */
+static inline void transpose8x8SSE2(__m128i *r) {
+	const __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+	const __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+	const __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+	const __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+	const __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+	const __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+	const __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+	const __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+
+	const __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+	const __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+	const __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+	const __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+	const __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+	const __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+	const __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+	const __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+	r[0] = _mm_unpacklo_epi64(b0, b4);
+	r[1] = _mm_unpackhi_epi64(b0, b4);
+	r[2] = _mm_unpacklo_epi64(b1, b5);
+	r[3] = _mm_unpackhi_epi64(b1, b5);
+	r[4] = _mm_unpacklo_epi64(b2, b6);
+	r[5] = _mm_unpackhi_epi64(b2, b6);
+	r[6] = _mm_unpacklo_epi64(b3, b7);
+	r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+/**
+ * Apply IDCT_COL and IDCT_ROW to a block, with the same intermediate
+ * truncation to 16 bits as the scalar code. rows receives the 8 output
+ * rows as 16-bit values.
+ */
+static void IDCTSSE2(const int16 *block, __m128i *rows) {
+	__m128i lo[8], hi[8], dLo[8], dHi[8];
+
+	// Columns: each vector holds one row of four columns
+	for (int i = 0; i < 8; i++) {
+		const __m128i row = _mm_loadu_si128((const __m128i *)(block + 8 * i));
+		lo[i] = _mm_srai_epi32(_mm_unpacklo_epi16(row, row), 16);
+		hi[i] = _mm_srai_epi32(_mm_unpackhi_epi16(row, row), 16);
+	}
+
+	IDCTTransformSSE2(lo, dLo, false);
+	IDCTTransformSSE2(hi, dHi, false);
+
+	for (int i = 0; i < 8; i++)
+		rows[i] = _mm_packs_epi32(truncate16SSE2(dLo[i]), truncate16SSE2(dHi[i]));
+
+	// Rows: transpose, so that each vector holds one column of the rows
+	transpose8x8SSE2(rows);
+
+	for (int i = 0; i < 8; i++) {
+		lo[i] = _mm_srai_epi32(_mm_unpacklo_epi16(rows[i], rows[i]), 16);
+		hi[i] = _mm_srai_epi32(_mm_unpackhi_epi16(rows[i], rows[i]), 16);
+	}
+
+	IDCTTransformSSE2(lo, dLo, true);
+	IDCTTransformSSE2(hi, dHi, true);
+
+	for (int i = 0; i < 8; i++)
+		rows[i] = _mm_packs_epi32(truncate16SSE2(dLo[i]), truncate16SSE2(dHi[i]));
+
+	transpose8x8SSE2(rows);
+}
+
+#endif // BINK_SSE2
+
 static inline void IDCTCol(int16 *dest, const int16 *src) {
 	if ((src[8] | src[16] | src[24] | src[32] | src[40] | src[48] | src[56]) == 0) {
 		dest[ 0] =
@@ -1321,6 +1449,13 @@ static inline void IDCTCol(int16 *dest, const int16 *src) {
 }
 
 void BinkDecoder::BinkVideoTrack::IDCT(int16 *block) {
+#ifdef BINK_SSE2
+	__m128i rows[8];
+	IDCTSSE2(block, rows);
+
+	for (int i = 0; i < 8; i++)
+		_mm_storeu_si128((__m128i *)(block + 8 * i), rows[i]);
+#else
 	int i;
 	int16 temp[64];
 
@@ -1329,19 +1464,24 @@ void BinkDecoder::BinkVideoTrack::IDCT(int16 *block) {
 	for (i = 0; i < 8; i++) {
 		IDCT_ROW( (&block[8*i]), (&temp[8*i]) );
 	}
+#endif
 }
 
 void BinkDecoder::BinkVideoTrack::IDCTAdd(DecodeContext &ctx, int16 *block) {
-	int i, j;
-
 	IDCT(block);
-	byte *dest = ctx.dest;
-	for (i = 0; i < 8; i++, dest += ctx.pitch, block += 8)
-		for (j = 0; j < 8; j++)
-			 dest[j] += block[j];
+	addBlock(ctx.dest, ctx.pitch, block);
 }
 
 void BinkDecoder::BinkVideoTrack::IDCTPut(DecodeContext &ctx, int16 *block) {
+#ifdef BINK_SSE2
+	__m128i rows[8];
+	IDCTSSE2(block, rows);
+
+	// Only the low 8 bits of each value are stored, like the scalar code does
+	const __m128i lowBytes = _mm_set1_epi16(0xFF);
+	for (int i = 0; i < 8; i++)
+		_mm_storel_epi64((__m128i *)(ctx.dest + i * ctx.pitch), _mm_packus_epi16(_mm_and_si128(rows[i], lowBytes), _mm_setzero_si128()));
+#else
 	int i;
 	int16 temp[64];
 	for (i = 0; i < 8; i++)
@@ -1349,6 +1489,23 @@ void BinkDecoder::BinkVideoTrack::IDCTPut(DecodeContext &ctx, int16 *block) {
 	for (i = 0; i < 8; i++) {
 		IDCT_ROW( (&ctx.dest[i*ctx.pitch]), (&temp[8*i]) );
 	}
+#endif
+}
+
+void BinkDecoder::BinkVideoTrack::addBlock(byte *dest, uint32 pitch, const int16 *block) {
+#ifdef BINK_SSE2
+	// The sums wrap around at 8 bits, like the scalar code
+	const __m128i lowBytes = _mm_set1_epi16(0xFF);
+	for (int i = 0; i < 8; i++, dest += pitch, block += 8) {
+		const __m128i d = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)dest), _mm_setzero_si128());
+		const __m128i sum = _mm_add_epi16(d, _mm_loadu_si128((const __m128i *)block));
+		_mm_storel_epi64((__m128i *)dest, _mm_packus_epi16(_mm_and_si128(sum, lowBytes), _mm_setzero_si128()));
+	}
+#else
+	for (int i = 0; i < 8; i++, dest += pitch, block += 8)
+		for (int j = 0; j < 8; j++)
+			dest[j] += block[j];
+#endif
 }
 
 BinkDecoder::BinkAudioTrack::BinkAudioTrack(BinkDecoder::AudioInfo &audio) : _audioInfo(&audio) {
@@ -76,6 +76,7 @@ protected:
 	void readNextPacket();
 	bool supportsAudioTrackSwitching() const { return true; }
 	AudioTrack *getAudioTrack(int index);
+	bool supportsReadAhead() const { return true; }
 
 private:
 	static const int kAudioChannelsMax  = 2;
@@ -316,6 +317,9 @@ private:
 		void IDCT(int16 *block);
 		void IDCTPut(DecodeContext &ctx, int16 *block);
 		void IDCTAdd(DecodeContext &ctx, int16 *block);
+
+		/** Add a block of 8x8 values to the destination, wrapping around at 8 bits. */
+		void addBlock(byte *dest, uint32 pitch, const int16 *block);
 	};
 
 	class BinkAudioTrack : public AudioTrack {
@@ -28,11 +28,41 @@
 #include "common/rational.h"
 #include "common/file.h"
 #include "common/system.h"
+#include "common/timer.h"
 
 #include "graphics/palette.h"
+#include "graphics/surface.h"
 
 namespace Video {
 
+enum {
+	/** Number of frames decoded ahead of time by default */
+	kDefaultReadAheadFrames = 4,
+
+	/** Interval of the read-ahead timer callback, in microseconds */
+	kReadAheadInterval = 10000,
+
+	/** Time the timer callback may spend decoding per call, in ms */
+	kReadAheadBudget = 5
+};
+
+/**
+ * A frame decoded ahead of time, together with the state the decoder
+ * reported right after decoding it.
+ */
+struct VideoDecoder::ReadAheadFrame {
+	Graphics::Surface surface;
+	bool hasSurface;
+	bool dirtyPalette;
+	byte palette[256 * 3];
+	int curFrame;
+	uint32 startTime;
+};
+
+// Decoders currently reading ahead, all serviced by a single timer callback
+static Common::Array<VideoDecoder *> *s_readAheadDecoders = 0;
+static Common::Mutex *s_readAheadMutex = 0;
+
 VideoDecoder::VideoDecoder() {
 	_startTime = 0;
 	_dirtyPalette = false;
@@ -47,6 +77,16 @@ VideoDecoder::VideoDecoder() {
 	_endTimeSet = false;
 	_nextVideoTrack = 0;
 	_mainAudioTrack = 0;
+	_readAheadFrames = kDefaultReadAheadFrames;
+	_readAheadActive = false;
+	_readAheadRunning = false;
+	_readAheadTrack = 0;
+	_readAheadDisplayed = 0;
+	_readAheadCurFrame = -1;
+	_readAheadNextFrameTime = 0;
+	_readAheadEnd = false;
+	_readAheadDecodeTime = 0;
+	_readAheadTrackSurface = false;
 
 	// Find the best format for output
 	_defaultHighColorFormat = g_system->getScreenFormat();
@@ -55,7 +95,16 @@ VideoDecoder::VideoDecoder() {
 		_defaultHighColorFormat = Graphics::PixelFormat(4, 8, 8, 8, 8, 8, 16, 24, 0);
 }
 
+VideoDecoder::~VideoDecoder() {
+	stopReadAhead();
+	freeReadAhead();
+}
+
 void VideoDecoder::close() {
+	stopReadAhead();
+	resetReadAhead();
+	freeReadAhead();
+
 	if (isPlaying())
 		stop();
 
@@ -95,6 +144,9 @@ bool VideoDecoder::needsUpdate() const {
 }
 
 void VideoDecoder::pauseVideo(bool pause) {
+	// No frames are decoded ahead while paused
+	stopReadAhead();
+
 	if (pause) {
 		_pauseLevel++;
 
@@ -118,6 +170,9 @@ void VideoDecoder::pauseVideo(bool pause) {
 
 		_startTime += (g_system->getMillis() - _pauseStartTime);
 	}
+
+	if (isPlaying())
+		startReadAhead();
 }
 
 void VideoDecoder::resetPauseStartTime() {
@@ -172,6 +227,9 @@ Graphics::PixelFormat VideoDecoder::getPixelFormat() const {
 const Graphics::Surface *VideoDecoder::decodeNextFrame() {
 	_needsUpdate = false;
 
+	if (_readAheadActive)
+		return decodeReadAheadFrame();
+
 	readNextPacket();
 
 	// If we have no next video track at this point, there shouldn't be
@@ -197,6 +255,19 @@ bool VideoDecoder::setReverse(bool reverse) {
 	if (reverse && hasAudio())
 		return false;
 
+	// Frames decoded ahead of time cannot be played backwards, so go back
+	// to the first of them before changing the direction
+	if (reverse && _readAheadActive) {
+		stopReadAhead();
+
+		bool framesPending = !_readAheadQueue.empty();
+		uint32 time = trackNextFrameTime(_readAheadTrack);
+		resetReadAhead();
+
+		if (framesPending && isSeekable())
+			seekIntern(Audio::Timestamp(time, 1000));
+	}
+
 	// Attempt to make sure all the tracks are in the requested direction
 	for (TrackList::iterator it = _tracks.begin(); it != _tracks.end(); it++) {
 		if ((*it)->getTrackType() == Track::kTrackTypeVideo && ((VideoTrack *)*it)->isReversed() != reverse) {
@@ -217,6 +288,11 @@ const byte *VideoDecoder::getPalette() {
 }
 
 int VideoDecoder::getCurFrame() const {
+	if (_readAheadActive) {
+		Common::StackLock lock(_readAheadMutex);
+		return _readAheadCurFrame;
+	}
+
 	int32 frame = -1;
 
 	for (TrackList::const_iterator it = _tracks.begin(); it != _tracks.end(); it++)
@@ -262,7 +338,7 @@ uint32 VideoDecoder::getTimeToNextFrame() const {
 		return 0;
 
 	uint32 currentTime = getTime();
-	uint32 nextFrameStartTime = _nextVideoTrack->getNextFrameStartTime();
+	uint32 nextFrameStartTime = trackNextFrameTime(_nextVideoTrack);
 
 	if (_nextVideoTrack->isReversed()) {
 		// For reversed videos, we need to handle the time difference the opposite way.
@@ -281,7 +357,7 @@ uint32 VideoDecoder::getTimeToNextFrame() const {
 
 bool VideoDecoder::endOfVideo() const {
 	for (TrackList::const_iterator it = _tracks.begin(); it != _tracks.end(); it++)
-		if (!(*it)->endOfTrack() && (!isPlaying() || (*it)->getTrackType() != Track::kTrackTypeVideo || !_endTimeSet || ((VideoTrack *)*it)->getNextFrameStartTime() < (uint)_endTime.msecs()))
+		if (!trackEnded(*it) && (!isPlaying() || (*it)->getTrackType() != Track::kTrackTypeVideo || !_endTimeSet || trackNextFrameTime((VideoTrack *)*it) < (uint)_endTime.msecs()))
 			return false;
 
 	return true;
@@ -302,6 +378,10 @@ bool VideoDecoder::rewind() {
 	if (!isRewindable())
 		return false;
 
+	// Frames decoded ahead of time are of no use anymore
+	stopReadAhead();
+	resetReadAhead();
+
 	// Stop all tracks so they can be rewound
 	if (isPlaying())
 		stopAudio();
@@ -318,6 +398,10 @@ bool VideoDecoder::rewind() {
 	_startTime = g_system->getMillis();
 	resetPauseStartTime();
 	findNextVideoTrack();
+
+	if (isPlaying())
+		startReadAhead();
+
 	return true;
 }
 
@@ -336,6 +420,10 @@ bool VideoDecoder::seek(const Audio::Timestamp &time) {
 	if (!isSeekable())
 		return false;
 
+	// Frames decoded ahead of time are of no use anymore
+	stopReadAhead();
+	resetReadAhead();
+
 	// Stop all tracks so they can be seeked
 	if (isPlaying())
 		stopAudio();
@@ -361,6 +449,10 @@ bool VideoDecoder::seek(const Audio::Timestamp &time) {
 	resetPauseStartTime();
 	findNextVideoTrack();
 	_needsUpdate = true;
+
+	if (isPlaying())
+		startReadAhead();
+
 	return true;
 }
 
@@ -402,6 +494,9 @@ void VideoDecoder::stop() {
 	if (!isPlaying())
 		return;
 
+	// Keep the frames decoded so far, in case we start up again
+	stopReadAhead();
+
 	// Stop audio here so we don't have it affect getTime()
 	stopAudio();
 
@@ -461,6 +556,7 @@ void VideoDecoder::setRate(const Common::Rational &rate) {
 		_startTime -= (_lastTimeChange.msecs() / _playbackRate).toInt();
 
 	startAudio();
+	startReadAhead();
 }
 
 bool VideoDecoder::isPlaying() const {
@@ -673,6 +769,9 @@ bool VideoDecoder::StreamFileAudioTrack::loadFromFile(const Common::String &base
 }
 
 void VideoDecoder::addTrack(Track *track, bool isExternal) {
+	// Don't change the track list under the timer callback's feet
+	stopReadAhead();
+
 	_tracks.push_back(track);
 
 	if (isExternal)
@@ -708,6 +807,9 @@ void VideoDecoder::addTrack(Track *track, bool isExternal) {
 	// Start the track if we're playing
 	if (isPlaying() && track->getTrackType() == Track::kTrackTypeAudio)
 		((AudioTrack *)track)->start();
+
+	if (isPlaying())
+		startReadAhead();
 }
 
 bool VideoDecoder::addStreamFileTrack(const Common::String &baseName) {
@@ -739,9 +841,15 @@ bool VideoDecoder::setAudioTrack(int index) {
 	if (_mainAudioTrack == audioTrack)
 		return true;
 
+	stopReadAhead();
+
 	_mainAudioTrack->setMute(true);
 	audioTrack->setMute(false);
 	_mainAudioTrack = audioTrack;
+
+	if (isPlaying())
+		startReadAhead();
+
 	return true;
 }
 
@@ -756,6 +864,9 @@ uint VideoDecoder::getAudioTrackCount() const {
 }
 
 void VideoDecoder::setEndTime(const Audio::Timestamp &endTime) {
+	// Frames past the new end time must not be decoded ahead
+	stopReadAhead();
+
 	Audio::Timestamp startTime = 0;
 
 	if (isPlaying()) {
@@ -776,6 +887,9 @@ void VideoDecoder::setEndTime(const Audio::Timestamp &endTime) {
 		startAudioLimit(_endTime.msecs() - startTime.msecs());
 		_lastTimeChange = startTime;
 	}
+
+	if (isPlaying())
+		startReadAhead();
 }
 
 VideoDecoder::Track *VideoDecoder::getTrack(uint track) {
@@ -849,7 +963,7 @@ bool VideoDecoder::hasFramesLeft() const {
 	// This is only used for needsUpdate() atm so that setEndTime() works properly
 	// And unlike endOfVideoTracks(), this takes into account _endTime
 	for (TrackList::const_iterator it = _tracks.begin(); it != _tracks.end(); it++)
-		if ((*it)->getTrackType() == Track::kTrackTypeVideo && !(*it)->endOfTrack() && (!isPlaying() || !_endTimeSet || ((VideoTrack *)*it)->getNextFrameStartTime() < (uint)_endTime.msecs()))
+		if ((*it)->getTrackType() == Track::kTrackTypeVideo && !trackEnded(*it) && (!isPlaying() || !_endTimeSet || trackNextFrameTime((VideoTrack *)*it) < (uint)_endTime.msecs()))
 			return true;
 
 	return false;
@@ -863,4 +977,316 @@ bool VideoDecoder::hasAudio() const {
 	return false;
 }
 
+bool VideoDecoder::trackEnded(const Track *track) const {
+	// The video track itself may already be past the frames which have
+	// been decoded ahead of time, but not handed out yet.
+	if (!_readAheadActive || track != _readAheadTrack)
+		return track->endOfTrack();
+
+	Common::StackLock lock(_readAheadMutex);
+	return _readAheadEnd && _readAheadQueue.empty();
+}
+
+uint32 VideoDecoder::trackNextFrameTime(const VideoTrack *track) const {
+	if (!_readAheadActive || track != _readAheadTrack)
+		return track->getNextFrameStartTime();
+
+	Common::StackLock lock(_readAheadMutex);
+
+	if (_readAheadQueue.empty())
+		return _readAheadNextFrameTime;
+
+	return _readAheadQueue.front()->startTime;
+}
+
+void VideoDecoder::startReadAhead() {
+	if (_readAheadRunning || _readAheadFrames == 0 || !supportsReadAhead() || isPaused())
+		return;
+
+	if (!_readAheadActive) {
+		// Only a single video track playing forward is read ahead
+		VideoTrack *videoTrack = 0;
+
+		for (TrackList::iterator it = _tracks.begin(); it != _tracks.end(); it++) {
+			if ((*it)->getTrackType() == Track::kTrackTypeVideo) {
+				if (videoTrack)
+					return;
+
+				videoTrack = (VideoTrack *)*it;
+			}
+		}
+
+		if (!videoTrack || videoTrack->isReversed() || videoTrack->endOfTrack())
+			return;
+
+		_readAheadTrack = videoTrack;
+		_readAheadCurFrame = videoTrack->getCurFrame();
+		_readAheadNextFrameTime = videoTrack->getNextFrameStartTime();
+		_readAheadEnd = false;
+		_readAheadActive = true;
+	}
+
+	if (!s_readAheadDecoders) {
+		s_readAheadDecoders = new Common::Array<VideoDecoder *>();
+		s_readAheadMutex = new Common::Mutex();
+	}
+
+	bool first;
+
+	{
+		Common::StackLock lock(*s_readAheadMutex);
+		first = s_readAheadDecoders->empty();
+		s_readAheadDecoders->push_back(this);
+	}
+
+	if (first)
+		g_system->getTimerManager()->installTimerProc(&readAheadProc, kReadAheadInterval, 0, "videoReadAhead");
+
+	_readAheadRunning = true;
+}
+
+void VideoDecoder::stopReadAhead() {
+	if (!_readAheadRunning)
+		return;
+
+	bool last;
+
+	{
+		// Taking the lock waits for the timer callback to finish decoding
+		Common::StackLock lock(*s_readAheadMutex);
+
+		for (uint i = 0; i < s_readAheadDecoders->size(); i++) {
+			if ((*s_readAheadDecoders)[i] == this) {
+				s_readAheadDecoders->remove_at(i);
+				break;
+			}
+		}
+
+		last = s_readAheadDecoders->empty();
+	}
+
+	if (last) {
+		g_system->getTimerManager()->removeTimerProc(&readAheadProc);
+
+		delete s_readAheadDecoders;
+		s_readAheadDecoders = 0;
+		delete s_readAheadMutex;
+		s_readAheadMutex = 0;
+	}
+
+	_readAheadRunning = false;
+}
+
+void VideoDecoder::resetReadAhead() {
+	if (!_readAheadActive)
+		return;
+
+	Common::StackLock lock(_readAheadMutex);
+
+	while (!_readAheadQueue.empty())
+		_readAheadFree.push_back(_readAheadQueue.pop());
+
+	_readAheadActive = false;
+	_readAheadTrack = 0;
+	_readAheadTrackSurface = false;
+}
+
+void VideoDecoder::freeReadAhead() {
+	for (ReadAheadFrameList::iterator it = _readAheadPool.begin(); it != _readAheadPool.end(); it++) {
+		(*it)->surface.free();
+		delete *it;
+	}
+
+	_readAheadPool.clear();
+	_readAheadFree.clear();
+	_readAheadDisplayed = 0;
+}
+
+void VideoDecoder::readAheadFrame() {
+	ReadAheadFrame *frame;
+
+	{
+		Common::StackLock lock(_readAheadMutex);
+
+		if (_readAheadFree.empty()) {
+			frame = new ReadAheadFrame();
+			_readAheadPool.push_back(frame);
+		} else {
+			frame = _readAheadFree.back();
+			_readAheadFree.pop_back();
+		}
+	}
+
+	frame->startTime = _readAheadTrack->getNextFrameStartTime();
+
+	const uint32 startTime = g_system->getMillis();
+
+	readNextPacket();
+
+	const Graphics::Surface *surface = _readAheadTrack->decodeNextFrame();
+	frame->hasSurface = surface != 0;
+
+	if (surface) {
+		// Keep our own copy, the track is going to reuse its surface
+		if (frame->surface.w != surface->w || frame->surface.h != surface->h || frame->surface.format != surface->format) {
+			frame->surface.free();
+			frame->surface.create(surface->w, surface->h, surface->format);
+		}
+
+		for (int y = 0; y < surface->h; y++)
+			memcpy(frame->surface.getBasePtr(0, y), surface->getBasePtr(0, y), surface->w * surface->format.bytesPerPixel);
+	}
+
+	updateReadAheadDecodeTime(g_system->getMillis() - startTime);
+
+	frame->dirtyPalette = _readAheadTrack->hasDirtyPalette();
+
+	if (frame->dirtyPalette)
+		memcpy(frame->palette, _readAheadTrack->getPalette(), sizeof(frame->palette));
+
+	frame->curFrame = _readAheadTrack->getCurFrame();
+
+	Common::StackLock lock(_readAheadMutex);
+	_readAheadQueue.push(frame);
+	_readAheadNextFrameTime = _readAheadTrack->getNextFrameStartTime();
+	_readAheadEnd = _readAheadTrack->endOfTrack();
+}
+
+void VideoDecoder::updateReadAheadDecodeTime(uint32 decodeTime) {
+	// The estimate is the longest recent decoding time
+	_readAheadDecodeTime = MAX(decodeTime, _readAheadDecodeTime - (_readAheadDecodeTime + 7) / 8);
+}
+
+uint32 VideoDecoder::fillReadAheadQueue(uint32 budget) {
+	{
+		Common::StackLock lock(_readAheadMutex);
+
+		if (_readAheadEnd || _readAheadTrackSurface || (uint)_readAheadQueue.size() >= _readAheadFrames)
+			return 0;
+
+		// Do not decode frames which are not going to be shown
+		if (_endTimeSet && _readAheadNextFrameTime >= (uint)_endTime.msecs())
+			return 0;
+	}
+
+	// Frames which take longer than the rest of this call's budget are
+	// decoded by decodeNextFrame() instead
+	if (_readAheadDecodeTime > budget)
+		return 0;
+
+	const uint32 startTime = g_system->getMillis();
+	readAheadFrame();
+	return g_system->getMillis() - startTime;
+}
+
+const Graphics::Surface *VideoDecoder::decodeReadAheadFrame() {
+	ReadAheadFrame *frame = 0;
+
+	{
+		Common::StackLock lock(_readAheadMutex);
+
+		// The track's own surface is not shown anymore, read-ahead may go on
+		_readAheadTrackSurface = false;
+
+		if (!_readAheadQueue.empty())
+			frame = _readAheadQueue.pop();
+	}
+
+	if (!frame) {
+		// The timer callback did not decode the frame ahead. Holding its
+		// mutex keeps it from decoding at the same time.
+		if (_readAheadRunning)
+			s_readAheadMutex->lock();
+
+		const Graphics::Surface *surface = 0;
+
+		if (_readAheadQueue.empty() && !_readAheadEnd) {
+			// If the timer callback is not going to decode the next frame
+			// anyway, hand out the track's surface instead of a copy, and
+			// hold off read-ahead until the next call.
+			if (!_readAheadRunning || _readAheadDecodeTime > kReadAheadBudget)
+				surface = decodeReadAheadTrackFrame();
+			else
+				readAheadFrame();
+		}
+
+		if (!_readAheadTrackSurface) {
+			if (!_readAheadQueue.empty())
+				frame = _readAheadQueue.pop();
+			else
+				readNextPacket();
+		}
+
+		if (_readAheadRunning)
+			s_readAheadMutex->unlock();
+
+		if (!frame)
+			return surface;
+	}
+
+	Common::StackLock lock(_readAheadMutex);
+
+	// The previously returned surface may now be reused
+	if (_readAheadDisplayed)
+		_readAheadFree.push_back(_readAheadDisplayed);
+
+	_readAheadDisplayed = frame;
+	_readAheadCurFrame = frame->curFrame;
+
+	if (frame->dirtyPalette) {
+		memcpy(_readAheadPalette, frame->palette, sizeof(_readAheadPalette));
+		_palette = _readAheadPalette;
+		_dirtyPalette = true;
+	}
+
+	return frame->hasSurface ? &frame->surface : 0;
+}
+
+const Graphics::Surface *VideoDecoder::decodeReadAheadTrackFrame() {
+	const uint32 startTime = g_system->getMillis();
+
+	readNextPacket();
+
+	const Graphics::Surface *surface = _readAheadTrack->decodeNextFrame();
+
+	updateReadAheadDecodeTime(g_system->getMillis() - startTime);
+
+	Common::StackLock lock(_readAheadMutex);
+
+	if (_readAheadDisplayed) {
+		_readAheadFree.push_back(_readAheadDisplayed);
+		_readAheadDisplayed = 0;
+	}
+
+	_readAheadCurFrame = _readAheadTrack->getCurFrame();
+	_readAheadNextFrameTime = _readAheadTrack->getNextFrameStartTime();
+	_readAheadEnd = _readAheadTrack->endOfTrack();
+	_readAheadTrackSurface = true;
+
+	if (_readAheadTrack->hasDirtyPalette()) {
+		memcpy(_readAheadPalette, _readAheadTrack->getPalette(), sizeof(_readAheadPalette));
+		_palette = _readAheadPalette;
+		_dirtyPalette = true;
+	}
+
+	return surface;
+}
+
+void VideoDecoder::readAheadProc(void *refCon) {
+	Common::StackLock lock(*s_readAheadMutex);
+
+	// Decode at most one frame per video, and only as long as the frame is
+	// likely to fit into the budget left, so that other timers are not
+	// held up for long
+	uint32 budget = kReadAheadBudget;
+
+	for (uint i = 0; i < s_readAheadDecoders->size(); i++) {
+		const uint32 spent = (*s_readAheadDecoders)[i]->fillReadAheadQueue(budget);
+		if (spent >= budget)
+			break;
+
+		budget -= spent;
+	}
+}
+
 } // End of namespace Video
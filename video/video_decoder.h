@@ -26,6 +26,8 @@
 #include "audio/mixer.h"
 #include "audio/timestamp.h"	// TODO: Move this to common/ ?
 #include "common/array.h"
+#include "common/mutex.h"
+#include "common/queue.h"
 #include "common/rational.h"
 #include "common/str.h"
 #include "graphics/pixelformat.h"
@@ -52,7 +54,7 @@ namespace Video {
 class VideoDecoder {
 public:
 	VideoDecoder();
-	virtual ~VideoDecoder() {}
+	virtual ~VideoDecoder();
 
 	/////////////////////////////////////////
 	// Opening/Closing a Video
@@ -366,6 +368,28 @@ public:
 	 */
 	bool setReverse(bool reverse);
 
+	/**
+	 * Set how many frames may be decoded ahead of time.
+	 *
+	 * Decoders which support it decode frames into a bounded queue from a
+	 * timer callback while the video is playing, and decodeNextFrame()
+	 * then only hands out the next queued frame. The callback only spends
+	 * a few milliseconds per call, so frames which take longer to decode
+	 * are still decoded by decodeNextFrame(). Passing 0 disables this, so
+	 * that every frame is decoded when decodeNextFrame() is called.
+	 *
+	 * This must be set before calling start().
+	 *
+	 * @see supportsReadAhead()
+	 * @param frames The maximum number of frames to decode ahead
+	 */
+	void setReadAhead(uint frames) { _readAheadFrames = frames; }
+
+	/**
+	 * Get the maximum number of frames decoded ahead of time.
+	 */
+	uint getReadAhead() const { return _readAheadFrames; }
+
 	/////////////////////////////////////////
 	// Audio Control
 	/////////////////////////////////////////
@@ -873,6 +897,19 @@ protected:
 	 */
 	virtual AudioTrack *getAudioTrack(int index) { return 0; }
 
+	/**
+	 * Can frames of this video be decoded ahead of time?
+	 *
+	 * A decoder returning true has its readNextPacket() and its video
+	 * track's decodeNextFrame() called from the timer thread while the
+	 * video is playing. It must therefore not share its stream or any
+	 * other decoding state with code running outside of the decoder.
+	 * Read-ahead is only used for videos with a single video track.
+	 *
+	 * @see setReadAhead()
+	 */
+	virtual bool supportsReadAhead() const { return false; }
+
 private:
 	// Tracks owned by this VideoDecoder
 	TrackList _tracks;
@@ -907,6 +944,39 @@ private:
 	int8 _audioBalance;
 
 	AudioTrack *_mainAudioTrack;
+
+	// Read-ahead decoding
+	struct ReadAheadFrame;
+	typedef Common::Array<ReadAheadFrame *> ReadAheadFrameList;
+
+	uint _readAheadFrames;
+	bool _readAheadActive, _readAheadRunning;
+	VideoTrack *_readAheadTrack;
+	uint32 _readAheadDecodeTime;	///< Estimated time to decode a frame, in ms
+
+	// Guarded by _readAheadMutex, as they are shared with the timer thread
+	Common::Mutex _readAheadMutex;
+	Common::Queue<ReadAheadFrame *> _readAheadQueue;
+	ReadAheadFrameList _readAheadFree, _readAheadPool;
+	ReadAheadFrame *_readAheadDisplayed;
+	int _readAheadCurFrame;
+	uint32 _readAheadNextFrameTime;
+	bool _readAheadEnd;
+	bool _readAheadTrackSurface;	///< The track's own surface was handed out last
+	byte _readAheadPalette[256 * 3];
+
+	void startReadAhead();
+	void stopReadAhead();
+	void resetReadAhead();
+	void freeReadAhead();
+	void readAheadFrame();
+	void updateReadAheadDecodeTime(uint32 decodeTime);
+	uint32 fillReadAheadQueue(uint32 budget);
+	bool trackEnded(const Track *track) const;
+	uint32 trackNextFrameTime(const VideoTrack *track) const;
+	const Graphics::Surface *decodeReadAheadFrame();
+	const Graphics::Surface *decodeReadAheadTrackFrame();
+	static void readAheadProc(void *refCon);
 };
 
 } // End of namespace Video